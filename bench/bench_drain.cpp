@@ -0,0 +1,80 @@
+// Reading a burst of route notifications: one recv() per datagram compared with drain_notifications()
+// (recvmmsg batches). The routes are added on lo into a spare table, the subscriber has a big receive buffer
+// so both readers see the whole burst.
+#include <net/if.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "nl_batch.h"
+
+static const uint32_t rt_number  = 250;
+static const size_t route_count  = 20000;
+static const int rcvbuf          = 64 << 20;
+
+static int open_subscriber ()
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if ( setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0 ) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    sockaddr_nl nl_addr = {};
+    nl_addr.nl_family   = AF_NETLINK;
+    nl_addr.nl_groups   = RTMGRP_IPV4_ROUTE;
+    bind(fd, (sockaddr *)&nl_addr, sizeof(nl_addr));
+    return fd;
+}
+
+static void program (const int fd, const bool add)
+{
+    nl_socket_handler::nl_batch batch;
+    uint32_t lo = if_nametoindex("lo");
+    for ( size_t i = 0; i < route_count; ++i ) {
+        in_addr_t dst = htonl((10u << 24) | (i << 8));
+        if ( add ) {
+            batch.add_route(dst, 0, 24, 0, lo, rt_number);
+        } else {
+            batch.del_route(dst, 24, 0, rt_number);
+        }
+    }
+    batch.flush(fd);
+}
+
+int main ()
+{
+    int fd = nl_socket_handler::open_request_socket();
+    int events_fd = open_subscriber();
+    if ( fd < 0 or events_fd < 0 ) {
+        return 1;
+    }
+
+    for ( int drain = 0; drain < 2; ++drain ) {
+        program(fd, true);
+
+        size_t events = 0;
+        auto start    = std::chrono::steady_clock::now();
+        if ( drain ) {
+            nl_socket_handler::drain_notifications(events_fd, [&events] (nlmsghdr *nlh) {
+                events += nlh->nlmsg_type == RTM_NEWROUTE;
+                return true;
+            });
+        } else {
+            char buf[NL_DUMP_BUF_SIZE];
+            ssize_t size = 0;
+            while ( (size = recv(events_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0 ) {
+                for ( nlmsghdr *nlh = (nlmsghdr *)buf; NLMSG_OK(nlh, size); nlh = NLMSG_NEXT(nlh, size) ) {
+                    events += nlh->nlmsg_type == RTM_NEWROUTE;
+                }
+            }
+        }
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (drain ? "drain_notifications  " : "recv() per datagram  ") << events / sec / 1e6 << " M events/s, "
+                  << events << " of " << route_count << " events (" << route_count - events << " lost)" << std::endl;
+
+        program(fd, false);
+        nl_socket_handler::drain_notifications(events_fd, [] (nlmsghdr *) { return true; });
+    }
+    close(events_fd);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Peak memory and routes/second of a full-table dump: request_get_route_list into a doubling buffer
+// compared with the streaming visitor. Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "linux_route.h"
+#include "nl_batch.h"
+
+using namespace nl_socket_handler;
+
+static const uint32_t bench_table = 100;
+static const uint32_t lo_index    = 1;
+static const size_t route_count   = 1000000;
+
+static in_addr_t prefix (size_t i)
+{
+    return htonl(0x0A000000u + ((uint32_t)i << 8));  // 10.0.0.0/24, 10.0.1.0/24 ...
+}
+
+static size_t max_rss_kb ()
+{
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static double rate (size_t count, std::chrono::steady_clock::time_point start)
+{
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / sec;
+}
+
+int main ()
+{
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int fd = open_request_socket();
+    if ( fd < 0 or request_updown(fd, lo_index, true) < 0 or recv_response(fd, a_seq_num) != 0 ) {
+        std::cerr << "can't set up the test namespace" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    size_t errors = 0;
+    nl_batch batch;
+    for ( size_t i = 0; i < route_count; ++i ) {
+        batch.add_route(prefix(i), 0, 24, 0, lo_index, bench_table);
+        if ( batch.size() == 10000 or i + 1 == route_count ) {
+            for ( int rc : batch.flush(fd) ) {
+                errors += (rc != 0);
+            }
+        }
+    }
+
+    // ru_maxrss never goes down, so the streaming dump is measured first
+    size_t base   = max_rss_kb();
+    auto start    = std::chrono::steady_clock::now();
+    size_t visited = 0;
+    errors += (request_get_route_list(fd, bench_table, [&visited] (nlmsghdr *) { ++visited; }) != 0);
+    double stream_rate = rate(visited, start);
+    size_t stream_rss  = max_rss_kb() - base;
+    errors += (visited != route_count);
+
+    base             = max_rss_kb();
+    start            = std::chrono::steady_clock::now();
+    char *result     = new char[BUF_SIZE];
+    size_t dump_size = request_get_route_list(fd, bench_table, result, BUF_SIZE);
+    size_t parsed    = 0;
+    nlmsghdr *nlh    = (nlmsghdr *)result;
+    for ( ssize_t msg_size = dump_size; NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+        ++parsed;
+    }
+    double buffer_rate = rate(parsed, start);
+    size_t buffer_rss  = max_rss_kb() - base;
+    delete[] result;
+    errors += (parsed != route_count);
+
+    std::cout << route_count << " routes:" << std::endl
+              << "  dump into buffer " << (size_t)buffer_rate << " routes/s, peak RSS +" << buffer_rss << " KB" << std::endl
+              << "  streaming dump   " << (size_t)stream_rate << " routes/s, peak RSS +" << stream_rss << " KB" << std::endl
+              << "  errors " << errors << std::endl;
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Cost of a consumer sync after a few changes of a big table: reading the whole table (get() and a diff
+// against the consumer copy) compared with reading the journal since the consumer cursor.
+#include <chrono>
+#include <iostream>
+#include <unordered_set>
+
+#include "linux_route.h"
+
+static const uint32_t rt_number   = 1000;
+static const size_t route_count   = 1000000;
+static const size_t change_count  = 100;
+
+static linux_route make_route (uint32_t i, linux_route::e_status status)
+{
+    linux_route route;
+    ((sockaddr_in *)&route.dest)->sin_addr.s_addr = htonl(i << 8);
+    route.dest.ss_family                          = AF_INET;
+    route.mask_len                                = 24;
+    route.rt_number                               = rt_number;
+    route.iface_id                                = i % 8;
+    route.status                                  = status;
+    return route;
+}
+
+int main ()
+{
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number);
+    linux_routing_table table(rt_number);
+    for ( size_t i = 0; i < route_count; ++i ) {
+        table.update(make_route(i, linux_route::NEW), false);
+    }
+    rt_manager.update(table);
+
+    // the consumer copy: the packed identities of the routes it has programmed
+    std::unordered_set<uint64_t> consumer;
+    for ( const route_v4 &route : table.routes_v4() ) {
+        consumer.insert(route.hash());
+    }
+    uint64_t cursor = rt_manager.version(rt_number);
+
+    for ( size_t i = 0; i < change_count; ++i ) {
+        rt_manager.update(make_route(route_count + i, linux_route::NEW));
+    }
+
+    auto start   = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for ( const linux_route &route : *rt_manager.get(rt_number) ) {
+        found += consumer.count(route.to_v4().hash()) == 0;
+    }
+    double full_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::vector<route_delta> deltas;
+    rt_manager.changes_since(rt_number, cursor, deltas);
+    double journal_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << route_count << " routes, " << change_count << " changes:" << std::endl
+              << "  whole table re-read and diff " << full_sec * 1e6 << " us (" << found << " new)" << std::endl
+              << "  journal since the cursor     " << journal_sec * 1e6 << " us (" << deltas.size() << " deltas)" << std::endl;
+    return 0;
+}
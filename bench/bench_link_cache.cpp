@@ -0,0 +1,38 @@
+// Interface lookup by name: RTM_GETLINK round trip per call (nl_socket_handler::search_iface) compared with
+// link_cache, which looks the name up in a hash. The link events are applied by draining the hub, not by lookups.
+#include <chrono>
+#include <iostream>
+
+#include "link_cache.h"
+#include "nl_socket_handler.h"
+
+static const size_t lookup_count = 100000;
+
+int main ()
+{
+    int fd = nl_socket_handler::open_request_socket();
+    if ( fd < 0 ) {
+        return 1;
+    }
+
+    uint32_t found = 0;
+    auto start     = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < lookup_count; ++i ) {
+        found += nl_socket_handler::search_iface(fd, "lo");
+    }
+    double kernel_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    link_cache &links = link_cache::get_instance();
+    links.sync();  // the first dump
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < lookup_count; ++i ) {
+        found += links.ifindex("lo");
+    }
+    double cache_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << lookup_count << " lookups of lo (" << found << "):" << std::endl
+              << "  RTM_GETLINK per lookup " << kernel_sec / lookup_count * 1e9 << " ns/lookup" << std::endl
+              << "  link_cache             " << cache_sec / lookup_count * 1e9 << " ns/lookup, " << links.dumps() << " dump(s)" << std::endl;
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Lookups per second of the longest prefix match on Internet sized tables, single and batched:
+// IPv4 DIR-24-8 with ~1M prefixes (mostly /24, a share of /16../23 and a few longer than /24),
+// IPv6 binary search on lengths with 200K prefixes (mostly /48, then /32../47 and /56, /64).
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "lpm_v4.h"
+#include "lpm_v6.h"
+
+static const size_t prefix_count = 1000000;
+static const size_t lookup_count = 20000000;
+static const size_t prefix6_count = 200000;
+static const size_t lookup6_count = 5000000;
+
+static route_v4 make_prefix (std::mt19937 &rng)
+{
+    uint32_t roll   = rng() % 100;
+    uint8_t depth   = roll < 60 ? 24 : roll < 98 ? 16 + rng() % 8 : 25 + rng() % 8;
+    uint32_t addr   = (1u + rng() % 223) << 24 | (rng() & 0xffffff);  // 1.0.0.0 .. 223.255.255.255
+    route_v4 route;
+    route.dest      = htonl(addr & (~0u << (32 - depth)));
+    route.mask_len  = depth;
+    route.gw        = htonl(0x0A000001);
+    route.rt_number = 100;
+    route.iface_id  = rng() % 8;
+    route.flags     = route_v4::HAS_DEST | route_v4::HAS_GW;
+    return route;
+}
+
+static route_v6 make_prefix6 (std::mt19937 &rng, const std::vector<uint32_t> &sites)
+{
+    uint32_t roll = rng() % 100;
+    uint8_t len   = roll < 55 ? 48 : roll < 70 ? 32 : roll < 90 ? 33 + rng() % 15 : roll < 95 ? 56 : 64;
+    route_v6 route;
+    uint32_t words[4] = {htonl(sites[rng() % sites.size()]), htonl(rng()), htonl(rng()), 0};
+    memcpy(route.dest, words, sizeof(words));
+    for ( int bit = len; bit < 128; ++bit ) {
+        route.dest[bit / 8] &= ~(0x80 >> (bit % 8));
+    }
+    route.mask_len  = len;
+    route.rt_number = 100;
+    route.iface_id  = rng() % 8;
+    route.flags     = route_v4::HAS_DEST;
+    return route;
+}
+
+static void bench_v6 ()
+{
+    std::mt19937 rng(42);
+    std::vector<uint32_t> sites(20000);  // allocations under 2000::/3
+    for ( auto &site : sites ) {
+        site = 0x20000000u | (rng() & 0x1fffffffu);
+    }
+    lpm_v6 lpm;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < prefix6_count; ++i ) {
+        lpm.add(make_prefix6(rng, sites));
+    }
+    double build_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<in6_addr> addrs(lookup6_count);
+    for ( auto &addr : addrs ) {  // half of them inside the allocations
+        uint32_t words[4] = {htonl(rng() % 2 ? sites[rng() % sites.size()] : rng()), htonl(rng()), htonl(rng()), htonl(rng())};
+        memcpy(addr.s6_addr, words, sizeof(words));
+    }
+
+    size_t found = 0;
+    start        = std::chrono::steady_clock::now();
+    for ( const in6_addr &addr : addrs ) {
+        found += lpm.lookup(addr) != nullptr;
+    }
+    double single_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<const route_v6 *> results(1024);
+    start = std::chrono::steady_clock::now();
+    for ( size_t base = 0; base < lookup6_count; base += results.size() ) {
+        size_t count = std::min(results.size(), lookup6_count - base);
+        lpm.lookup(&addrs[base], count, results.data());
+        for ( size_t i = 0; i < count; ++i ) {
+            found += results[i] != nullptr;
+        }
+    }
+    double batch_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "IPv6: " << lpm.size() << " prefixes, built in " << build_sec << " s, " << lpm.bytes() / (1024 * 1024) << " MB" << std::endl
+              << "  single lookup  " << (size_t)(lookup6_count / single_sec) << " lookups/s" << std::endl
+              << "  batched lookup " << (size_t)(lookup6_count / batch_sec) << " lookups/s" << std::endl
+              << "  found " << found << std::endl;
+}
+
+static void bench_v4 ()
+{
+    std::mt19937 rng(42);
+    lpm_v4 lpm;
+
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < prefix_count; ++i ) {
+        lpm.add(make_prefix(rng));
+    }
+    double build_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<in_addr_t> addrs(lookup_count);
+    for ( auto &addr : addrs ) {
+        addr = htonl(rng());
+    }
+
+    size_t found = 0;
+    start        = std::chrono::steady_clock::now();
+    for ( in_addr_t addr : addrs ) {
+        found += lpm.lookup(addr) != nullptr;
+    }
+    double single_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<const route_v4 *> results(LPM_V4_BATCH * 64);
+    start = std::chrono::steady_clock::now();
+    for ( size_t base = 0; base < lookup_count; base += results.size() ) {
+        size_t count = std::min(results.size(), lookup_count - base);
+        lpm.lookup(&addrs[base], count, results.data());
+        for ( size_t i = 0; i < count; ++i ) {
+            found += results[i] != nullptr;
+        }
+    }
+    double batch_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "IPv4: " << lpm.size() << " prefixes, built in " << build_sec << " s, " << lpm.bytes() / (1024 * 1024) << " MB" << std::endl
+              << "  single lookup  " << (size_t)(lookup_count / single_sec) << " lookups/s" << std::endl
+              << "  batched lookup " << (size_t)(lookup_count / batch_sec) << " lookups/s" << std::endl
+              << "  found " << found << std::endl;
+}
+
+int main ()
+{
+    bench_v4();
+    bench_v6();
+    return 0;
+}
@@ -0,0 +1,139 @@
+// Allocation count and ns/message of the netlink message builder compared with
+// the new[]/memset/delete[] construction the request functions used before.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "nl_socket_handler.h"
+
+static size_t g_allocations = 0;
+
+void *operator new (size_t size)
+{
+    ++g_allocations;
+    if ( void *ptr = malloc(size) ) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[] (size_t size)
+{
+    ++g_allocations;
+    if ( void *ptr = malloc(size) ) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete (void *ptr) noexcept { free(ptr); }
+void operator delete[] (void *ptr) noexcept { free(ptr); }
+void operator delete (void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[] (void *ptr, size_t) noexcept { free(ptr); }
+
+using namespace nl_socket_handler;
+
+static volatile uint32_t g_sink = 0;
+
+// the old body of request_add_route without send()/recv
+static void legacy_add_route (uint32_t seq_num, in_addr_t dst_addr, in_addr_t gw, uint8_t masklen, uint32_t oif_id, uint32_t rtm_table)
+{
+    size_t msg_size = sizeof(nlmsghdr) + sizeof(rtmsg)  //
+                      + RTA_SPACE(sizeof(in_addr_t))    // RTA_DST
+                      + RTA_SPACE(sizeof(in_addr_t))    // RTA_GATEWAY
+                      + RTA_SPACE(sizeof(uint32_t))     // RTA_PRIORITY
+                      + RTA_SPACE(sizeof(uint32_t))     // RTA_OIF
+                      + RTA_SPACE(sizeof(uint32_t))     // RTA_TABLE
+        ;
+    char *msg_buf = new char[msg_size];
+    char *begin   = msg_buf;
+    memset(msg_buf, 0, msg_size * sizeof(char));
+
+    nlmsghdr *header   = (nlmsghdr *)msg_buf;
+    header->nlmsg_type = RTM_NEWROUTE;
+    header->nlmsg_len  = msg_size;
+    header->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE;
+    header->nlmsg_seq = seq_num;
+    msg_buf += sizeof(nlmsghdr);
+
+    rtmsg *rt          = (rtmsg *)msg_buf;
+    rt->rtm_family     = AF_INET;
+    rt->rtm_protocol   = RTPROT_STATIC;
+    rt->rtm_scope      = RT_SCOPE_LINK;
+    rt->rtm_dst_len    = masklen;
+    rt->rtm_type       = RTN_UNICAST;
+    msg_buf += sizeof(rtmsg);
+
+    msg_buf = fill_in_attr<in_addr_t>(msg_buf, RTA_GATEWAY, gw);
+    msg_buf = fill_in_attr<in_addr_t>(msg_buf, RTA_DST, dst_addr);
+    msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_PRIORITY, 0);
+    msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_OIF, oif_id);
+    msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_TABLE, rtm_table);
+
+    g_sink = g_sink + header->nlmsg_len + (uint8_t)begin[msg_size - 1];
+    delete[] begin;
+}
+
+static void legacy_create_vrf (uint32_t seq_num, const std::string &name, uint32_t rt_number)
+{
+    const std::string kind = "vrf";
+    size_t data_size       = RTA_SPACE(sizeof(rt_number));
+    size_t info_data_size  = RTA_SPACE(kind.size()) + RTA_SPACE(sizeof(data_size));
+    size_t msg_size        = sizeof(nlmsghdr) + sizeof(ifinfomsg) + RTA_SPACE(name.size()) + RTA_SPACE(info_data_size);
+
+    char *msg_buf = new char[msg_size];
+    memset(msg_buf, 0, msg_size * sizeof(char));
+    char *begin = msg_buf;
+
+    nlmsghdr *hdr    = (nlmsghdr *)msg_buf;
+    hdr->nlmsg_len   = msg_size;
+    hdr->nlmsg_type  = RTM_NEWLINK;
+    hdr->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_MATCH | NLM_F_ATOMIC;
+    hdr->nlmsg_seq   = seq_num;
+    msg_buf += sizeof(nlmsghdr) + sizeof(ifinfomsg);
+
+    msg_buf = fill_in_attr<const char(&)>(msg_buf, IFLA_IFNAME, *name.c_str(), name.size());
+    msg_buf = fill_in_attr<std::nullptr_t>(msg_buf, IFLA_LINKINFO, nullptr, info_data_size);
+    msg_buf = fill_in_attr<const char(&)>(msg_buf, IFLA_INFO_KIND, *kind.c_str(), kind.size());
+    msg_buf = fill_in_attr<std::nullptr_t>(msg_buf, IFLA_INFO_DATA, nullptr, data_size);
+    msg_buf = fill_in_attr<uint32_t>(msg_buf, IFLA_VRF_TABLE, rt_number);
+
+    g_sink = g_sink + hdr->nlmsg_len;
+    delete[] begin;
+}
+
+template <typename F>
+static void run (const char *name, size_t count, F &&fn)
+{
+    size_t allocations = g_allocations;
+    auto start         = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < count; ++i ) {
+        fn((uint32_t)i);
+    }
+    auto ns     = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    allocations = g_allocations - allocations;
+    std::cout << name << ": " << (double)ns / count << " ns/msg, "
+              << (double)allocations / count << " allocations/msg" << std::endl;
+}
+
+int main (int argc, char **argv)
+{
+    size_t count           = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+    const std::string name = "vrf_bench";
+
+    run("legacy  add_route", count, [] (uint32_t i) { legacy_add_route(i, htonl(i << 8), 0x0101a8c0, 24, 2, 254); });
+    run("builder add_route", count, [] (uint32_t i) {
+        nl_msg_builder &msg = local_msg_builder();
+        build_add_route(msg, i, htonl(i << 8), 0x0101a8c0, 24, 0, 2, 254, RTPROT_STATIC);
+        g_sink = g_sink + msg.size();
+    });
+
+    run("legacy  create_vrf", count, [&name] (uint32_t i) { legacy_create_vrf(i, name, i); });
+    run("builder create_vrf", count, [&name] (uint32_t i) {
+        nl_msg_builder &msg = local_msg_builder();
+        build_create_vrf(msg, i, name, i);
+        g_sink = g_sink + msg.size();
+    });
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Neighbours/second of request_add_neighbor (one ACK round trip per entity) compared with nl_batch, and the cost
+// of request_flush_neighbors (one dump and one batch). Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "nl_batch.h"
+#include "system_iface.h"
+
+using namespace nl_socket_handler;
+
+static in_addr_t host (size_t i)
+{
+    return htonl(0x0A000000u + 2 + (uint32_t)i);  // 10.0.0.2 ...
+}
+
+static double rate (size_t count, std::chrono::steady_clock::time_point start)
+{
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / sec;
+}
+
+static size_t flush_errors (nl_batch &batch, int fd)
+{
+    size_t errors = 0;
+    for ( int rc : batch.flush(fd) ) {
+        errors += (rc != 0);
+    }
+    return errors;
+}
+
+int main ()
+{
+    // the table is full at gc_thresh3 entities; the limit is shared by all the namespaces, it's restored at the end
+    // through the file opened before unshare()
+    std::fstream gc_thresh3("/proc/sys/net/ipv4/neigh/default/gc_thresh3");
+    std::string thresh;
+    gc_thresh3 >> thresh;
+    gc_thresh3.seekp(0);
+    gc_thresh3 << 1000000 << std::flush;
+
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    system_iface tap("bench_neigh", NONE, false, true);
+    tap.search_iface();
+    tap.set_ip_addr("10.0.0.1", "255.0.0.0");
+    tap.set_iface_state(true);
+    int fd           = open_request_socket();
+    uint32_t oif_id  = tap.linux_interface_id;
+    const char lladdr[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+    nl_batch batch;
+    for ( size_t count : {1000, 10000, 50000} ) {
+        size_t errors = 0;
+        auto start    = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) {
+            errors += (request_add_neighbor(fd, host(i), lladdr, oif_id) != 0);
+        }
+        double single = rate(count, start);
+
+        start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) {
+            batch.add_neighbor(host(i), lladdr, oif_id, NUD_STALE);  // a refresh of every entity
+        }
+        errors += flush_errors(batch, fd);
+        double batched = rate(count, start);
+
+        size_t flushed = 0;
+        start          = std::chrono::steady_clock::now();
+        errors += (request_flush_neighbors(fd, NUD_STALE, oif_id, &flushed) != 0) + (count - flushed);
+        double flush = rate(count, start);
+
+        std::cout << count << " neighbours: single " << (size_t)single << " neighbours/s, batch " << (size_t)batched
+                  << " neighbours/s, flush " << (size_t)flush << " neighbours/s, errors " << errors << std::endl;
+    }
+    close(fd);
+    gc_thresh3.seekp(0);
+    gc_thresh3 << thresh << std::flush;
+    return 0;
+}
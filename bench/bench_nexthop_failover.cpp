@@ -0,0 +1,88 @@
+// Failover convergence with 500k prefixes sharing two nexthops: the routes with their own gateway are rewritten one
+// by one (nl_batch replace_route), the routes via a nexthop group are moved by one replace of the group.
+// Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "nl_batch.h"
+
+using namespace nl_socket_handler;
+
+static const uint32_t bench_table = 100;
+static const uint32_t lo_index    = 1;
+static const size_t prefix_count  = 500000;
+static const uint32_t nh_primary = 1, nh_backup = 2, nh_group = 10;
+
+static in_addr_t prefix (size_t i)
+{
+    return htonl(0x0A000000u + ((uint32_t)i << 8));  // 10.0.0.0/24, 10.0.1.0/24 ...
+}
+
+static double elapsed_ms (std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t flush_errors (nl_batch &batch, int fd)
+{
+    size_t errors = 0;
+    for ( int rc : batch.flush(fd) ) {
+        errors += (rc != 0);
+    }
+    return errors;
+}
+
+int main ()
+{
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int fd = open_request_socket();
+    if ( fd < 0 or request_updown(fd, lo_index, true) < 0 or recv_response(fd, a_seq_num) != 0 ) {
+        std::cerr << "can't set up the test namespace" << std::endl;
+        return EXIT_FAILURE;
+    }
+    in_addr_t primary = htonl(0x7F000002u);  // 127.0.0.2
+    in_addr_t backup  = htonl(0x7F000003u);
+    size_t errors     = 0;
+
+    // the gateway in every route
+    nl_batch batch;
+    for ( size_t i = 0; i < prefix_count; ++i ) {
+        batch.add_route(prefix(i), primary, 24, 0, lo_index, bench_table);
+    }
+    errors += flush_errors(batch, fd);
+
+    auto start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < prefix_count; ++i ) {
+        batch.replace_route(prefix(i), backup, 24, 0, lo_index, bench_table);
+    }
+    errors += flush_errors(batch, fd);
+    double rewrite = elapsed_ms(start);
+
+    for ( size_t i = 0; i < prefix_count; ++i ) {
+        batch.del_route(prefix(i), 24, 0, bench_table);
+    }
+    errors += flush_errors(batch, fd);
+
+    // the routes via a nexthop group
+    errors += request_add_nexthop(fd, nh_primary, primary, lo_index) != 0;
+    errors += request_add_nexthop(fd, nh_backup, backup, lo_index) != 0;
+    errors += request_add_nexthop_group(fd, nh_group, {{.id = nh_primary, .weight = 0, .resvd1 = 0, .resvd2 = 0}}) != 0;
+    for ( size_t i = 0; i < prefix_count; ++i ) {
+        batch.add_route_nh(prefix(i), 24, nh_group, 0, bench_table);
+    }
+    errors += flush_errors(batch, fd);
+
+    start = std::chrono::steady_clock::now();
+    errors += request_add_nexthop_group(fd, nh_group, {{.id = nh_backup, .weight = 0, .resvd1 = 0, .resvd2 = 0}}, true) != 0;
+    double repoint = elapsed_ms(start);
+
+    std::cout << prefix_count << " prefixes: rewrite of every route " << rewrite << " ms, replace of the nexthop group "
+              << repoint << " ms, errors " << errors << std::endl;
+    close(fd);
+    return 0;
+}
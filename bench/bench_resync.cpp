@@ -0,0 +1,68 @@
+// Cold start resync of many followed tables: linux_rt_manager::update() per table compared with
+// linux_rt_manager::update_all(). Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "linux_route.h"
+#include "nl_batch.h"
+
+using namespace nl_socket_handler;
+
+static const uint32_t first_table = 1000;
+static const uint32_t lo_index    = 1;
+
+static double elapsed_ms (std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main ()
+{
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int fd = open_request_socket();
+    if ( fd < 0 or request_updown(fd, lo_index, true) < 0 or recv_response(fd, a_seq_num) != 0 ) {
+        std::cerr << "can't set up the test namespace" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto &rt_manager = linux_rt_manager::get_instance();  // its socket is opened in the namespace
+
+    uint32_t next_table = first_table;  // tables of the previous rounds stay followed and are resynced as well
+    for ( auto [tables, routes] : {std::pair<size_t, size_t>{500, 10}, {500, 200}} ) {
+        size_t errors = 0;
+        nl_batch batch;
+        for ( size_t t = 0; t < tables; ++t, ++next_table ) {
+            rt_manager.follow_rt(next_table);
+            for ( size_t i = 0; i < routes; ++i ) {
+                batch.add_route(htonl(0x0A000000u + ((uint32_t)i << 8)), 0, 24, 0, lo_index, next_table);
+            }
+            for ( int rc : batch.flush(fd) ) {
+                errors += (rc != 0);
+            }
+        }
+
+        auto follow_list = rt_manager.get_follow_list();
+        auto start       = std::chrono::steady_clock::now();
+        size_t count     = 0;
+        for ( uint32_t rt_number : follow_list ) {
+            count += rt_manager.update(rt_number, "");
+        }
+        double per_table = elapsed_ms(start);
+
+        start      = std::chrono::steady_clock::now();
+        int total  = rt_manager.update_all();
+        double all = elapsed_ms(start);
+        errors += ((size_t)total != count);
+
+        std::cout << follow_list.size() << " tables, " << count << " routes:" << std::endl
+                  << "  update() per table " << per_table << " ms" << std::endl
+                  << "  update_all()       " << all << " ms" << std::endl
+                  << "  errors " << errors << std::endl;
+    }
+    close(fd);
+    return 0;
+}
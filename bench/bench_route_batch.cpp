@@ -0,0 +1,78 @@
+// Routes/second of request_add_route (one ACK round trip per route) compared with nl_batch
+// (many routes per sendmsg). Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "nl_batch.h"
+
+using namespace nl_socket_handler;
+
+static const uint32_t bench_table = 100;
+static const uint32_t lo_index    = 1;
+
+static in_addr_t prefix (size_t i)
+{
+    return htonl(0x0A000000u + ((uint32_t)i << 8));  // 10.0.0.0/24, 10.0.1.0/24 ...
+}
+
+static double rate (size_t count, std::chrono::steady_clock::time_point start)
+{
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / sec;
+}
+
+static size_t flush_errors (nl_batch &batch, int fd)
+{
+    size_t errors = 0;
+    for ( int rc : batch.flush(fd) ) {
+        errors += (rc != 0);
+    }
+    return errors;
+}
+
+int main ()
+{
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int fd = open_request_socket();
+    if ( fd < 0 or request_updown(fd, lo_index, true) < 0 or recv_response(fd, a_seq_num) != 0 ) {
+        std::cerr << "can't set up the test namespace" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    nl_batch batch;
+    for ( size_t count : {1000, 10000, 100000} ) {
+        size_t errors = 0;
+        auto start    = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) {
+            errors += (request_add_route(fd, prefix(i), 0, 24, 0, lo_index, bench_table) != 0);
+        }
+        double single = rate(count, start);
+
+        for ( size_t i = 0; i < count; ++i ) {
+            batch.del_route(prefix(i), 24, 0, bench_table);
+        }
+        errors += flush_errors(batch, fd);
+
+        start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) {
+            batch.add_route(prefix(i), 0, 24, 0, lo_index, bench_table);
+        }
+        errors += flush_errors(batch, fd);
+        double batched = rate(count, start);
+
+        for ( size_t i = 0; i < count; ++i ) {
+            batch.del_route(prefix(i), 24, 0, bench_table);
+        }
+        errors += flush_errors(batch, fd);
+
+        std::cout << count << " routes: single " << (size_t)single << " routes/s, batch "
+                  << (size_t)batched << " routes/s, errors " << errors << std::endl;
+    }
+    close(fd);
+    return 0;
+}
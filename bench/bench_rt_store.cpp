@@ -0,0 +1,70 @@
+// Bytes per route and scan throughput of the packed route stores compared with the linux_route view
+// (three sockaddr_storage per route, the layout the table used to keep).
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "linux_route.h"
+
+static const size_t route_count = 1000000;
+static const int scan_rounds    = 20;
+
+static linux_route make_route (uint32_t i, bool v6)
+{
+    linux_route route;
+    if ( v6 ) {
+        auto dest                    = (sockaddr_in6 *)&route.dest;
+        dest->sin6_addr.s6_addr32[0] = htonl(0x20010db8);
+        dest->sin6_addr.s6_addr32[1] = htonl(i);
+        route.dest.ss_family         = AF_INET6;
+        auto gw                      = (sockaddr_in6 *)&route.gw;
+        gw->sin6_addr.s6_addr[15]    = 1;
+        route.gw.ss_family           = AF_INET6;
+        route.mask_len               = 64;
+    } else {
+        ((sockaddr_in *)&route.dest)->sin_addr.s_addr = htonl(i << 8);
+        route.dest.ss_family                          = AF_INET;
+        ((sockaddr_in *)&route.gw)->sin_addr.s_addr   = htonl(0x0A000001);
+        route.gw.ss_family                            = AF_INET;
+        route.mask_len                                = 24;
+    }
+    route.rt_number = 100;
+    route.iface_id  = i % 8;
+    route.status    = linux_route::NEW;
+    return route;
+}
+
+template <typename T>
+static double scan_rate (const T &routes, size_t &matched)
+{
+    auto start = std::chrono::steady_clock::now();
+    for ( int round = 0; round < scan_rounds; ++round ) {
+        for ( const auto &route : routes ) {
+            matched += (route.iface_id == 3);
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return routes.size() * scan_rounds / sec;
+}
+
+int main ()
+{
+    for ( bool v6 : {false, true} ) {
+        linux_routing_table table(100);
+        for ( size_t i = 0; i < route_count; ++i ) {
+            table.update(make_route(i, v6), false);
+        }
+
+        size_t matched     = 0;
+        double packed_rate = v6 ? scan_rate(table.routes_v6(), matched) : scan_rate(table.routes_v4(), matched);
+        auto *view         = table.get();
+        double view_rate   = scan_rate(*view, matched);
+        size_t view_bytes  = view->capacity() * sizeof(linux_route);
+
+        std::cout << route_count << (v6 ? " IPv6" : " IPv4") << " routes:" << std::endl
+                  << "  linux_route vector " << view_bytes / route_count << " bytes/route, scan " << (size_t)view_rate << " routes/s" << std::endl
+                  << "  packed store       " << table.bytes() / route_count << " bytes/route (with the index), scan " << (size_t)packed_rate << " routes/s" << std::endl
+                  << "  matched " << matched << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Cost of publishing a snapshot of a 1M route table after a change (copy-on-write chunks)
+// compared with copying the table, and lookups by identity in a snapshot from a reader thread.
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "linux_route.h"
+
+static const uint32_t rt_number  = 1000;
+static const size_t route_count  = 1000000;
+static const size_t update_count = 10000;
+
+static linux_route make_route (uint32_t i, linux_route::e_status status)
+{
+    linux_route route;
+    ((sockaddr_in *)&route.dest)->sin_addr.s_addr = htonl(i << 8);
+    route.dest.ss_family                          = AF_INET;
+    route.mask_len                                = 24;
+    route.rt_number                               = rt_number;
+    route.iface_id                                = i % 8;
+    route.status                                  = status;
+    return route;
+}
+
+int main ()
+{
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number);
+    linux_routing_table table(rt_number);
+    for ( size_t i = 0; i < route_count; ++i ) {
+        table.update(make_route(i, linux_route::NEW), false);
+    }
+    rt_manager.update(table);
+    const route_snapshots *snapshots = rt_manager.enable_snapshots(rt_number);
+
+    auto start = std::chrono::steady_clock::now();
+    linux_routing_table copy(rt_number);
+    copy = table;
+    double copy_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::atomic<bool> stop   = false;
+    std::atomic<size_t> hits = 0;
+    std::thread reader([&] () {
+        size_t i = 0;
+        while ( not stop ) {
+            nl_epoch::guard guard;
+            const route_snapshot *snapshot = snapshots->current();
+            for ( int n = 0; n < 1000; ++n, ++i ) {
+                hits += snapshot->v4.find(make_route(i % route_count, linux_route::NEW).to_v4()).first;
+            }
+        }
+    });
+
+    start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < update_count; ++i ) {
+        rt_manager.update(make_route(route_count + i, linux_route::NEW));
+        rt_manager.publish_snapshots();
+    }
+    double update_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stop = true;
+    reader.join();
+
+    start        = std::chrono::steady_clock::now();
+    size_t found = 0;
+    {
+        nl_epoch::guard guard;
+        const route_snapshot *snapshot = snapshots->current();
+        for ( size_t i = 0; i < route_count; ++i ) {
+            found += snapshot->v4.find(make_route(i, linux_route::NEW).to_v4()).first;
+        }
+    }
+    double find_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << route_count << " routes:" << std::endl
+              << "  table copy                   " << copy_sec * 1e6 << " us" << std::endl
+              << "  update + snapshot publish    " << update_sec / update_count * 1e6 << " us (with a reader running, " << hits << " reader hits)" << std::endl
+              << "  snapshot find by identity    " << (size_t)(route_count / find_sec) << " lookups/s (" << found << " found)" << std::endl
+              << "  snapshots waiting to be freed " << nl_epoch::get_instance().pending() << std::endl;
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Syscalls and routes/second of nl_batch::flush(fd) compared with nl_batch::flush(nl_uring&) for route installs,
+// and of request_get_route_list compared with nl_uring::dump for dumps.
+// Runs in a private network namespace, needs CAP_SYS_ADMIN.
+#include <sched.h>
+#include <sys/syscall.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "linux_route.h"
+#include "nl_batch.h"
+#include "nl_uring.h"
+
+using namespace nl_socket_handler;
+
+static const uint32_t bench_table = 100;
+static const uint32_t lo_index    = 1;
+
+// the socket calls of the library are counted here, io_uring_enter() is counted by nl_uring
+static size_t socket_syscalls = 0;
+
+extern "C" ssize_t recv (int fd, void *buf, size_t length, int flags)
+{
+    ++socket_syscalls;
+    return syscall(SYS_recvfrom, fd, buf, length, flags, nullptr, nullptr);
+}
+
+extern "C" ssize_t send (int fd, const void *buf, size_t length, int flags)
+{
+    ++socket_syscalls;
+    return syscall(SYS_sendto, fd, buf, length, flags, nullptr, 0);
+}
+
+extern "C" ssize_t sendmsg (int fd, const struct msghdr *msg, int flags)
+{
+    ++socket_syscalls;
+    return syscall(SYS_sendmsg, fd, msg, flags);
+}
+
+extern "C" int poll (struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    ++socket_syscalls;
+    timespec ts = {timeout / 1000, (timeout % 1000) * 1000000L};
+    return syscall(SYS_ppoll, fds, nfds, (timeout < 0) ? nullptr : &ts, nullptr, 0);
+}
+
+static in_addr_t prefix (size_t i)
+{
+    return htonl(0x0A000000u + ((uint32_t)i << 8));  // 10.0.0.0/24, 10.0.1.0/24 ...
+}
+
+static double rate (size_t count, std::chrono::steady_clock::time_point start)
+{
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count / sec;
+}
+
+template <typename T>
+static size_t flush_errors (nl_batch &batch, T &transport)
+{
+    size_t errors = 0;
+    for ( int rc : batch.flush(transport) ) {
+        errors += (rc != 0);
+    }
+    return errors;
+}
+
+static void fill (nl_batch &batch, size_t count, bool add)
+{
+    for ( size_t i = 0; i < count; ++i ) {
+        if ( add ) {
+            batch.add_route(prefix(i), 0, 24, 0, lo_index, bench_table);
+        } else {
+            batch.del_route(prefix(i), 24, 0, bench_table);
+        }
+    }
+}
+
+int main ()
+{
+    if ( unshare(CLONE_NEWNET) < 0 ) {
+        std::cerr << "unshare(CLONE_NEWNET) failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    int fd      = open_request_socket();
+    int ring_fd = open_request_socket();
+    if ( fd < 0 or ring_fd < 0 or request_updown(fd, lo_index, true) < 0 or recv_response(fd, a_seq_num) != 0 ) {
+        std::cerr << "can't set up the test namespace" << std::endl;
+        return EXIT_FAILURE;
+    }
+    nl_uring ring(ring_fd);
+    std::cout << "io_uring: " << (ring.is_open() ? "yes" : "no (fallback to send/recv)") << std::endl;
+
+    nl_batch batch;
+    for ( size_t count : {1000, 10000, 100000} ) {
+        size_t errors = 0;
+
+        fill(batch, count, true);
+        socket_syscalls = 0;
+        auto start      = std::chrono::steady_clock::now();
+        errors += flush_errors(batch, fd);
+        double sync_rate     = rate(count, start);
+        size_t sync_syscalls = socket_syscalls;
+
+        char *result    = new char[BUF_SIZE];
+        socket_syscalls = 0;
+        start           = std::chrono::steady_clock::now();
+        size_t dumped   = linux_routing_table(bench_table).get_routes_from_nl_resp(result, request_get_route_list(fd, bench_table, result, BUF_SIZE));
+        double sync_dump          = rate(dumped, start);
+        size_t sync_dump_syscalls = socket_syscalls;
+        delete[] result;
+        errors += (dumped != count);
+
+        fill(batch, count, false);
+        errors += flush_errors(batch, fd);
+
+        fill(batch, count, true);
+        socket_syscalls  = 0;
+        size_t ring_base = ring.syscalls();
+        start            = std::chrono::steady_clock::now();
+        errors += flush_errors(batch, ring);
+        double ring_rate     = rate(count, start);
+        size_t ring_syscalls = socket_syscalls + ring.syscalls() - ring_base;
+
+        linux_routing_table table(bench_table);  // parse the routes like the send/recv path does
+        socket_syscalls = 0;
+        ring_base       = ring.syscalls();
+        start           = std::chrono::steady_clock::now();
+        ring.dump([] (nl_msg_builder &msg, uint32_t seq_num) { build_get_route_list(msg, seq_num, bench_table); },
+                  [&table] (nlmsghdr *nlh) { table.update(linux_route::parse_route_from_nl_resp_hdr(nlh), false); });
+        dumped                    = table.size();
+        double ring_dump          = rate(dumped, start);
+        size_t ring_dump_syscalls = socket_syscalls + ring.syscalls() - ring_base;
+        errors += (dumped != count);
+
+        fill(batch, count, false);
+        errors += flush_errors(batch, ring);
+
+        std::cout << count << " routes:" << std::endl
+                  << "  install send/recv " << (size_t)sync_rate << " routes/s, " << sync_syscalls << " syscalls" << std::endl
+                  << "  install io_uring  " << (size_t)ring_rate << " routes/s, " << ring_syscalls << " syscalls" << std::endl
+                  << "  dump send/recv    " << (size_t)sync_dump << " routes/s, " << sync_dump_syscalls << " syscalls" << std::endl
+                  << "  dump io_uring     " << (size_t)ring_dump << " routes/s, " << ring_dump_syscalls << " syscalls" << std::endl
+                  << "  errors " << errors << std::endl;
+    }
+    close(fd);
+    close(ring_fd);
+    return 0;
+}
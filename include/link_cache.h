@@ -0,0 +1,68 @@
+#ifndef PROJECT_LINK_CACHE_H
+#define PROJECT_LINK_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#include "nl_events.h"
+
+/**
+ * @brief
+ * Process-wide cache of the interfaces: filled by one RTM_GETLINK dump and kept current by the
+ * RTM_NEWLINK/RTM_DELLINK events of the nl_hub, so a lookup costs a hash probe instead of a kernel round trip.
+ * Lookups don't read the hub socket: the events are applied when the hub is drained (by its reactor or by poll()),
+ * callers without a reactor call sync() first. The cache is dumped again only after the hub has lost events.
+ * Called on one thread with the hub
+ */
+class link_cache
+{
+    std::unordered_map<uint32_t, link_event> _links    = {};  // ifindex to its last state
+    std::unordered_map<std::string, uint32_t> _indexes = {};  // name to ifindex
+    uint64_t _subscription                             = 0;
+    bool _stale                                        = true;  // not filled yet or the hub has lost events
+    size_t _dumps                                      = 0;
+
+    link_cache();
+    ~link_cache();
+
+    void apply (const link_event &event);
+    void fill ();
+
+   public:
+    static link_cache &get_instance ()
+    {
+        static link_cache instance;
+        return instance;
+    }
+
+    void operator= (link_cache const &) = delete;
+    link_cache(link_cache const &)      = delete;
+
+    int refill ();
+    void sync ();
+    size_t size ();
+    size_t dumps () const { return _dumps; }
+
+    /**
+     * @brief
+     * Interface state: name, flags, master (VRF index), kind and VRF table. Valid until the next event or dump
+     * @return nullptr - no such interface
+     */
+    const link_event *find (const uint32_t ifindex);
+    const link_event *find (const std::string &name);
+
+    uint32_t ifindex (const std::string &name);  // "0" - no such interface
+    std::string name (const uint32_t ifindex);   // "" - no such interface
+
+    template <typename F>
+    void for_each (F on_link)
+    {
+        fill();
+        for ( const auto &[ifindex, link] : _links ) {
+            on_link(link);
+        }
+    }
+};
+
+#endif  // PROJECT_LINK_CACHE_H
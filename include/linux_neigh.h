@@ -0,0 +1,117 @@
+#ifndef PROJECT_LINUX_NEIGH_H
+#define PROJECT_LINUX_NEIGH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <unordered_map>
+
+#include "nl_events.h"
+#include "nl_socket_handler.h"
+
+class nl_reactor;
+
+// the address has been resolved (has a valid lladdr); NUD_VALID of the kernel
+#define NEIGH_NUD_VALID (NUD_PERMANENT | NUD_NOARP | NUD_REACHABLE | NUD_PROBE | NUD_STALE | NUD_DELAY)
+
+/**
+ * @brief
+ * Identity of a neighbour: interface, family and address (IPv4 in the first 4 bytes)
+ */
+struct neigh_key
+{
+    uint32_t ifindex  = 0;
+    uint8_t family    = AF_UNSPEC;
+    uint8_t addr[16]  = {0};
+
+    neigh_key() = default;
+    neigh_key(const uint32_t ifindex, const uint8_t family, const void *addr)
+        : ifindex(ifindex), family(family)
+    {
+        memcpy(this->addr, addr, family == AF_INET6 ? 16 : 4);
+    }
+
+    bool operator== (const neigh_key &key) const
+    {
+        return ifindex == key.ifindex and family == key.family and memcmp(addr, key.addr, sizeof(addr)) == 0;
+    }
+
+    struct hash
+    {
+        size_t operator() (const neigh_key &key) const
+        {
+            uint64_t words[2];
+            memcpy(words, key.addr, sizeof(words));
+            uint64_t hash = (words[0] ^ (words[1] * 0x9e3779b97f4a7c15ull)) + ((uint64_t)key.ifindex << 8 | key.family);
+            hash ^= hash >> 29;
+            hash *= 0xbf58476d1ce4e5b9ull;
+            return hash ^ (hash >> 32);
+        }
+    };
+};
+
+/**
+ * @brief
+ * Mirror of the kernel neighbour (ARP/NDP) tables: filled by an RTM_GETNEIGH dump and kept current by the RTMGRP_NEIGH
+ * events, so the resolution state and lladdr of a neighbour are looked up without a syscall. Lost events (ENOBUFS)
+ * make the next apply_notifications() dump the tables again. Called on one thread, like linux_rt_manager
+ */
+class linux_neigh_manager
+{
+    std::unordered_map<neigh_key, neigh_event, neigh_key::hash> m_neighs = {};
+
+    int nl_socket       = -1;
+    size_t _overruns    = 0;
+    size_t _resyncs     = 0;
+    bool _resync_needed = false;
+
+    linux_neigh_manager() { open_nl_socket(); };
+    ~linux_neigh_manager() { stop(); };
+
+   public:
+    static linux_neigh_manager &get_instance ()
+    {
+        static linux_neigh_manager instance;
+        return instance;
+    }
+
+    void operator= (linux_neigh_manager const &)    = delete;  // we won't copy file descripors
+    linux_neigh_manager(linux_neigh_manager const &) = delete;
+
+    int open_nl_socket ();
+    void stop ();
+    int get_nl_fd () const { return nl_socket; }
+
+    int update (const neigh_event &event);
+    int update_all (const std::function<void(const neigh_event &)> &on_change = nullptr);
+    int apply_notifications (const std::function<void(const neigh_event &)> &on_change = nullptr);
+    int attach (nl_reactor &reactor, std::function<void(const neigh_event &)> on_change = nullptr);
+    int detach (nl_reactor &reactor);
+
+    /**
+     * @brief
+     * The neighbour as the kernel has it: state (NUD_*), flags and lladdr. Valid until the next change of the mirror
+     * @return nullptr - the kernel has no such entry
+     */
+    const neigh_event *find (const uint32_t ifindex, const in_addr_t addr) const
+    {
+        auto pos = m_neighs.find(neigh_key(ifindex, AF_INET, &addr));
+        return pos == m_neighs.end() ? nullptr : &pos->second;
+    }
+    const neigh_event *find (const uint32_t ifindex, const in6_addr &addr) const
+    {
+        auto pos = m_neighs.find(neigh_key(ifindex, AF_INET6, &addr));
+        return pos == m_neighs.end() ? nullptr : &pos->second;
+    }
+    bool resolved (const uint32_t ifindex, const in_addr_t addr) const
+    {
+        const neigh_event *neigh = find(ifindex, addr);
+        return neigh and (neigh->state & NEIGH_NUD_VALID) and neigh->has_lladdr;
+    }
+
+    size_t size () const { return m_neighs.size(); }
+    size_t overruns () const { return _overruns; }
+    size_t resyncs () const { return _resyncs; }
+};
+
+#endif  // PROJECT_LINUX_NEIGH_H
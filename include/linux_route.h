@@ -5,22 +5,35 @@
 #include <stdint.h>
 #include <sys/socket.h>
 #include <cstring>  //memset
+#include <deque>
 #include <iostream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <linux/rtnetlink.h> // nlhdr 
 #include <sstream>
 #include <unistd.h> //close
 
+#include "lpm_v4.h"
+#include "lpm_v6.h"
 #include "nl_socket_handler.h"
+#include "route_journal.h"
+#include "route_multipath.h"
+#include "route_snapshot.h"
+#include "route_store.h"
+
+class nl_reactor;
 
 struct linux_route
 {
 
     enum e_status : uint8_t {
-        EMPTY  = 0,
-        NEW    = 1,
-        DELETE = 2
+        EMPTY   = 0,
+        NEW     = 1,
+        DELETE  = 2,
+        REPLACE = 3  // NEW in place of the route with the same table, destination, masklen and priority (NLM_F_REPLACE)
     };
 
     linux_route()
@@ -36,15 +49,28 @@ struct linux_route
     sockaddr_storage src;
     sockaddr_storage gw;
 
-    uint8_t priority  = 0;
+    uint32_t priority = 0;
     uint8_t metrics   = 0;
     uint8_t proto     = 0;
     uint32_t rt_number = 0;
     uint8_t mask_len  = 0;
     e_status status   = EMPTY;
-    uint16_t iface_id = 0;
+    uint32_t iface_id = 0;
+    uint32_t nh_id    = 0;  // RTA_NH_ID: the nexthop object gives gw and iface_id, see linux_rt_manager::find_nexthop()
+    uint32_t mp_id    = 0;  // RTA_MULTIPATH: id of the hop list in route_multipath, gw and iface_id are empty
+
+    std::span<const route_hop> hops () const { return route_multipath::get_instance().get(mp_id); }
 
     static linux_route parse_route_from_nl_resp_hdr (nlmsghdr *nlh);
+    static uint32_t rt_number_from_nl_resp_hdr (nlmsghdr *nlh);
+    static uint32_t parse_multipath (const rtattr *multipath, const uint8_t family);
+
+    explicit linux_route(const route_v4 &route);
+    explicit linux_route(const route_v6 &route);
+    route_v4 to_v4 () const;
+    route_v6 to_v6 () const;
+
+    bool is_v6 () const { return dest.ss_family == AF_INET6 or gw.ss_family == AF_INET6; }
 
     friend std::ostream &operator<< (std::ostream &os, linux_route &route)
     {
@@ -52,9 +78,15 @@ struct linux_route
         os << "  destination    - " << get_ip_str(route.dest) << std::endl;
         os << "  gateway        - " << get_ip_str(route.gw) << std::endl;
         os << "  table          - " << route.rt_number << std::endl;
-        os << "  priority       - " << (uint16_t)route.priority << std::endl;
+        os << "  priority       - " << route.priority << std::endl;
         os << "  mask_len       - " << (uint16_t)route.mask_len << std::endl;
-        os << "  iface_id       - " << (uint16_t)route.iface_id << std::endl;
+        os << "  iface_id       - " << route.iface_id << std::endl;
+        os << "  nh_id          - " << route.nh_id << std::endl;
+        for ( const route_hop &hop : route.hops() ) {
+            char str[INET6_ADDRSTRLEN] = {0};
+            inet_ntop(hop.family == AF_INET6 ? AF_INET6 : AF_INET, hop.gw, str, INET6_ADDRSTRLEN);
+            os << "  nexthop        - " << (hop.family ? str : "") << " dev " << hop.iface_id << " weight " << (uint16_t)hop.weight << std::endl;
+        }
         os << "  metrics        - " << (uint16_t)route.metrics << std::endl;
         os << "  proto          - " << (uint16_t)route.proto << std::endl;
         os << "  status         - ";
@@ -64,6 +96,9 @@ struct linux_route
         if ( route.status == linux_route::e_status::DELETE ) {
             os << "delete" << std::endl;
         }
+        if ( route.status == linux_route::e_status::REPLACE ) {
+            os << "replace" << std::endl;
+        }
 
         return os;
     };
@@ -82,6 +117,8 @@ struct linux_route
              and mask_len == route.mask_len           //
              and rt_number == route.rt_number         //                                                                                                                              = route.rt_number;
              and iface_id == route.iface_id           //
+             and nh_id == route.nh_id                 //
+             and mp_id == route.mp_id                 //  interned: equal lists have equal ids
              and metrics == route.metrics             //
              and priority == route.priority           //
              and sockaddr_is_equal(dest, route.dest)  //
@@ -118,7 +155,7 @@ struct linux_route
                 };
             }
             else if ( ss1.ss_family == AF_INET6 ) {
-                if ( ((sockaddr_in6 *)(&ss1))->sin6_addr.__in6_u.__u6_addr32 == ((sockaddr_in6 *)(&ss2))->sin6_addr.__in6_u.__u6_addr32 ) {
+                if ( memcmp(&((sockaddr_in6 *)(&ss1))->sin6_addr, &((sockaddr_in6 *)(&ss2))->sin6_addr, sizeof(in6_addr)) == 0 ) {
                     return true;
                 };
             }
@@ -141,7 +178,13 @@ struct linux_route
 
 class linux_routing_table
 {
-    std::vector<linux_route> _table = {};
+    route_store<route_v4> _v4 = {};
+    route_store<route_v6> _v6 = {};
+
+    mutable std::vector<linux_route> _routes = {};  // linux_route view built by get(), released on a change
+    mutable bool _routes_changed             = false;
+
+    void release_view ();
 
    public:
     const uint32_t _rt_number   = 0;
@@ -150,22 +193,23 @@ class linux_routing_table
     linux_routing_table() = default;
     linux_routing_table(const uint32_t rt_number, const std::string &vrf_name = "")
         : _rt_number(rt_number), _vrf_name(vrf_name) {};
-    linux_routing_table(const linux_routing_table &rt) = default;
+    linux_routing_table(const linux_routing_table &rt);
+    linux_routing_table(linux_routing_table &&rt) = default;
+    ~linux_routing_table();
 
-    linux_routing_table &operator= (linux_routing_table rt)
-    {
-        const_cast<std::string &>(this->_vrf_name) = rt._vrf_name;
-        const_cast<uint32_t &>(this->_rt_number)   = rt._rt_number;
-        this->_table                               = rt._table;
-        return *this;
-    }
+    linux_routing_table &operator= (linux_routing_table rt);
 
     int update (const linux_route &route, const bool need_to_check = true);
-    std::pair<bool, size_t> find (const linux_route &route) const;  // O(n)
+    int replace (const linux_route &route, linux_route &replaced);
+    std::pair<bool, size_t> find (const linux_route &route) const;  // O(1)
     void change_vrf_name (const std::string &name);
-    std::vector<linux_route> *get ();
+    const std::vector<linux_route> *get ();  // read-only copy of IPv4 then IPv6 routes. Prefer routes_v4()/routes_v6()
+    const route_store<route_v4> &routes_v4 () const { return _v4; }
+    const route_store<route_v6> &routes_v6 () const { return _v6; }
     uint32_t size () const;
+    size_t bytes () const;
     uint32_t get_routes_from_nl_resp (const char *nl_sock_resp_buf, ssize_t msg_size);
+    uint32_t get_routes_from_nl_dump (const int fd);
 };
 
 class linux_rt_manager
@@ -176,6 +220,22 @@ class linux_rt_manager
     std::map<uint32_t, size_t> m_id                  = {};  // routing tabel number to FIB ID
     std::map<uint32_t, std::string> m_name           = {};  // routing tabel number to vrf/table name
     std::map<uint32_t, linux_routing_table> m_tables = {};  // routing tabel number to table
+    std::map<uint32_t, std::unique_ptr<lpm_v4>> m_lpm  = {};  // routing tabel number to its IPv4 lookup engine
+    std::map<uint32_t, std::unique_ptr<lpm_v6>> m_lpm6 = {};  // routing tabel number to its IPv6 lookup engine
+    std::map<uint32_t, route_journal> m_journals       = {};  // routing tabel number to its changes
+    std::map<uint32_t, std::unique_ptr<route_snapshots>> m_snapshots = {};  // routing tabel number to its snapshots for readers
+    bool _publish_posted = false;
+    std::deque<linux_route> m_pending = {};  // drained notifications not taken by catch_route_update_notification() yet
+    size_t _overruns                  = 0;   // ENOBUFS of the notification socket
+    size_t _resyncs                   = 0;
+    bool _resync_needed               = false;  // notifications have been lost since the last resync()
+    uint64_t _vrf_listener            = 0;      // vrf_registry listener of follow_vrfs()
+    std::vector<uint32_t> m_vrf_tables = {};    // tables followed by follow_vrfs()
+    std::unordered_map<uint32_t, nexthop_event> m_nexthops = {};  // nexthop id to its object or group
+
+    void rebuild_views (const uint32_t rt_number);
+    void journal_diff (const linux_routing_table &old_table, const linux_routing_table &new_table);
+    std::vector<linux_route> nexthop_routes (const uint32_t nh_id) const;
 
     struct sockaddr_nl nl_addr;
     int nl_socket = 0;
@@ -206,20 +266,47 @@ class linux_rt_manager
     int update (const linux_routing_table &_table);
     int update (const linux_route &route, const bool need_to_check = true);
     int update (const uint32_t rt_number,const std::string& vrf_name);
+    int update_all ();
+    int update (const nexthop_event &nexthop);
+    int update_nexthops ();
+    const nexthop_event *find_nexthop (const uint32_t nh_id) const;  // valid until the next change of the nexthops
+    size_t nexthop_count () const { return m_nexthops.size(); }
 
 
     void follow_rt (const uint32_t rt_number, std::string vrf_name = "");
+    int unfollow_rt (const uint32_t rt_number);
+    int follow_vrfs ();
+    void unfollow_vrfs ();
     std::vector<uint32_t> get_follow_list ()const ;
     bool rt_number_is_followed (const uint32_t rt_number) const;
-    std::pair<bool, size_t> find (const linux_route &route) const;  // O(n)
+    std::pair<bool, size_t> find (const linux_route &route) const;  // O(1)
     ssize_t get_FIB_id (const uint32_t rt_number);
     void add_FIB_id (const uint32_t rt_number, const size_t fib_rt_num);
     int add_name (const uint32_t rt_number, const std::string &name);
     std::string get_name(const uint32_t rt_number) const ;
     bool was_changed () const;
-    std::vector<linux_route> *get (const uint32_t rt_number);
+    uint64_t version (const uint32_t rt_number) const;
+    int changes_since (const uint32_t rt_number, uint64_t &cursor, std::vector<route_delta> &deltas) const;
+    const std::vector<linux_route> *get (const uint32_t rt_number);  // the updating thread only, readers use enable_snapshots()
     uint32_t get_routes_from_nl_resp (const uint32_t rt_number, const char *nl_sock_resp_buf, ssize_t msg_size);
     bool catch_route_update_notification(linux_route &route);
+    int catch_route_update_notifications (std::vector<linux_route> &routes);
+    int apply_route_update_notifications ();
+    int resync (const std::function<void(const linux_route &)> &on_change = nullptr);
+    size_t overruns () const { return _overruns; }
+    size_t resyncs () const { return _resyncs; }
+    bool resync_needed () const { return _resync_needed; }
+    int attach (nl_reactor &reactor, std::function<void(const linux_route &)> on_change = nullptr);
+
+    int enable_lookup (const uint32_t rt_number);
+    const route_v4 *lookup (const uint32_t rt_number, const in_addr_t addr) const;
+    int lookup (const uint32_t rt_number, const in_addr_t *addrs, const size_t count, const route_v4 **results) const;
+    const route_v6 *lookup (const uint32_t rt_number, const in6_addr &addr) const;
+    int lookup (const uint32_t rt_number, const in6_addr *addrs, const size_t count, const route_v6 **results) const;
+    int detach (nl_reactor &reactor);
+
+    const route_snapshots *enable_snapshots (const uint32_t rt_number);
+    void publish_snapshots ();
 
 };
 
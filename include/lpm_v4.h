@@ -0,0 +1,95 @@
+#ifndef PROJECT_LPM_V4_H
+#define PROJECT_LPM_V4_H
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "route_store.h"
+
+#define LPM_V4_TBL24_SIZE  (1u << 24)
+#define LPM_V4_TBL8_SIZE   256
+#define LPM_V4_BATCH       16  // addresses prefetched together by the batched lookup
+
+/**
+ * @brief
+ * IPv4 longest prefix match, DIR-24-8: one access into a 2^24 table indexed by the first 24 bits of the address,
+ * and for prefixes longer than /24 a second one into a group of 256 entries.
+ * Every entry keeps the depth of the prefix it was filled by, so adds and deletes update only the entries
+ * of their prefix that aren't covered by a longer one. Among routes with the same prefix the one with the
+ * lowest priority wins; changing it only rewrites the result, not the tables.
+ */
+class lpm_v4
+{
+    // entry: [31] valid, [30] extended (index is a tbl8 group), [29..24] depth, [23..0] result or group index
+    static const uint32_t VALID    = 1u << 31;
+    static const uint32_t EXTENDED = 1u << 30;
+    static const uint32_t INDEX    = (1u << 24) - 1;
+
+    struct rule
+    {
+        uint32_t result = 0;  // index into _results
+        uint32_t routes = 0;  // count of routes with this prefix, the best one is in _results
+    };
+
+    std::vector<uint32_t> _tbl24 = {};
+    std::vector<uint32_t> _tbl8  = {};  // groups of LPM_V4_TBL8_SIZE entries
+    std::vector<uint32_t> _free_groups  = {};
+    std::vector<route_v4> _results      = {};
+    std::vector<uint32_t> _free_results = {};
+
+    std::unordered_map<uint64_t, rule> _rules                = {};  // (prefix << 8 | depth) to its rule
+    std::unordered_multimap<uint64_t, route_v4> _alternates = {};  // not the best routes of a prefix
+
+    static uint64_t rule_key (const uint32_t prefix, const uint8_t depth) { return ((uint64_t)prefix << 8) | depth; }
+    static uint32_t prefix_of (const uint32_t addr, const uint8_t depth) { return depth ? addr & (~0u << (32 - depth)) : 0; }
+    static uint32_t entry (const uint8_t depth, const uint32_t index) { return VALID | ((uint32_t)depth << 24) | index; }
+    static uint8_t depth_of (const uint32_t entry) { return (entry >> 24) & 0x3f; }
+
+    uint32_t alloc_result (const route_v4 &route);
+    uint32_t alloc_group (const uint32_t fill);
+    void fill (const uint32_t prefix, const uint8_t depth, const uint32_t value, const bool remove);
+    void try_collapse (const uint32_t tbl24_index);
+
+    uint32_t resolve (const uint32_t addr) const  // host byte order
+    {
+        uint32_t value = _tbl24[addr >> 8];
+        if ( value & EXTENDED ) {
+            value = _tbl8[(value & INDEX) * LPM_V4_TBL8_SIZE + (addr & 0xff)];
+        }
+        return value;
+    }
+
+    const route_v4 *result_of (const uint32_t entry) const
+    {
+        return (entry & VALID) ? &_results[entry & INDEX] : nullptr;
+    }
+
+   public:
+    lpm_v4();
+
+    int add (const route_v4 &route);
+    int del (const route_v4 &route);
+    void clear ();
+
+    size_t size () const { return _rules.size(); }
+    size_t bytes () const;
+
+    /**
+     * @brief
+     * Find the route for the address
+     * @param addr IPv4 address in network byte order
+     * @return const route_v4* the best route of the longest matching prefix, nullptr - no route.
+     * It's valid until the next add/del
+     */
+    const route_v4 *lookup (const in_addr_t addr) const
+    {
+        return result_of(resolve(ntohl(addr)));
+    }
+
+    void lookup (const in_addr_t *addrs, const size_t count, const route_v4 **results) const;
+};
+
+#endif  // PROJECT_LPM_V4_H
@@ -0,0 +1,120 @@
+#ifndef PROJECT_LPM_V6_H
+#define PROJECT_LPM_V6_H
+
+#include <endian.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "route_store.h"
+
+#define LPM_V6_MAX_LEN  128
+
+/**
+ * @brief
+ * IPv6 longest prefix match, binary search on prefix lengths (Waldvogel): one hash table of prefixes of every length,
+ * the search probes the length in the middle of the range left and goes to the longer half on a hit.
+ * A prefix puts markers on the lengths where the search has to go longer to reach it, and every marker keeps
+ * its best matching prefix, so a lookup is at most 8 probes (lengths 1..128) whatever the table is.
+ * The default route is kept outside the search.
+ * Among routes with the same prefix the one with the lowest priority wins; changing it only rewrites the result.
+ */
+class lpm_v6
+{
+    struct slot  // a prefix or a marker, the address in host byte order
+    {
+        uint64_t hi      = 0;
+        uint64_t lo      = 0;
+        uint8_t len      = 0;
+        uint8_t bmp_len  = 0;
+        uint32_t result  = 0;  // index + 1 into _results of the best route of the prefix, 0 - only a marker
+        uint32_t routes  = 0;  // count of routes with this prefix
+        uint32_t markers = 0;  // count of longer prefixes which need this marker
+        uint32_t bmp     = 0;  // index + 1 into _results of the longest prefix covering this one, 0 - none
+
+        bool same (const slot &other) const { return hi == other.hi and lo == other.lo and len == other.len; }
+        uint64_t hash () const { return route_hash_mix(route_hash_mix(hi, lo), len); }
+    };
+
+    using prefix_key = std::tuple<uint64_t, uint64_t, uint8_t>;  // hi, lo, len
+
+    route_store<slot> _slots                  = {};
+    uint32_t _lengths[LPM_V6_MAX_LEN + 1]     = {};  // count of slots per length
+    uint32_t _default                         = 0;   // result of ::/0
+    std::set<prefix_key> _prefixes            = {};  // prefixes in address order, to find the ones under a prefix
+    std::vector<route_v6> _results            = {};
+    std::vector<uint32_t> _free_results       = {};
+    std::unordered_multimap<uint32_t, route_v6> _alternates = {};  // result of the prefix to its not the best routes
+
+    static slot key_of (const uint64_t hi, const uint64_t lo, const uint8_t len)
+    {
+        slot key;
+        key.hi  = len == 0 ? 0 : len < 64 ? hi & (~0ull << (64 - len)) : hi;
+        key.lo  = len <= 64 ? 0 : len < 128 ? lo & (~0ull << (128 - len)) : lo;
+        key.len = len;
+        return key;
+    }
+
+    static void load (const uint8_t addr[16], uint64_t &hi, uint64_t &lo)  // network to host byte order
+    {
+        memcpy(&hi, addr, sizeof(hi));
+        memcpy(&lo, addr + 8, sizeof(lo));
+        hi = be64toh(hi);
+        lo = be64toh(lo);
+    }
+
+    /**
+     * @brief
+     * Call on_marker(length) for every length where a prefix of len needs a marker
+     */
+    template <typename F>
+    static void walk_markers (const uint8_t len, F on_marker)
+    {
+        int low  = 1;
+        int high = LPM_V6_MAX_LEN;
+        while ( low <= high ) {
+            int mid = (low + high) / 2;
+            if ( mid == len ) {
+                return;
+            }
+            if ( mid < len ) {
+                on_marker((uint8_t)mid);
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+    }
+
+    uint32_t alloc_result (const route_v6 &route);
+    std::pair<uint32_t, uint8_t> covering (const slot &key) const;
+    void add_marker (const slot &key);
+    void del_marker (const slot &key);
+
+    template <typename F>
+    void for_each_marker_under (const slot &key, F on_marker);
+
+   public:
+    int add (const route_v6 &route);
+    int del (const route_v6 &route);
+    void clear ();
+
+    size_t size () const { return _prefixes.size() + (_default != 0); }
+    size_t bytes () const;
+
+    /**
+     * @brief
+     * Find the route for the address
+     * @return const route_v6* the best route of the longest matching prefix, nullptr - no route.
+     * It's valid until the next add/del
+     */
+    const route_v6 *lookup (const in6_addr &addr) const;
+
+    void lookup (const in6_addr *addrs, const size_t count, const route_v6 **results) const;
+};
+
+#endif  // PROJECT_LPM_V6_H
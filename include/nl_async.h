@@ -0,0 +1,348 @@
+#ifndef PROJECT_NL_ASYNC_H
+#define PROJECT_NL_ASYNC_H
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+
+#include "nl_socket_handler.h"
+
+#define NL_ASYNC_WINDOW        64
+#define NL_ASYNC_SEND_BUF_SIZE (64 * 1024)
+#define NL_ASYNC_RECV_BUF_SIZE (32 * 1024)
+
+namespace nl_socket_handler
+{
+    /**
+     * @brief
+     * Pipelined request engine. Keeps up to `window` requests in flight on one socket and completes
+     * each of them when its ACK (or NLMSG_DONE for a dump, or the reply for a plain GET) arrives.
+     * Messages which don't belong to a pending request (multicast notifications, late replies)
+     * are passed to the notification handler instead of being dropped.
+     * Submitted requests are coalesced and sent by one send() in flush()/poll().
+     * The engine is not thread safe: submit, poll and the callbacks run on the same thread.
+     */
+    class nl_async_engine
+    {
+       public:
+        /**
+         * @brief
+         * Called once per request. rc: "0" - success; ">0" - a responce error code absolute value;
+         * "<0" - the request hasn't been sent/answered (-errno)
+         */
+        using completion      = std::function<void(int rc)>;
+        using message_handler = std::function<void(nlmsghdr *nlh)>;
+
+       private:
+        struct pending_request
+        {
+            uint16_t flags = 0;  // nlmsg_flags of the request
+            bool sent      = false;
+            completion done;
+            message_handler on_message;
+        };
+
+        int _fd        = -1;
+        size_t _window = NL_ASYNC_WINDOW;
+
+        std::vector<char> _send_buf;
+        std::vector<char> _recv_buf;
+        nl_msg_builder _msg;
+
+        std::unordered_map<uint32_t, pending_request> _pending = {};
+        message_handler _on_notification                       = nullptr;
+        size_t _overruns                                        = 0;
+
+        void complete (std::unordered_map<uint32_t, pending_request>::iterator pos, const int rc)
+        {
+            completion done = std::move(pos->second.done);
+            _pending.erase(pos);
+            if ( done ) {
+                done(rc);
+            }
+        }
+
+        /**
+         * @brief
+         * Route one received message to its request or to the notification handler
+         * @return true if a request was completed
+         */
+        bool dispatch (nlmsghdr *nlh)
+        {
+            auto pos = _pending.find(nlh->nlmsg_seq);
+            if ( nlh->nlmsg_seq == 0 or pos == _pending.end() or not pos->second.sent ) {
+                if ( _on_notification ) {
+                    _on_notification(nlh);
+                }
+                return false;
+            }
+
+            pending_request &request = pos->second;
+            if ( nlh->nlmsg_type == NLMSG_ERROR ) {
+                complete(pos, get_ack_code(nlh));
+                return true;
+            }
+            if ( nlh->nlmsg_type == NLMSG_DONE ) {
+                complete(pos, 0);
+                return true;
+            }
+            if ( request.on_message ) {
+                request.on_message(nlh);
+            }
+            if ( not(request.flags & (NLM_F_DUMP | NLM_F_ACK)) ) {  // a plain GET is answered by one message
+                complete(pos, 0);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief
+         * Lost replies can't be correlated. The kernel answers non-dump requests inside send(),
+         * so after an overrun and an empty queue they will never come
+         */
+        void fail_lost_requests ()
+        {
+            for ( auto pos = _pending.begin(); pos != _pending.end(); ) {
+                auto next = std::next(pos);
+                if ( pos->second.sent and not(pos->second.flags & NLM_F_DUMP) ) {
+                    complete(pos, -ENOBUFS);  // not answered, not a kernel error
+                }
+                pos = next;
+            }
+        }
+
+        /**
+         * @brief
+         * The socket can't be read: the answers of the sent requests will never come
+         */
+        void fail_sent_requests (const int rc)
+        {
+            for ( auto pos = _pending.begin(); pos != _pending.end(); ) {
+                auto next = std::next(pos);
+                if ( pos->second.sent ) {
+                    complete(pos, rc);
+                }
+                pos = next;
+            }
+        }
+
+       public:
+        explicit nl_async_engine(const int fd, const size_t window = NL_ASYNC_WINDOW)
+            : _fd(fd), _window(window ? window : 1), _send_buf(NL_ASYNC_SEND_BUF_SIZE), _recv_buf(NL_ASYNC_RECV_BUF_SIZE),
+              _msg(_send_buf.data(), _send_buf.size())
+        {
+            _pending.reserve(_window);
+        };
+
+        void operator= (nl_async_engine const &) = delete;  // the builder points into our buffer
+        nl_async_engine(nl_async_engine const &) = delete;
+
+        int get_fd () const { return _fd; }
+        size_t pending () const { return _pending.size(); }
+        size_t overruns () const { return _overruns; }
+
+        void on_notification (message_handler handler)
+        {
+            _on_notification = std::move(handler);
+        }
+
+        /**
+         * @brief
+         * Queue a request. Waits for completions if the window is full; if the socket fails meanwhile,
+         * the requests in flight are completed with -errno.
+         * @param build build(nl_msg_builder&, uint32_t seq_num) writes exactly one message
+         * @param done completion callback
+         * @param on_message receives every reply message (dump parts, GET reply) before the completion
+         * @return uint32_t sequence number of the request; "0" - the message doesn't fit into the send buffer
+         */
+        template <typename F>
+        uint32_t submit (F &&build, completion done, message_handler on_message = nullptr)
+        {
+            while ( _pending.size() >= _window ) {
+                int rc = poll(-1);
+                if ( rc < 0 ) {
+                    fail_sent_requests(rc);
+                }
+            }
+
+            uint32_t seq_num = ++a_seq_num;
+            if ( seq_num == 0 ) {
+                seq_num = ++a_seq_num;  // 0 is used by the kernel notifications
+            }
+            build(_msg, seq_num);
+            if ( _msg.overflow() ) {  // send what is queued and try again on the empty buffer
+                _msg.drop_msg();
+                flush();
+                build(_msg, seq_num);
+            }
+            if ( _msg.overflow() ) {
+                _msg.drop_msg();
+                if ( done ) {
+                    done(-EMSGSIZE);
+                }
+                return 0;
+            }
+
+            pending_request &request = _pending[seq_num];
+            request.flags            = _msg.msg()->nlmsg_flags;
+            request.done             = std::move(done);
+            request.on_message       = std::move(on_message);
+            return seq_num;
+        }
+
+        /**
+         * @brief
+         * Queue a request and get its result as a future. The future is ready after poll() has seen the ACK
+         */
+        template <typename F>
+        std::future<int> submit (F &&build)
+        {
+            auto promise            = std::make_shared<std::promise<int>>();
+            std::future<int> result = promise->get_future();
+            submit(std::forward<F>(build), [promise] (int rc) { promise->set_value(rc); });
+            return result;
+        }
+
+        /**
+         * @brief
+         * Send all the queued requests by one send()
+         * @return int "0" - success; "-errno" - send() failed, the queued requests are completed with it
+         */
+        int flush ()
+        {
+            if ( _msg.empty() ) {
+                return 0;
+            }
+            int rc   = send_msg(_fd, _msg);
+            int code = (rc == -1) ? -errno : 0;
+            _msg.reset();
+
+            for ( auto pos = _pending.begin(); pos != _pending.end(); ) {
+                auto next = std::next(pos);
+                if ( not pos->second.sent ) {
+                    pos->second.sent = true;
+                    if ( code ) {
+                        complete(pos, code);
+                    }
+                }
+                pos = next;
+            }
+            return code;
+        }
+
+        /**
+         * @brief
+         * Flush the queued requests, then receive and dispatch everything available
+         * @param timeout_ms how long to wait for the first message (-1 - infinite, 0 - don't wait)
+         * @return int count of completed requests; "-errno" - recv() or poll() failed
+         */
+        int poll (const int timeout_ms = 0)
+        {
+            flush();
+
+            int completed = 0;
+            int wait      = timeout_ms;
+            bool overrun  = false;
+            while ( true ) {
+                ssize_t msg_size = recv(_fd, _recv_buf.data(), _recv_buf.size(), MSG_DONTWAIT);
+                if ( msg_size < 0 ) {
+                    if ( errno == EINTR ) {
+                        continue;
+                    }
+                    if ( errno == ENOBUFS ) {  // some messages are lost, the rest are still queued
+                        ++_overruns;
+                        overrun = true;
+                        continue;
+                    }
+                    if ( errno != EAGAIN and errno != EWOULDBLOCK ) {
+                        return -errno;
+                    }
+                    if ( overrun ) {
+                        size_t before = _pending.size();
+                        fail_lost_requests();
+                        completed += before - _pending.size();
+                        overrun = false;
+                    }
+                    if ( completed or not wait or _pending.empty() ) {
+                        return completed;
+                    }
+                    pollfd pfd = {_fd, POLLIN, 0};
+                    int ready  = ::poll(&pfd, 1, wait);
+                    if ( ready < 0 and errno == EINTR ) {
+                        continue;
+                    }
+                    if ( ready < 0 ) {
+                        return -errno;
+                    }
+                    if ( ready == 0 ) {
+                        return completed;
+                    }
+                    wait = 0;  // wait only once
+                    continue;
+                }
+
+                nlmsghdr *nlh = (nlmsghdr *)_recv_buf.data();
+                for ( ; NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+                    completed += dispatch(nlh);
+                }
+            }
+        }
+
+        /**
+         * @brief
+         * Wait until every submitted request is completed. A socket failure completes the ones in flight with -errno
+         */
+        void drain ()
+        {
+            while ( not _pending.empty() ) {
+                int rc = poll(-1);
+                if ( rc < 0 ) {
+                    fail_sent_requests(rc);
+                }
+            }
+        }
+
+        uint32_t add_route (const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen, const uint32_t metric,  //
+                            const uint32_t oif_id, const uint32_t rtm_table, const uint8_t proto, completion done)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                if ( done ) {
+                    done(valid);
+                }
+                return 0;
+            }
+            return submit([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_add_route(msg, seq_num, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            }, std::move(done));
+        }
+
+        uint32_t add_ip_addr (const in_addr_t ip_addr, const uint8_t masklen, const uint32_t system_iface_id, completion done)
+        {
+            return submit([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_add_ip_addr(msg, seq_num, ip_addr, masklen, system_iface_id);
+            }, std::move(done));
+        }
+
+        uint32_t updown (const uint32_t system_iface_id, const bool up, completion done)
+        {
+            return submit([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_updown(msg, seq_num, system_iface_id, up);
+            }, std::move(done));
+        }
+
+        uint32_t add_neighbor (const in_addr_t dst_addr, const char (&lladdr)[6], const uint32_t oif_id, completion done)
+        {
+            return submit([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id, lladdr);
+            }, std::move(done));
+        }
+    };
+}  // namespace nl_socket_handler
+
+#endif  //PROJECT_NL_ASYNC_H
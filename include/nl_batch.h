@@ -0,0 +1,616 @@
+#ifndef PROJECT_NL_BATCH_H
+#define PROJECT_NL_BATCH_H
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include <poll.h>
+
+#include "nl_socket_handler.h"
+#include "nl_uring.h"
+
+#define NL_BATCH_OPS_PER_SEND   128          // every ACK is a separate skb, keep them within the default SO_RCVBUF
+#define NL_BATCH_BYTES_PER_SEND (64 * 1024)  // has to be less than SO_SNDBUF
+#define NL_IP6_RT_PRIO_USER     1024         // metric of an IPv6 route added without one (IP6_RT_PRIO_USER)
+#define NL_BATCH_ACK_TIMEOUT_MS 1000
+#define NL_BATCH_PENDING        INT_MIN
+
+namespace nl_socket_handler
+{
+    /**
+     * @brief
+     * Queue of netlink requests which are sent by a few large sendmsg() and acknowledged together.
+     * Every queued operation gets an index; flush() returns the results in the same order:
+     * "0" - success; ">0" - a responce error code absolute value; "<0" - -errno of a local failure: the request
+     * hasn't been sent, or its ACK has been lost (-ENOBUFS, -ETIMEDOUT) and the kernel may have applied it.
+     * The socket used for flush() should not be subscribed to multicast groups, otherwise
+     * notifications about our own changes compete with the ACKs for the receive buffer.
+     */
+    class nl_batch
+    {
+        std::vector<char> _buf;
+        nl_msg_builder _msg;
+        std::vector<int> _results = {};
+        size_t _ops_per_send      = NL_BATCH_OPS_PER_SEND;
+
+        /**
+         * @brief
+         * Write a message with the builder function, growing the buffer if needed.
+         * The sequence number of a queued message is its operation index, it's rebased in flush()
+         */
+        template <typename F>
+        size_t append (F &&build)
+        {
+            size_t index = _results.size();
+            build(_msg, (uint32_t)index);
+            while ( _msg.overflow() ) {
+                _msg.drop_msg();
+                _buf.resize(_buf.size() << 1);
+                _msg.rebind(_buf.data(), _buf.size());
+                build(_msg, (uint32_t)index);
+            }
+            _results.push_back(0);
+            return index;
+        }
+
+        size_t reject (const int rc)
+        {
+            _results.push_back(rc);
+            return _results.size() - 1;
+        }
+
+        int send_chunk (const int fd, char *begin, size_t length)
+        {
+            iovec iov     = {begin, length};
+            msghdr header = {};
+            header.msg_iov    = &iov;
+            header.msg_iovlen = 1;
+            if ( sendmsg(fd, &header, 0) == -1 ) {
+                return -errno;
+            }
+            return 0;
+        }
+
+        /**
+         * @brief
+         * Read ACKs until `count` pending operations starting from `first` are answered
+         */
+        void recv_acks (const int fd, const uint32_t base_seq, const size_t first, size_t count)
+        {
+            char nl_sock_resp_buf[BUF_SIZE];
+            bool overrun = false;
+            while ( count ) {
+                ssize_t msg_size = recv(fd, nl_sock_resp_buf, BUF_SIZE, overrun ? MSG_DONTWAIT : 0);
+                if ( msg_size < 0 ) {
+                    if ( errno == EINTR ) {
+                        continue;
+                    }
+                    if ( errno == ENOBUFS ) {  // some messages are lost, but the rest of ACKs may be queued
+                        overrun = true;
+                        continue;
+                    }
+                    if ( errno == EAGAIN or errno == EWOULDBLOCK ) {
+                        pollfd pfd = {fd, POLLIN, 0};
+                        if ( not overrun and poll(&pfd, 1, NL_BATCH_ACK_TIMEOUT_MS) > 0 ) {
+                            continue;
+                        }
+                        errno = overrun ? ENOBUFS : ETIMEDOUT;
+                    }
+                    fail_pending(first, -errno);  // ACKs are lost
+                    return;
+                }
+
+                count -= take_acks(nl_sock_resp_buf, msg_size, base_seq, first);
+            }
+        }
+
+        /**
+         * @brief
+         * Store the ACKs found in one datagram
+         * @return size_t count of answered operations
+         */
+        size_t take_acks (const char *buf, ssize_t msg_size, const uint32_t base_seq, const size_t first)
+        {
+            size_t count  = 0;
+            nlmsghdr *nlh = (nlmsghdr *)buf;
+            for ( ; NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+                if ( nlh->nlmsg_type != NLMSG_ERROR ) {
+                    continue;
+                }
+                uint32_t index = nlh->nlmsg_seq - base_seq;
+                if ( index < first or index >= _results.size() or _results[index] != NL_BATCH_PENDING ) {
+                    continue;  // not ours
+                }
+                _results[index] = get_ack_code(nlh);
+                ++count;
+            }
+            return count;
+        }
+
+        void fail_pending (const size_t first, const int code, size_t last = SIZE_MAX)
+        {
+            last = std::min(last, _results.size());
+            for ( size_t i = first; i < last; ++i ) {
+                if ( _results[i] == NL_BATCH_PENDING ) {
+                    _results[i] = code;
+                }
+            }
+        }
+
+        struct chunk
+        {
+            char *begin   = nullptr;
+            size_t length = 0;
+            size_t first  = 0;  // index of the first operation
+            size_t ops    = 0;
+        };
+
+        /**
+         * @brief
+         * Rebase the sequence numbers and cut the queued messages into chunks for one send each.
+         * Every operation of a returned chunk is marked as pending
+         */
+        chunk next_chunk (char *&ptr, char *end, const uint32_t base_seq)
+        {
+            chunk part;
+            part.begin = ptr;
+            part.first = ((nlmsghdr *)ptr)->nlmsg_seq;
+            while ( ptr < end and part.ops < _ops_per_send ) {
+                nlmsghdr *nlh = (nlmsghdr *)ptr;
+                if ( part.ops and (size_t)(ptr - part.begin) + nlh->nlmsg_len > NL_BATCH_BYTES_PER_SEND ) {
+                    break;
+                }
+                _results[nlh->nlmsg_seq] = NL_BATCH_PENDING;
+                nlh->nlmsg_seq += base_seq;
+                ptr += NLMSG_ALIGN(nlh->nlmsg_len);
+                ++part.ops;
+            }
+            part.length = ptr - part.begin;
+            return part;
+        }
+
+        std::vector<int> take_results ()
+        {
+            std::vector<int> results;
+            results.swap(_results);
+            clear();
+            return results;
+        }
+
+       public:
+        explicit nl_batch(const size_t reserved_bytes = NL_BATCH_BYTES_PER_SEND)
+            : _buf(reserved_bytes ? reserved_bytes : NL_MSG_BUILDER_BUF_SIZE), _msg(_buf.data(), _buf.size()) {};
+
+        void operator= (nl_batch const &) = delete;  // the builder points into our buffer
+        nl_batch(nl_batch const &)        = delete;
+
+        /**
+         * @brief
+         * Limit the count of requests sent by one sendmsg(). The kernel queues one ACK per request,
+         * so a bigger value needs a bigger SO_RCVBUF on the socket.
+         */
+        void set_ops_per_send (const size_t ops)
+        {
+            _ops_per_send = ops ? ops : 1;
+        }
+
+        size_t size () const { return _results.size(); }
+        bool empty () const { return _results.empty(); }
+
+        void clear ()
+        {
+            _msg.reset();
+            _results.clear();
+        }
+
+        /**
+         * @brief
+         * Queue any request. build(nl_msg_builder&, uint32_t seq_num) has to write exactly one message with NLM_F_ACK
+         * @return size_t index of the operation
+         */
+        template <typename F>
+        size_t add (F &&build)
+        {
+            return append(std::forward<F>(build));
+        }
+
+        size_t add_route (const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                          const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            });
+        }
+
+        size_t replace_route (const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                              const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            });
+        }
+
+        /**
+         * @brief
+         * Queue a route deletion. Zero gw/oif_id/metric match any value
+         */
+        size_t del_route (const in_addr_t dst_addr, const uint8_t masklen, const uint32_t metric = 0, const uint32_t rtm_table = RT_TABLE_MAIN,  //
+                          const in_addr_t gw = 0, const uint32_t oif_id = NO_SYSTEM_ID)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_DELROUTE, 0, dst_addr, gw, masklen, metric, oif_id, rtm_table, 0);
+            });
+        }
+
+        size_t add_route (const in6_addr &dst_addr, const in6_addr &gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                          const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            });
+        }
+
+        size_t replace_route (const in6_addr &dst_addr, const in6_addr &gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                              const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            });
+        }
+
+        size_t del_route (const in6_addr &dst_addr, const uint8_t masklen, const uint32_t metric = 0, const uint32_t rtm_table = RT_TABLE_MAIN,  //
+                          const in6_addr &gw = in6addr_any, const uint32_t oif_id = NO_SYSTEM_ID)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_DELROUTE, 0, dst_addr, gw, masklen, metric, oif_id, rtm_table, 0);
+            });
+        }
+
+        /**
+         * @brief
+         * Queue an IPv6 address, see request_add_ip_addr()
+         */
+        size_t add_ip_addr (const in6_addr &ip_addr, const uint8_t masklen, const uint32_t system_iface_id, const bool nodad = false)
+        {
+            if ( system_iface_id == NO_SYSTEM_ID or not masklen or masklen > 128 ) {
+                return reject(-EINVAL);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_ip_addr(msg, seq_num, RTM_NEWADDR, ip_addr, masklen, system_iface_id, nodad ? IFA_F_NODAD : 0);
+            });
+        }
+
+        size_t del_ip_addr (const in6_addr &ip_addr, const uint8_t masklen, const uint32_t system_iface_id)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) { build_ip_addr(msg, seq_num, RTM_DELADDR, ip_addr, masklen, system_iface_id); });
+        }
+
+        /**
+         * @brief
+         * Queue a route via a nexthop object (RTA_NH_ID) instead of its own gateway and oif
+         */
+        size_t add_route_nh (const in_addr_t dst_addr, const uint8_t masklen, const uint32_t nh_id, const uint32_t metric = 0,  //
+                             const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route_nh(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE, dst_addr, masklen, nh_id, metric, rtm_table, proto);
+            });
+        }
+
+        size_t replace_route_nh (const in_addr_t dst_addr, const uint8_t masklen, const uint32_t nh_id, const uint32_t metric = 0,  //
+                                 const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 ) {
+                return reject(valid);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route_nh(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, masklen, nh_id, metric, rtm_table, proto);
+            });
+        }
+
+        /**
+         * @brief
+         * Queue an IPv4 ECMP route, see request_add_route_multipath()
+         */
+        size_t add_route_multipath (const in_addr_t dst_addr, const uint8_t masklen, const std::vector<route_hop> &hops, const uint32_t metric = 0,  //
+                                    const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC, const bool replace = false)
+        {
+            int valid = check_route_args(dst_addr, masklen);
+            if ( valid < 0 or hops.empty() ) {
+                return reject(valid < 0 ? valid : -EINVAL);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route_multipath(msg, seq_num, NLM_F_CREATE | (replace ? NLM_F_REPLACE : 0), dst_addr, masklen, hops.data(), hops.size(), metric, rtm_table, proto);
+            });
+        }
+
+        /**
+         * @brief
+         * Queue a creation (or a replace) of an IPv4 nexthop object, see request_add_nexthop()
+         */
+        size_t add_nexthop (const uint32_t nh_id, const in_addr_t gw, const uint32_t oif_id, const bool replace = false)
+        {
+            if ( not nh_id ) {
+                return reject(-EINVAL);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_nexthop(msg, seq_num, replace ? NLM_F_CREATE | NLM_F_REPLACE : NLM_F_CREATE | NLM_F_EXCL, nh_id, gw, oif_id);
+            });
+        }
+
+        size_t add_nexthop_group (const uint32_t nh_id, const std::vector<nexthop_grp> &members, const bool replace = false)
+        {
+            if ( not nh_id or members.empty() ) {
+                return reject(-EINVAL);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_nexthop_group(msg, seq_num, replace ? NLM_F_CREATE | NLM_F_REPLACE : NLM_F_CREATE | NLM_F_EXCL, nh_id, members.data(), members.size());
+            });
+        }
+
+        size_t del_nexthop (const uint32_t nh_id)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) { build_del_nexthop(msg, seq_num, nh_id); });
+        }
+
+        /**
+         * @brief
+         * Queue an install or a refresh of an ARP entity: it's created or its lladdr and state are replaced
+         * @param state NUD_* of the entity
+         */
+        size_t add_neighbor (const in_addr_t dst_addr, const char (&lladdr)[6], const uint32_t oif_id, const uint16_t state = NUD_PROBE)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, oif_id, lladdr, state);
+            });
+        }
+
+        /**
+         * @brief
+         * Queue the same request as request_update_neighbor(): a stale entity is probed again
+         */
+        size_t update_neighbor (const in_addr_t dst_addr, const uint32_t oif_id)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id);
+            });
+        }
+
+        size_t add_neighbor (const in6_addr &dst_addr, const char (&lladdr)[6], const uint32_t oif_id, const uint16_t state = NUD_PROBE)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, oif_id, lladdr, state);
+            });
+        }
+
+        size_t update_neighbor (const in6_addr &dst_addr, const uint32_t oif_id)
+        {
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id);
+            });
+        }
+
+        size_t del_neighbor (const in_addr_t dst_addr, const uint32_t oif_id)
+        {
+            return del_neighbor(AF_INET, &dst_addr, oif_id);
+        }
+
+        size_t del_neighbor (const in6_addr &dst_addr, const uint32_t oif_id)
+        {
+            return del_neighbor(AF_INET6, &dst_addr, oif_id);
+        }
+
+        size_t del_neighbor (const uint8_t family, const void *addr, const uint32_t oif_id)
+        {
+            if ( family != AF_INET and family != AF_INET6 ) {
+                return reject(-EAFNOSUPPORT);
+            }
+            return append([&] (nl_msg_builder &msg, uint32_t seq_num) { build_del_neighbor(msg, seq_num, family, addr, oif_id); });
+        }
+
+        /**
+         * @brief
+         * Send all the queued requests and read back their ACKs. The batch is empty after the call
+         * @param fd netlink socket fd
+         * @return std::vector<int> result per operation index, see nl_batch
+         */
+        std::vector<int> flush (const int fd)
+        {
+            uint32_t base_seq = a_seq_num.fetch_add(_results.size() + 1) + 1;
+
+            char *ptr = _msg.data();
+            char *end = _msg.data() + _msg.size();
+            while ( ptr < end ) {
+                chunk part = next_chunk(ptr, end, base_seq);
+                int rc     = send_chunk(fd, part.begin, part.length);
+                if ( rc < 0 ) {
+                    fail_pending(part.first, rc);
+                    continue;
+                }
+                recv_acks(fd, base_seq, part.first, part.ops);
+            }
+            return take_results();
+        }
+
+        /**
+         * @brief
+         * Same as flush(fd), but the chunks are sent as linked io_uring sends and the ACKs are taken
+         * from the multishot receive, so a few io_uring_enter() replace one send and one recv per ACK.
+         * Up to NL_URING_BUFS operations are in flight. Falls back to flush(fd) without io_uring
+         */
+        std::vector<int> flush (nl_uring &ring)
+        {
+            if ( not ring.is_open() ) {
+                return flush(ring.get_fd());
+            }
+            uint32_t base_seq = a_seq_num.fetch_add(_results.size() + 1) + 1;
+
+            std::vector<chunk> parts;
+            char *ptr = _msg.data();
+            char *end = _msg.data() + _msg.size();
+            while ( ptr < end ) {
+                parts.push_back(next_chunk(ptr, end, base_seq));
+            }
+
+            size_t next      = 0;  // the first chunk which isn't sent yet
+            size_t in_flight = 0;  // operations waiting for ACK
+            auto on_datagram = [&] (char *buf, size_t size) {
+                in_flight -= take_acks(buf, size, base_seq, 0);
+            };
+            auto on_send = [&] (uint32_t id, int rc) {
+                if ( rc < 0 ) {  // a failed send cancels the sends linked after it
+                    for ( size_t i = parts[id].first, n = i + parts[id].ops; i < n; ++i ) {
+                        in_flight -= (_results[i] == NL_BATCH_PENDING);
+                        _results[i] = (_results[i] == NL_BATCH_PENDING) ? rc : _results[i];
+                    }
+                }
+            };
+
+            while ( next < parts.size() or in_flight ) {
+                while ( next < parts.size() and in_flight + parts[next].ops <= NL_URING_BUFS ) {
+                    bool link = (next + 1 < parts.size()) and (in_flight + parts[next].ops + parts[next + 1].ops <= NL_URING_BUFS);
+                    if ( ring.send(parts[next].begin, parts[next].length, next, link) < 0 ) {
+                        break;
+                    }
+                    in_flight += parts[next].ops;
+                    ++next;
+                }
+
+                int rc = ring.wait(NL_BATCH_ACK_TIMEOUT_MS, on_datagram, on_send);
+                if ( ring.take_overrun() ) {  // pick up the ACKs which are still queued
+                    while ( in_flight and ring.wait(0, on_datagram, on_send) > 0 ) {
+                    }
+                    rc = -ENOBUFS;
+                }
+                if ( rc < 0 and in_flight ) {  // ACKs are lost
+                    size_t sent = (next < parts.size()) ? parts[next].first : _results.size();
+                    fail_pending(0, rc, sent);
+                    in_flight = 0;
+                }
+            }
+            return take_results();
+        }
+    };
+
+    /**
+     * @brief
+     * Make-before-break change of an IPv4 route: the same metric is changed in place (NLM_F_REPLACE), a new metric
+     * is added and the route with the old one is deleted only once the kernel has ACKed the new one, so the
+     * destination is always routed. Not one batch: the kernel applies every message of a batch even after a failed
+     * one, a failed replace would still delete the old route
+     * @return "0" - success; ">0" - the first error code absolute value; "<0" - the request hasn't sent error code
+     */
+    inline int
+    request_change_route (const int fd, const in_addr_t dst_addr, const uint8_t masklen, const uint32_t old_metric, const in_addr_t gw,  //
+                          const uint32_t metric = 0, const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN,  //
+                          const uint8_t proto = RTPROT_STATIC)
+    {
+        if ( metric == old_metric ) {
+            return request_replace_route(fd, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        }
+        int rc = request_replace_route(fd, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        if ( rc != 0 ) {
+            return rc;  // the old route is kept
+        }
+        return request_del_route(fd, dst_addr, masklen, old_metric, rtm_table);
+    }
+
+    inline int
+    request_change_route (const int fd, const in6_addr &dst_addr, const uint8_t masklen, const uint32_t old_metric, const in6_addr &gw,  //
+                          const uint32_t metric = 0, const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN,  //
+                          const uint8_t proto = RTPROT_STATIC)
+    {
+        const uint32_t old_priority = old_metric ? old_metric : NL_IP6_RT_PRIO_USER;  // "0" would delete any metric
+        if ( (metric ? metric : NL_IP6_RT_PRIO_USER) == old_priority ) {
+            return request_replace_route(fd, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        }
+        int rc = request_replace_route(fd, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        if ( rc != 0 ) {
+            return rc;
+        }
+        return request_del_route(fd, dst_addr, masklen, old_priority, rtm_table);
+    }
+
+    /**
+     * @brief
+     * Delete every neighbour in one of the states: the tables are dumped and the matching entities are deleted
+     * by one batch. An entity which has gone meanwhile isn't an error
+     * @param states NUD_* mask
+     * @param oif_id "0" - of all the interfaces
+     * @param flushed count of the deleted entities, if not nullptr
+     * @return "0" - success; ">0" - the first error code absolute value; "<0" - -errno of the dump
+     */
+    inline int
+    request_flush_neighbors (const int fd, const uint16_t states, const uint32_t oif_id = 0, size_t *flushed = nullptr)
+    {
+        nl_batch batch;
+        int rc = request_get_neigh_list(
+            fd,
+            [&] (nlmsghdr *nlh) {
+                neigh_event neigh;
+                if ( neigh_event::parse(nlh, neigh) and (neigh.state & states) and (not oif_id or neigh.ifindex == oif_id) ) {
+                    batch.del_neighbor(neigh.family, neigh.addr, neigh.ifindex);
+                }
+            },
+            AF_UNSPEC, oif_id);
+        if ( rc != 0 ) {
+            return rc;
+        }
+
+        size_t count = 0;
+        for ( int result : batch.flush(fd) ) {
+            if ( result == 0 ) {
+                ++count;
+            } else if ( result != ENOENT and result != -EAFNOSUPPORT and rc == 0 ) {  // bridge FDB entries are skipped
+                rc = result;
+            }
+        }
+        if ( flushed ) {
+            *flushed = count;
+        }
+        return rc;
+    }
+
+    /**
+     * @brief
+     * Delete the STALE and FAILED entities of the neighbour tables
+     * @param oif_id "0" - of all the interfaces
+     */
+    inline int
+    request_flush_stale (const int fd, const uint32_t oif_id = 0)
+    {
+        return request_flush_neighbors(fd, NUD_STALE | NUD_FAILED, oif_id);
+    }
+}  // namespace nl_socket_handler
+
+#endif  //PROJECT_NL_BATCH_H
@@ -0,0 +1,335 @@
+#ifndef PROJECT_NL_CORO_H
+#define PROJECT_NL_CORO_H
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "linux_route.h"
+#include "nl_async.h"
+#include "nl_reactor.h"
+
+namespace nl_socket_handler
+{
+    /**
+     * @brief
+     * Lazy coroutine returning T. It starts when it's awaited or by start(), and resumes its awaiter when it finishes.
+     * The task owns the coroutine frame: keep it alive until done()
+     */
+    template <typename T = int>
+    class nl_task
+    {
+       public:
+        struct promise_type
+        {
+            T value                              = {};
+            bool started                         = false;
+            std::coroutine_handle<> continuation = nullptr;
+
+            struct final_awaiter
+            {
+                bool await_ready () noexcept { return false; }
+                std::coroutine_handle<> await_suspend (std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    std::coroutine_handle<> next = handle.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+                void await_resume () noexcept {}
+            };
+
+            nl_task get_return_object () { return nl_task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend () noexcept { return {}; }
+            final_awaiter final_suspend () noexcept { return {}; }
+            void return_value (T result) { value = std::move(result); }
+            void unhandled_exception () { std::terminate(); }  // the library reports errors by return codes
+        };
+
+       private:
+        std::coroutine_handle<promise_type> _handle = nullptr;
+
+        explicit nl_task(std::coroutine_handle<promise_type> handle)
+            : _handle(handle){};
+
+       public:
+        nl_task(nl_task &&other) noexcept
+            : _handle(std::exchange(other._handle, nullptr)){};
+
+        nl_task &operator= (nl_task &&other) noexcept
+        {
+            if ( this != &other ) {
+                if ( _handle ) {
+                    _handle.destroy();
+                }
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        void operator= (nl_task const &) = delete;  // one owner of the frame
+        nl_task(nl_task const &)        = delete;
+
+        ~nl_task()
+        {
+            if ( _handle ) {
+                _handle.destroy();
+            }
+        }
+
+        /**
+         * @brief
+         * Run the coroutine until its first suspension. Does nothing if it has already been started
+         */
+        void start ()
+        {
+            if ( _handle and not _handle.promise().started ) {
+                _handle.promise().started = true;
+                _handle.resume();
+            }
+        }
+
+        bool done () const { return _handle and _handle.done(); }
+        const T &result () const { return _handle.promise().value; }
+
+        bool await_ready () const noexcept { return done(); }
+        std::coroutine_handle<> await_suspend (std::coroutine_handle<> awaiter)
+        {
+            _handle.promise().continuation = awaiter;
+            if ( _handle.promise().started ) {
+                return std::noop_coroutine();  // running already, it resumes us when it finishes
+            }
+            _handle.promise().started = true;
+            return _handle;
+        }
+        T await_resume () { return std::move(_handle.promise().value); }
+    };
+
+    /**
+     * @brief
+     * Coroutine front end of nl_async_engine driven by nl_reactor. Every request is an awaitable:
+     * the coroutine is suspended after the request is queued and is resumed by the reactor loop when its ACK
+     * (NLMSG_DONE for a dump, the reply for a GET) arrives. Requests queued during one loop iteration
+     * are sent together, so one thread can keep thousands of transactions going.
+     * The socket should be opened with SOCK_NONBLOCK and should not be subscribed to multicast groups.
+     * Like the reactor, the context is used only on the loop thread.
+     */
+    class nl_coro_context
+    {
+       public:
+        /**
+         * @brief
+         * Awaitable of one request. co_await returns "0" - success; ">0" - a responce error code absolute value;
+         * "<0" - the request hasn't been sent/answered (-errno)
+         */
+        template <typename F>
+        class request_awaiter
+        {
+            nl_coro_context &_context;
+            F _build;
+            nl_async_engine::message_handler _on_message;
+            int _rc     = 0;
+            bool _ready = false;
+
+           public:
+            request_awaiter(nl_coro_context &context, F build, nl_async_engine::message_handler on_message, const int error = 0)
+                : _context(context), _build(std::move(build)), _on_message(std::move(on_message)), _rc(error), _ready(error != 0){};
+
+            bool await_ready () const noexcept { return _ready; }
+            void await_suspend (std::coroutine_handle<> handle)
+            {
+                // the awaiter lives in the suspended frame, so the completion may point at it
+                _context.submit(std::move(_build), [this, handle] (int rc) {
+                    _rc = rc;
+                    _context._ready.push_back(handle);
+                }, std::move(_on_message));
+            }
+            int await_resume () const noexcept { return _rc; }
+        };
+
+       private:
+        nl_reactor &_reactor;
+        nl_async_engine _engine;
+        size_t _window;
+
+        std::deque<std::function<void()>> _waiting     = {};  // submits which don't fit into the window
+        std::vector<std::coroutine_handle<>> _ready     = {};  // completed requests to resume
+        std::shared_ptr<nl_coro_context *> _self        = std::make_shared<nl_coro_context *>(this);
+        bool _flush_posted                              = false;
+        bool _pumping                                   = false;
+
+        template <typename F>
+        void submit (F build, nl_async_engine::completion done, nl_async_engine::message_handler on_message)
+        {
+            if ( _engine.pending() >= _window or not _waiting.empty() ) {
+                _waiting.push_back([this, build = std::move(build), done = std::move(done), on_message = std::move(on_message)] () mutable {
+                    _engine.submit(build, std::move(done), std::move(on_message));
+                });
+            } else {
+                _engine.submit(build, std::move(done), std::move(on_message));
+            }
+            schedule_pump();
+        }
+
+        /**
+         * @brief
+         * Send the requests queued by the current loop iteration once it's over
+         */
+        void schedule_pump ()
+        {
+            if ( _pumping or _flush_posted ) {
+                return;
+            }
+            _flush_posted = true;
+            std::weak_ptr<nl_coro_context *> self = _self;
+            _reactor.post([self] () {
+                if ( auto context = self.lock() ) {
+                    (*context)->pump();
+                }
+            });
+        }
+
+        /**
+         * @brief
+         * Move waiting requests into the window, send them and resume the completed coroutines
+         * until nothing is left to do. Coroutines are never resumed from inside the engine callbacks
+         */
+        void pump ()
+        {
+            _flush_posted = false;
+            _pumping      = true;
+            while ( true ) {
+                while ( not _waiting.empty() and _engine.pending() < _window ) {
+                    std::function<void()> next = std::move(_waiting.front());
+                    _waiting.pop_front();
+                    next();
+                }
+                _engine.flush();
+                if ( _ready.empty() ) {
+                    break;
+                }
+                std::vector<std::coroutine_handle<>> ready;
+                ready.swap(_ready);
+                for ( std::coroutine_handle<> handle : ready ) {
+                    handle.resume();
+                }
+            }
+            _pumping = false;
+        }
+
+        void on_readable ()
+        {
+            int rc = _engine.poll(0);
+            if ( rc < 0 ) {
+                std::cout << "ERORR! netlink socket: recv() failed, err: " << strerror(-rc) << std::endl;
+            }
+            pump();
+        }
+
+       public:
+        nl_coro_context(nl_reactor &reactor, const int fd, const size_t window = NL_ASYNC_WINDOW)
+            : _reactor(reactor), _engine(fd, window), _window(window ? window : 1)
+        {
+            _reactor.add_fd(fd, [this] () { on_readable(); });
+        };
+
+        ~nl_coro_context()
+        {
+            _reactor.remove_fd(_engine.get_fd());
+        }
+
+        void operator= (nl_coro_context const &) = delete;  // the reactor and the awaiters point to us
+        nl_coro_context(nl_coro_context const &) = delete;
+
+        int get_fd () const { return _engine.get_fd(); }
+        size_t pending () const { return _engine.pending() + _waiting.size(); }
+
+        /**
+         * @brief
+         * Awaitable of any request
+         * @param build build(nl_msg_builder&, uint32_t seq_num) writes exactly one message, it's called after co_await
+         * @param on_message receives every reply message (dump parts, GET reply)
+         */
+        template <typename F>
+        request_awaiter<F> request (F build, nl_async_engine::message_handler on_message = nullptr)
+        {
+            return request_awaiter<F>(*this, std::move(build), std::move(on_message));
+        }
+
+        auto add_route (const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                        const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+        {
+            auto build = [=] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_add_route(msg, seq_num, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+            };
+            return request_awaiter<decltype(build)>(*this, build, nullptr, check_route_args(dst_addr, masklen));
+        }
+
+        auto del_route (const in_addr_t dst_addr, const uint8_t masklen, const uint32_t metric = 0, const uint32_t rtm_table = RT_TABLE_MAIN,  //
+                        const in_addr_t gw = 0, const uint32_t oif_id = NO_SYSTEM_ID)
+        {
+            auto build = [=] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_route(msg, seq_num, RTM_DELROUTE, 0, dst_addr, gw, masklen, metric, oif_id, rtm_table, 0);
+            };
+            return request_awaiter<decltype(build)>(*this, build, nullptr, check_route_args(dst_addr, masklen));
+        }
+
+        auto add_ip_addr (const in_addr_t ip_addr, const uint8_t masklen, const uint32_t system_iface_id)
+        {
+            auto build = [=] (nl_msg_builder &msg, uint32_t seq_num) {
+                build_add_ip_addr(msg, seq_num, ip_addr, masklen, system_iface_id);
+            };
+            int valid = (system_iface_id == NO_SYSTEM_ID or not masklen or masklen >= 32) ? -EINVAL : 0;
+            return request_awaiter<decltype(build)>(*this, build, nullptr, valid);
+        }
+
+        auto updown (const uint32_t system_iface_id, const bool up = true)
+        {
+            return request([=] (nl_msg_builder &msg, uint32_t seq_num) { build_updown(msg, seq_num, system_iface_id, up); });
+        }
+
+        auto create_vrf (const std::string &name, const uint32_t rt_number, const bool up = true)
+        {
+            return request([=] (nl_msg_builder &msg, uint32_t seq_num) { build_create_vrf(msg, seq_num, name, rt_number, up); });
+        }
+
+        auto del_vrf (const int index)
+        {
+            return request([=] (nl_msg_builder &msg, uint32_t seq_num) { build_del_link(msg, seq_num, index); });
+        }
+
+        /**
+         * @brief
+         * Dump the routes of rtm_table into table. co_await returns when NLMSG_DONE has been received
+         */
+        auto dump_routes (const uint32_t rtm_table, linux_routing_table &table)
+        {
+            return request([=] (nl_msg_builder &msg, uint32_t seq_num) { build_get_route_list(msg, seq_num, rtm_table); },
+                           [&table] (nlmsghdr *nlh) {
+                               if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
+                                   table.update(linux_route::parse_route_from_nl_resp_hdr(nlh), false);
+                               }
+                           });
+        }
+
+        /**
+         * @brief
+         * Find an interface into LINUX
+         * @return "0" - the interface has't been found; "uint32_t" - interface index in LINUX
+         */
+        nl_task<uint32_t> search_iface (const std::string name)
+        {
+            uint32_t index = 0;
+            int rc         = co_await request([&name] (nl_msg_builder &msg, uint32_t seq_num) { build_link_state(msg, seq_num, name); },
+                                              [&index] (nlmsghdr *nlh) {
+                                          if ( nlh->nlmsg_type == RTM_NEWLINK ) {
+                                              index = system_iface_id((char *)nlh);
+                                          }
+                                      });
+            co_return (rc == 0) ? index : 0;
+        }
+    };
+}  // namespace nl_socket_handler
+
+#endif  //PROJECT_NL_CORO_H
@@ -0,0 +1,74 @@
+#ifndef PROJECT_NL_EPOCH_H
+#define PROJECT_NL_EPOCH_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#define NL_EPOCH_MAX_READERS 128  // reader threads with their own slot, the others pin every retired object
+
+/**
+ * @brief
+ * Epoch based reclamation for data published by one writer thread and read by any thread without locks.
+ * A reader announces the epoch it has entered in its own slot (one store, no read-modify-write),
+ * the writer frees a retired object once no reader is left in an epoch it could have seen the object in.
+ * Readers never wait for the writer and the writer never waits for readers: it just frees later.
+ * retire()/reclaim() are called only by the writer thread.
+ */
+class nl_epoch
+{
+    struct alignas(64) reader
+    {
+        std::atomic<uint64_t> epoch = 0;  // 0 - out of a read section
+        std::atomic<bool> used      = false;
+    };
+
+    reader _readers[NL_EPOCH_MAX_READERS];
+    std::atomic<uint64_t> _global  = 1;
+    std::atomic<uint32_t> _overflow = 0;  // readers in a read section without a slot
+
+    std::deque<std::pair<uint64_t, std::function<void()>>> _retired = {};  // epoch of retirement to the deleter
+
+    nl_epoch() = default;
+
+    reader *enter ();
+    void leave (reader *slot);
+
+    friend struct nl_epoch_thread;
+
+   public:
+    static nl_epoch &get_instance ()
+    {
+        static nl_epoch instance;
+        return instance;
+    }
+
+    void operator= (nl_epoch const &) = delete;
+    nl_epoch(nl_epoch const &)        = delete;
+
+    /**
+     * @brief
+     * Read section: pointers loaded from published data stay valid until the guard is destroyed.
+     * Guards may be nested
+     */
+    class guard
+    {
+        reader *_slot = nullptr;
+
+       public:
+        guard()
+            : _slot(get_instance().enter()){};
+        ~guard() { get_instance().leave(_slot); }
+
+        void operator= (guard const &) = delete;
+        guard(guard const &)          = delete;
+    };
+
+    void retire (std::function<void()> deleter);
+    size_t reclaim ();
+    size_t pending () const { return _retired.size(); }
+};
+
+#endif  // PROJECT_NL_EPOCH_H
@@ -0,0 +1,222 @@
+#ifndef PROJECT_NL_EVENTS_H
+#define PROJECT_NL_EVENTS_H
+
+#include <string.h>
+#include <algorithm>
+#include <stdint.h>
+
+#include <linux/if_addr.h>
+#include <linux/if_link.h>
+#include <linux/neighbour.h>
+#include <linux/nexthop.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#define NL_NEXTHOP_GROUP_MAX 64  // members kept by nexthop_event, the rest of a bigger group is dropped
+
+/**
+ * @brief
+ * RTM_NEWLINK/RTM_DELLINK parsed into a fixed size struct (no allocation)
+ */
+struct link_event
+{
+    bool deleted           = false;
+    uint32_t ifindex       = 0;
+    uint32_t flags         = 0;  // ifi_flags
+    uint32_t master        = 0;  // IFLA_MASTER (VRF index)
+    char name[IFNAMSIZ]    = {0};
+    char kind[IFNAMSIZ]    = {0};  // IFLA_INFO_KIND ("vrf", "tun" ...)
+    uint32_t vrf_table     = 0;    // IFLA_VRF_TABLE if kind is "vrf"
+
+    static bool parse (const nlmsghdr *nlh, link_event &event)
+    {
+        if ( nlh->nlmsg_type != RTM_NEWLINK and nlh->nlmsg_type != RTM_DELLINK ) {
+            return false;
+        }
+        event             = link_event();
+        const ifinfomsg *info = (const ifinfomsg *)NLMSG_DATA(nlh);
+        event.deleted     = (nlh->nlmsg_type == RTM_DELLINK);
+        event.ifindex     = info->ifi_index;
+        event.flags       = info->ifi_flags;
+
+        int len = IFLA_PAYLOAD(nlh);
+        for ( rtattr *attr = IFLA_RTA(info); RTA_OK(attr, len); attr = RTA_NEXT(attr, len) ) {
+            if ( attr->rta_type == IFLA_IFNAME ) {
+                strncpy(event.name, (const char *)RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), IFNAMSIZ - 1));
+                continue;
+            }
+            if ( attr->rta_type == IFLA_MASTER ) {
+                event.master = *(uint32_t *)RTA_DATA(attr);
+                continue;
+            }
+            if ( attr->rta_type == IFLA_LINKINFO ) {
+                parse_linkinfo(attr, event);
+                continue;
+            }
+        }
+        return true;
+    }
+
+   private:
+    static void parse_linkinfo (rtattr *linkinfo, link_event &event)
+    {
+        int len = RTA_PAYLOAD(linkinfo);
+        for ( rtattr *attr = (rtattr *)RTA_DATA(linkinfo); RTA_OK(attr, len); attr = RTA_NEXT(attr, len) ) {
+            if ( attr->rta_type == IFLA_INFO_KIND ) {
+                strncpy(event.kind, (const char *)RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), IFNAMSIZ - 1));
+                continue;
+            }
+            if ( attr->rta_type == IFLA_INFO_DATA ) {
+                int data_len = RTA_PAYLOAD(attr);
+                for ( rtattr *data = (rtattr *)RTA_DATA(attr); RTA_OK(data, data_len); data = RTA_NEXT(data, data_len) ) {
+                    if ( data->rta_type == IFLA_VRF_TABLE ) {
+                        event.vrf_table = *(uint32_t *)RTA_DATA(data);
+                    }
+                }
+            }
+        }
+        if ( strcmp(event.kind, "vrf") != 0 ) {
+            event.vrf_table = 0;
+        }
+    }
+};
+
+/**
+ * @brief
+ * RTM_NEWADDR/RTM_DELADDR parsed into a fixed size struct
+ */
+struct addr_event
+{
+    bool deleted       = false;
+    uint32_t ifindex   = 0;
+    uint8_t family     = AF_UNSPEC;
+    uint8_t prefixlen  = 0;
+    uint8_t addr[16]   = {0};  // IFA_LOCAL (IFA_ADDRESS if there is no IFA_LOCAL)
+
+    static bool parse (const nlmsghdr *nlh, addr_event &event)
+    {
+        if ( nlh->nlmsg_type != RTM_NEWADDR and nlh->nlmsg_type != RTM_DELADDR ) {
+            return false;
+        }
+        event                  = addr_event();
+        const ifaddrmsg *info  = (const ifaddrmsg *)NLMSG_DATA(nlh);
+        event.deleted          = (nlh->nlmsg_type == RTM_DELADDR);
+        event.ifindex          = info->ifa_index;
+        event.family           = info->ifa_family;
+        event.prefixlen        = info->ifa_prefixlen;
+
+        bool has_local = false;
+        int len        = IFA_PAYLOAD(nlh);
+        for ( rtattr *attr = IFA_RTA(info); RTA_OK(attr, len); attr = RTA_NEXT(attr, len) ) {
+            if ( (attr->rta_type == IFA_LOCAL) or (attr->rta_type == IFA_ADDRESS and not has_local) ) {
+                memcpy(event.addr, RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), sizeof(event.addr)));
+                has_local |= (attr->rta_type == IFA_LOCAL);
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief
+ * RTM_NEWNEIGH/RTM_DELNEIGH parsed into a fixed size struct
+ */
+struct neigh_event
+{
+    bool deleted       = false;
+    uint32_t ifindex   = 0;
+    uint8_t family     = AF_UNSPEC;
+    uint16_t state     = 0;  // NUD_*
+    uint8_t flags      = 0;  // NTF_*
+    uint8_t addr[16]   = {0};
+    uint8_t lladdr[6]  = {0};
+    bool has_lladdr    = false;
+
+    static bool parse (const nlmsghdr *nlh, neigh_event &event)
+    {
+        if ( nlh->nlmsg_type != RTM_NEWNEIGH and nlh->nlmsg_type != RTM_DELNEIGH ) {
+            return false;
+        }
+        event              = neigh_event();
+        const ndmsg *info  = (const ndmsg *)NLMSG_DATA(nlh);
+        event.deleted      = (nlh->nlmsg_type == RTM_DELNEIGH);
+        event.ifindex      = info->ndm_ifindex;
+        event.family       = info->ndm_family;
+        event.state        = info->ndm_state;
+        event.flags        = info->ndm_flags;
+
+        int len = RTM_PAYLOAD(nlh);
+        for ( rtattr *attr = (rtattr *)((char *)info + NLMSG_ALIGN(sizeof(ndmsg))); RTA_OK(attr, len); attr = RTA_NEXT(attr, len) ) {
+            if ( attr->rta_type == NDA_DST ) {
+                memcpy(event.addr, RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), sizeof(event.addr)));
+                continue;
+            }
+            if ( attr->rta_type == NDA_LLADDR and RTA_PAYLOAD(attr) == sizeof(event.lladdr) ) {
+                memcpy(event.lladdr, RTA_DATA(attr), sizeof(event.lladdr));
+                event.has_lladdr = true;
+                continue;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief
+ * RTM_NEWNEXTHOP/RTM_DELNEXTHOP parsed into a fixed size struct: a single nexthop (gateway and/or oif, or blackhole)
+ * or a group of the nexthop ids with their weights
+ */
+struct nexthop_event
+{
+    bool deleted        = false;
+    uint32_t id         = 0;  // NHA_ID
+    uint8_t family      = AF_UNSPEC;
+    uint8_t proto       = 0;
+    uint32_t oif        = 0;
+    uint8_t gw[16]      = {0};
+    bool has_gw         = false;
+    bool blackhole      = false;
+    uint16_t group_size = 0;
+    nexthop_grp group[NL_NEXTHOP_GROUP_MAX] = {};
+
+    bool is_group () const { return group_size != 0; }
+
+    static bool parse (const nlmsghdr *nlh, nexthop_event &event)
+    {
+        if ( nlh->nlmsg_type != RTM_NEWNEXTHOP and nlh->nlmsg_type != RTM_DELNEXTHOP ) {
+            return false;
+        }
+        event              = nexthop_event();
+        const nhmsg *info  = (const nhmsg *)NLMSG_DATA(nlh);
+        event.deleted      = (nlh->nlmsg_type == RTM_DELNEXTHOP);
+        event.family       = info->nh_family;
+        event.proto        = info->nh_protocol;
+
+        int len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(nhmsg));
+        for ( rtattr *attr = (rtattr *)((char *)info + NLMSG_ALIGN(sizeof(nhmsg))); RTA_OK(attr, len); attr = RTA_NEXT(attr, len) ) {
+            switch ( attr->rta_type ) {
+                case NHA_ID:
+                    event.id = *(uint32_t *)RTA_DATA(attr);
+                    break;
+                case NHA_OIF:
+                    event.oif = *(uint32_t *)RTA_DATA(attr);
+                    break;
+                case NHA_GATEWAY:
+                    memcpy(event.gw, RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), sizeof(event.gw)));
+                    event.has_gw = true;
+                    break;
+                case NHA_BLACKHOLE:
+                    event.blackhole = true;
+                    break;
+                case NHA_GROUP:
+                    event.group_size = std::min<size_t>(RTA_PAYLOAD(attr) / sizeof(nexthop_grp), NL_NEXTHOP_GROUP_MAX);
+                    memcpy(event.group, RTA_DATA(attr), event.group_size * sizeof(nexthop_grp));
+                    break;
+            }
+        }
+        return true;
+    }
+};
+
+#endif  //PROJECT_NL_EVENTS_H
@@ -0,0 +1,68 @@
+#ifndef PROJECT_NL_HUB_H
+#define PROJECT_NL_HUB_H
+
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nl_reactor.h"
+
+#define NL_HUB_REQUEST_SOCKETS 4  // request sockets shared by all the interfaces
+
+/**
+ * @brief
+ * Process-wide netlink listener: one socket subscribed to the link, address and route groups instead of one
+ * per interface, so the kernel copies every event once and nothing is queued into sockets nobody reads.
+ * The events are demultiplexed to subscribers by ifindex (route by its oif). Requests go through a small pool
+ * of sockets which aren't subscribed to anything. Everything is called on one thread (the reactor loop thread
+ * if the hub is attached)
+ */
+class nl_hub
+{
+    using subscription = std::pair<uint64_t, std::shared_ptr<nl_event_handlers>>;
+
+    int _fd                     = -1;
+    int _requests[NL_HUB_REQUEST_SOCKETS];
+    size_t _next_request        = 0;
+    nl_reactor *_reactor        = nullptr;
+    size_t _attached            = 0;  // attach() calls not detached yet, the subscriptions don't keep the reactor
+    nl_event_handlers _handlers = {};  // demultiplexer
+
+    std::unordered_map<uint32_t, std::vector<subscription>> _subscribers = {};  // ifindex to its subscribers
+    std::unordered_map<uint64_t, uint32_t> _ifindex                      = {};  // subscription id to its ifindex
+    uint64_t _last_id                                                    = 0;
+    size_t _overruns                                                     = 0;
+    uint32_t _dispatching                                                = 0;  // a subscriber is being called
+
+    nl_hub();
+    ~nl_hub();
+
+    template <typename F>
+    void for_each_subscriber (const uint32_t ifindex, F on_handlers);
+
+   public:
+    static nl_hub &get_instance ()
+    {
+        static nl_hub instance;
+        return instance;
+    }
+
+    void operator= (nl_hub const &) = delete;  // we won't copy file descripors
+    nl_hub(nl_hub const &)          = delete;
+
+    int get_fd () const { return _fd; }
+    int request_socket ();
+    size_t overruns () const { return _overruns; }
+    size_t size () const { return _ifindex.size(); }
+
+    uint64_t subscribe (const uint32_t ifindex, nl_event_handlers handlers);
+    bool unsubscribe (const uint64_t id);
+
+    int attach (nl_reactor &reactor);
+    int detach (nl_reactor &reactor);
+    int poll ();
+};
+
+#endif  // PROJECT_NL_HUB_H
@@ -0,0 +1,238 @@
+#ifndef PROJECT_NL_MSG_BUILDER_H
+#define PROJECT_NL_MSG_BUILDER_H
+
+#include <string.h>
+#include <stdint.h>
+#include <string>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#define NL_MSG_BUILDER_BUF_SIZE 4096
+
+namespace nl_socket_handler
+{
+    /**
+     * @brief
+     * Writes netlink messages into a caller-owned buffer without any heap allocation.
+     * Several messages may be written one after another (they are NLMSG_ALIGN'ed), so the same
+     * builder is used for single requests and for batches.
+     * Nested attributes are opened with nest_begin() and their length is back-patched by nest_end().
+     * If the buffer is too small the builder stops writing and overflow() returns true.
+     */
+    class nl_msg_builder
+    {
+        char *_buf       = nullptr;
+        size_t _capacity = 0;
+        size_t _size     = 0;  // bytes used by all the finished messages and the current one
+        size_t _msg_off  = 0;  // offset of the current message header
+        bool _overflow   = false;
+
+        char *reserve (size_t length)
+        {
+            if ( _overflow or (_size + length > _capacity) ) {
+                _overflow = true;
+                return nullptr;
+            }
+            char *ptr = _buf + _size;
+            memset(ptr, 0, length);
+            _size += length;
+            return ptr;
+        }
+
+       public:
+        nl_msg_builder(char *buf, size_t capacity)
+            : _buf(buf), _capacity(capacity) {};
+
+        template <size_t N>
+        explicit nl_msg_builder(char (&buf)[N])
+            : _buf(buf), _capacity(N) {};
+
+        void operator= (nl_msg_builder const &) = delete;  // the builder doesn't own the buffer
+        nl_msg_builder(nl_msg_builder const &)  = delete;
+
+        /**
+         * @brief
+         * Drop all the written messages. The buffer is reused as is.
+         */
+        void reset ()
+        {
+            _size     = 0;
+            _msg_off  = 0;
+            _overflow = false;
+        }
+
+        /**
+         * @brief
+         * Start a new message right after the previous one
+         * @return nlmsghdr* pointer to the header or nullptr if there is no room
+         */
+        nlmsghdr *begin_msg (const uint16_t type, const uint16_t flags, const uint32_t seq_num)
+        {
+            _msg_off       = _size;
+            size_t aligned = NLMSG_ALIGN(_size);
+            if ( aligned != _size and not reserve(aligned - _size) ) {
+                return nullptr;
+            }
+            _msg_off      = _size;
+            nlmsghdr *hdr = (nlmsghdr *)reserve(NLMSG_HDRLEN);
+            if ( not hdr ) {
+                return nullptr;
+            }
+            hdr->nlmsg_type  = type;
+            hdr->nlmsg_flags = flags;
+            hdr->nlmsg_seq   = seq_num;
+            hdr->nlmsg_len   = NLMSG_HDRLEN;
+            return hdr;
+        }
+
+        /**
+         * @brief
+         * Reserve a zeroed family header (ifinfomsg, rtmsg, ndmsg ...) right after nlmsghdr
+         */
+        template <typename T>
+        T *put_header ()
+        {
+            return (T *)reserve(NLMSG_ALIGN(sizeof(T)));
+        }
+
+        bool add_attr (const uint16_t type, const void *data, const size_t length)
+        {
+            rtattr *attr = (rtattr *)reserve(RTA_SPACE(length));
+            if ( not attr ) {
+                return false;
+            }
+            attr->rta_len  = RTA_LENGTH(length);
+            attr->rta_type = type;
+            if ( length ) {
+                memcpy(RTA_DATA(attr), data, length);
+            }
+            return true;
+        }
+
+        template <typename T>
+        bool add_attr (const uint16_t type, const T &data)
+        {
+            return add_attr(type, &data, sizeof(T));
+        }
+
+        /**
+         * @brief
+         * Add a string attribute without the trailing zero (as the request functions always did)
+         */
+        bool add_str (const uint16_t type, const std::string &str)
+        {
+            return add_attr(type, str.c_str(), str.size());
+        }
+
+        /**
+         * @brief
+         * Open a nested attribute (IFLA_LINKINFO, IFLA_INFO_DATA ...)
+         * @return size_t offset of the nested attribute. Pass it to nest_end()
+         */
+        size_t nest_begin (const uint16_t type)
+        {
+            size_t offset = _size;
+            rtattr *attr  = (rtattr *)reserve(RTA_LENGTH(0));
+            if ( attr ) {
+                attr->rta_type = type;
+            }
+            return offset;
+        }
+
+        /**
+         * @brief
+         * Back-patch the length of the nested attribute opened by nest_begin()
+         */
+        void nest_end (const size_t offset)
+        {
+            if ( _overflow ) {
+                return;
+            }
+            ((rtattr *)(_buf + offset))->rta_len = _size - offset;
+        }
+
+        /**
+         * @brief
+         * Open an rtnexthop inside RTA_MULTIPATH, its attributes (RTA_GATEWAY ...) follow it
+         * @param hops weight minus one
+         * @return size_t offset of the rtnexthop. Pass it to rtnh_end()
+         */
+        size_t rtnh_begin (const uint32_t ifindex, const uint8_t hops)
+        {
+            size_t offset   = _size;
+            rtnexthop *rtnh = (rtnexthop *)reserve(RTNH_ALIGN(sizeof(rtnexthop)));
+            if ( rtnh ) {
+                rtnh->rtnh_ifindex = ifindex;
+                rtnh->rtnh_hops    = hops;
+            }
+            return offset;
+        }
+
+        void rtnh_end (const size_t offset)
+        {
+            if ( _overflow ) {
+                return;
+            }
+            ((rtnexthop *)(_buf + offset))->rtnh_len = _size - offset;
+        }
+
+        /**
+         * @brief
+         * Finish the current message: back-patch nlmsg_len
+         * @return size_t length of the message (0 if the buffer was too small)
+         */
+        size_t end_msg ()
+        {
+            if ( _overflow ) {
+                return 0;
+            }
+            nlmsghdr *hdr   = (nlmsghdr *)(_buf + _msg_off);
+            hdr->nlmsg_len  = _size - _msg_off;
+            return hdr->nlmsg_len;
+        }
+
+        /**
+         * @brief
+         * Roll back the current (unfinished or just finished) message
+         */
+        void drop_msg ()
+        {
+            _size     = _msg_off;
+            _overflow = false;
+        }
+
+        /**
+         * @brief
+         * Move the builder onto another buffer which already contains the written bytes (after growing it)
+         */
+        void rebind (char *buf, const size_t capacity)
+        {
+            _buf      = buf;
+            _capacity = capacity;
+        }
+
+        nlmsghdr *msg () const { return (nlmsghdr *)(_buf + _msg_off); }
+        char *data () const { return _buf; }
+        size_t size () const { return _size; }
+        size_t capacity () const { return _capacity; }
+        bool overflow () const { return _overflow; }
+        bool empty () const { return _size == 0; }
+    };
+
+    /**
+     * @brief
+     * Per-thread builder for single requests. It is reset on every call, so a message built with it
+     * has to be sent before the next call on the same thread.
+     */
+    inline nl_msg_builder &
+    local_msg_builder ()
+    {
+        alignas(8) static thread_local char buf[NL_MSG_BUILDER_BUF_SIZE];
+        static thread_local nl_msg_builder builder(buf);
+        builder.reset();
+        return builder;
+    }
+}  // namespace nl_socket_handler
+
+#endif  //PROJECT_NL_MSG_BUILDER_H
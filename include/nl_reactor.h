@@ -0,0 +1,83 @@
+#ifndef PROJECT_NL_REACTOR_H
+#define PROJECT_NL_REACTOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "linux_route.h"
+#include "nl_events.h"
+
+#define NL_REACTOR_MAX_EVENTS   64
+
+/**
+ * @brief
+ * Handlers for one netlink socket. Every handler is optional; messages of a type without a handler are dropped.
+ */
+struct nl_event_handlers
+{
+    std::function<void(const linux_route &)> on_route     = nullptr;
+    std::function<void(const link_event &)> on_link       = nullptr;
+    std::function<void(const addr_event &)> on_addr       = nullptr;
+    std::function<void(const neigh_event &)> on_neigh     = nullptr;
+    std::function<void(const nexthop_event &)> on_nexthop = nullptr;
+    std::function<void(nlmsghdr *)> on_message            = nullptr;  // any other message type
+    std::function<void()> on_overrun                      = nullptr;  // ENOBUFS: some notifications are lost
+};
+
+/**
+ * @brief
+ * epoll based event loop for netlink sockets. Registered sockets are edge-triggered: on wakeup
+ * every socket is drained until EAGAIN (recvmmsg() batches, see drain_notifications()) and every message
+ * of every datagram is parsed and dispatched in one pass.
+ * An eventfd wakes the loop up for stop() and for tasks posted from other threads.
+ * Everything except post(), wakeup() and stop() has to be called on the loop thread.
+ */
+class nl_reactor
+{
+    int _epoll_fd = -1;
+    int _event_fd = -1;
+    std::atomic<bool> _stopped = false;
+
+    std::unordered_map<int, std::shared_ptr<nl_event_handlers>> _sockets = {};  // fd to its handlers
+    std::unordered_map<int, std::shared_ptr<std::function<void()>>> _fds = {};  // fds read by their owners
+
+    std::mutex _tasks_mutex;
+    std::vector<std::function<void()>> _tasks = {};
+
+    size_t _overruns = 0;
+
+    void drain (const int fd);
+    void run_tasks ();
+
+   public:
+    nl_reactor();
+    ~nl_reactor();
+
+    void operator= (nl_reactor const &) = delete;  // we won't copy file descripors
+    nl_reactor(nl_reactor const &)      = delete;
+
+    static void dispatch (nlmsghdr *nlh, const nl_event_handlers &handlers);  // parse the message and call its handler
+
+    bool is_open () const { return _epoll_fd >= 0 and _event_fd >= 0; }
+    size_t overruns () const { return _overruns; }
+
+    int add_socket (const int fd, nl_event_handlers handlers);
+    int remove_socket (const int fd);
+    int add_fd (const int fd, std::function<void()> on_ready);
+    int remove_fd (const int fd);
+
+    int run_once (const int timeout_ms = -1);
+    void run ();
+    void stop ();
+    void wakeup ();
+    void post (std::function<void()> task);
+};
+
+#endif  //PROJECT_NL_REACTOR_H
@@ -1,8 +1,11 @@
 #ifndef PROJECT_NL_SOCK_HANDL_H
 #define PROJECT_NL_SOCK_HANDL_H
 
+#include <algorithm>
 #include <string.h>
 #include <iostream>
+#include <deque>
+#include <functional>
 #include <vector>
 #include <atomic>
 
@@ -10,12 +13,24 @@
 #include <linux/if_link.h>
 #include <linux/rtnetlink.h>
 #include <linux/neighbour.h>
+#include <linux/nexthop.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <arpa/inet.h>
 #include <net/if.h>
 
+#include "nl_events.h"
+#include "nl_msg_builder.h"
+#include "route_multipath.h"
+
 #define BUF_SIZE 4096
+#define NL_DUMP_BUF_SIZE (32 * 1024)  // bigger than NLMSG_GOODSIZE, so a dump part always fits
+#define NL_DUMP_TIMEOUT_MS 1000
+#define NL_DRAIN_BATCH 16                     // datagrams per recvmmsg() of drain_notifications()
+#define NL_DRAIN_DGRAM_SIZE NL_DUMP_BUF_SIZE  // a dump part may come into a notification socket as well
+#define NL_NOTIFY_RCVBUF (8 << 20)            // receive buffer of the notification sockets, a burst of ~10K route events
 
 #define WRONG_MSG -1
 #define NO_ATTR_IN_MSG -2
@@ -25,7 +40,7 @@
 #define ALL -1u
 namespace nl_socket_handler
 {
-    static std::atomic<uint32_t> a_seq_num = 0;
+    inline std::atomic<uint32_t> a_seq_num = 0;  // one sequence space for all the translation units
 
     enum return_code {
         nlmsg_type_err       = -1,
@@ -113,6 +128,20 @@ namespace nl_socket_handler
         return "rc_to_str_failed";
     }
 
+    /**
+     * @brief
+     * Get the error code of an NLMSG_ERROR message (ACK)
+     * @return int "0" - success (pure ACK); "int" - error code absolute value
+     */
+    inline int
+    get_ack_code (const nlmsghdr *hdr)
+    {
+        if ( hdr->nlmsg_len < NLMSG_LENGTH(sizeof(int)) ) {
+            return EBADMSG;
+        }
+        return -((const nlmsgerr *)NLMSG_DATA(hdr))->error;  // real code is negative defines are positive
+    }
+
     inline bool
     is_multipart_message (char *response_buf)
     {
@@ -152,6 +181,80 @@ namespace nl_socket_handler
         return return_code::rtattr_type_err;
     }
 
+    /**
+     * @brief
+     * Open a netlink socket for requests only (not subscribed to any multicast group),
+     * so ACKs don't compete with notifications for the receive buffer
+     * @param flags additional socket() type flags (SOCK_NONBLOCK)
+     * @return int - socket fd; "-1" - error
+     */
+    inline int
+    open_request_socket (const int flags = 0)
+    {
+        int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | flags, NETLINK_ROUTE);
+        if ( fd == -1 ) {
+            std::cout << "ERORR! netlink socket: socket() failed, err: " << strerror(errno) << std::endl;
+            return -1;
+        }
+
+        int optval = 1;  // Enable kernel filtering
+        setsockopt(fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &optval, sizeof(optval));
+
+        sockaddr_nl nl_addr = {};
+        nl_addr.nl_family   = AF_NETLINK;
+        if ( bind(fd, (sockaddr *)&nl_addr, sizeof(nl_addr)) < 0 ) {
+            std::cout << "ERORR! netlink socket: bind() failed, err: " << strerror(errno) << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * @brief
+     * Size the receive buffer of a notification socket. SO_RCVBUFFORCE passes over net.core.rmem_max
+     * if the process has CAP_NET_ADMIN, SO_RCVBUF (capped by rmem_max) is the fallback
+     * @return int - the buffer size the kernel has set; "-errno" - error
+     */
+    inline int
+    set_rcvbuf (const int fd, const int size = NL_NOTIFY_RCVBUF)
+    {
+        if ( setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) < 0 and
+             setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0 ) {
+            return -errno;
+        }
+        int actual       = 0;
+        socklen_t length = sizeof(actual);
+        if ( getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &actual, &length) < 0 ) {
+            return -errno;
+        }
+        return actual;
+    }
+
+    /**
+     * @brief
+     * Send all the messages written into the builder
+     * @return int - send() result, "-1" with errno == EMSGSIZE if the builder ran out of room
+     */
+    inline int
+    send_msg (const int fd, const nl_msg_builder &msg)
+    {
+        if ( msg.overflow() ) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        return send(fd, msg.data(), msg.size(), 0);
+    }
+
+    inline void
+    build_link_state (nl_msg_builder &msg, const uint32_t seq_num, const std::string &interface_name)
+    {
+        msg.begin_msg(RTM_GETLINK, NLM_F_REQUEST, seq_num);
+        msg.put_header<ifinfomsg>();
+        msg.add_str(IFLA_IFNAME, interface_name);
+        msg.end_msg();
+    }
+
     /**
      * @brief 
      * Send request to get info adout linux interfase
@@ -164,25 +267,11 @@ namespace nl_socket_handler
     ask_link_state (const int fd, std::string interface_name)
     {
         uint32_t seq_num = ++a_seq_num;
-        size_t msg_size     = sizeof(nlmsghdr) + sizeof(ifinfomsg)  //
-                       + RTA_SPACE(interface_name.size());       // IFLA_IFNAME
-
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size);
 
-        nlmsghdr message_header;
-        message_header.nlmsg_type = RTM_GETLINK;
-        message_header.nlmsg_len  = msg_size;
-        message_header.nlmsg_flags = NLM_F_REQUEST;
-        message_header.nlmsg_seq   = seq_num;
-        memcpy(msg_buf, &message_header, sizeof(nlmsghdr));
-        msg_buf += sizeof(nlmsghdr) + sizeof(ifinfomsg);
+        nl_msg_builder &msg = local_msg_builder();
+        build_link_state(msg, seq_num, interface_name);
 
-        msg_buf = fill_in_attr<const char(&)>(msg_buf, IFLA_IFNAME, *interface_name.c_str(), interface_name.size());
-
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! netlink socket: send() failed, err: " << strerror(errno) << std::endl;
             return -1;
@@ -214,6 +303,21 @@ namespace nl_socket_handler
         return number_of_ones;
     }
 
+    inline void
+    build_updown (nl_msg_builder &msg, const uint32_t seq_num, unsigned int system_iface_id, bool up = true)
+    {
+        msg.begin_msg(RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+
+        ifinfomsg *info = msg.put_header<ifinfomsg>();
+        if ( info ) {
+            info->ifi_index  = system_iface_id;
+            info->ifi_flags  = (up ? IFF_UP | IFF_RUNNING : 0);
+            info->ifi_change = IFF_UP | IFF_RUNNING;
+            info->ifi_family = AF_UNSPEC;
+        }
+        msg.end_msg();
+    }
+
     inline int
     request_updown (const int fd, unsigned int system_iface_id, bool up = true)
     {
@@ -222,30 +326,11 @@ namespace nl_socket_handler
             std::cout << "system id is not set" << std::endl;
             return -1;
         }
-        size_t msg_size  = sizeof(nlmsghdr) + sizeof(ifinfomsg);
-        char *msg_buf = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header   = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len  = msg_size;
-        nl_message_header->nlmsg_type = RTM_NEWLINK;
-        nl_message_header->nlmsg_flags |= NLM_F_REQUEST;
-        nl_message_header->nlmsg_flags |= NLM_F_ACK;
-        nl_message_header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ifinfomsg *info = (ifinfomsg *)msg_buf;
-        memset(msg_buf, 0, sizeof(ifinfomsg));
-
-        info->ifi_index = system_iface_id;
-        info->ifi_flags  = (up ? IFF_UP | IFF_RUNNING : 0);
-        info->ifi_change = IFF_UP | IFF_RUNNING;
-        info->ifi_family = AF_UNSPEC;
-        msg_buf += sizeof(ifinfomsg);
-
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+
+        nl_msg_builder &msg = local_msg_builder();
+        build_updown(msg, seq_num, system_iface_id, up);
+
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! send() failed, err: " << strerror(errno) << std::endl;
             return -1;
@@ -281,9 +366,7 @@ namespace nl_socket_handler
             iterator = nl_sock_resp_buf;
             if ( _seq == seq_num ) {
                 if ( ((nlmsghdr *)iterator)->nlmsg_type == NLMSG_ERROR ) {
-                    int code = *(int *)(iterator + sizeof(nlmsghdr));
-                    return -code;  // real code is negative defines are positive
-                    // errno-base.h
+                    return get_ack_code((nlmsghdr *)iterator);  // errno-base.h
                 }
             }
         }
@@ -291,9 +374,87 @@ namespace nl_socket_handler
         return -1;
     }
 
+    /**
+     * @brief
+     * Send one request and wait for its ACK. build(nl_msg_builder&, uint32_t seq_num) writes exactly one message
+     * with NLM_F_ACK. The synchronous request_* functions are this one round trip around the same builders
+     * nl_batch, nl_async_engine and nl_task send pipelined
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code, -EMSGSIZE if the message didn't fit the builder;
+     */
+    template <typename F>
+    inline int
+    request_ack (const int fd, F &&build)
+    {
+        uint32_t seq_num = ++a_seq_num;
+
+        nl_msg_builder &msg = local_msg_builder();
+        build(msg, seq_num);
+        if ( msg.overflow() ) {
+            return -EMSGSIZE;
+        }
+
+        auto rc = send_msg(fd, msg);
+        if ( rc == -1 ) {
+            return -EBUSY;
+        }
+        return recv_response(fd, seq_num);
+    }
+
+    /**
+     * @brief
+     * Receive a dump into a reusable per-thread buffer and pass every message of the request to the visitor
+     * as soon as its datagram arrives. Nothing is copied or accumulated, so the memory doesn't grow with the dump.
+     * A message is valid only inside the visitor call
+     * @param fd netlink socket fd (blocking or not)
+     * @param seq_num sequence number of the request
+     * @param on_message visitor of the reply messages (NLMSG_DONE and NLMSG_ERROR aren't passed)
+     * @return "0" - success;
+     * @return "int" - error code absolute value;
+     * @return "<0" - -errno of recv()/poll(), "-ETIMEDOUT" - no reply for NL_DUMP_TIMEOUT_MS
+     */
+    inline int
+    recv_dump (const int fd, const uint32_t seq_num, const std::function<void(nlmsghdr *)> &on_message)
+    {
+        alignas(8) static thread_local char buf[NL_DUMP_BUF_SIZE];
+
+        while ( true ) {
+            ssize_t msg_size = recv(fd, buf, NL_DUMP_BUF_SIZE, 0);
+            if ( msg_size < 0 ) {
+                if ( errno == EINTR or errno == ENOBUFS ) {  // a dump is flow controlled, the rest of it is still queued
+                    continue;
+                }
+                if ( errno != EAGAIN and errno != EWOULDBLOCK ) {
+                    return -errno;
+                }
+                pollfd pfd = {fd, POLLIN, 0};
+                int rc     = poll(&pfd, 1, NL_DUMP_TIMEOUT_MS);
+                if ( rc <= 0 ) {
+                    return rc ? -errno : -ETIMEDOUT;
+                }
+                continue;
+            }
+
+            nlmsghdr *nlh = (nlmsghdr *)buf;
+            for ( ; NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+                if ( nlh->nlmsg_seq != seq_num ) {
+                    continue;
+                }
+                if ( nlh->nlmsg_type == NLMSG_DONE ) {
+                    return 0;
+                }
+                if ( nlh->nlmsg_type == NLMSG_ERROR ) {
+                    return get_ack_code(nlh);
+                }
+                on_message(nlh);
+            }
+        }
+    }
+
    /**
     * @brief 
-    * 
+    * Receive a dump and copy its messages into one buffer. Prefer the streaming recv_dump() with a visitor
     * @param fd netlink socket fd
     * @param seq_num sequence number of the request
     * @param result pointer to an allocated memory for the dump
@@ -304,40 +465,116 @@ namespace nl_socket_handler
     inline int
     recv_dump (const int fd, const uint32_t seq_num, char *&result, size_t result_allocated_size)
     {
-        char nl_sock_resp_buf[BUF_SIZE] = {0};
-        int msg_size = 0;
-        uint32_t _seq    = 0;
-        int length    = 0;
+        int length = 0;
+        int rc     = recv_dump(fd, seq_num, [&] (nlmsghdr *nlh) {
+            size_t msg_size = NLMSG_ALIGN(nlh->nlmsg_len);
+            if ( (size_t)length + msg_size > result_allocated_size ) {
+                result_allocated_size = std::max(result_allocated_size << 1, length + msg_size);
+                char *concat          = new char[result_allocated_size];
+                memcpy(concat, result, length);
+                delete[] result;
+                result = concat;
+            }
+            memcpy(result + length, nlh, msg_size);
+            length += msg_size;
+        });
+        if ( rc < 0 ) {
+            return -1;
+        }
+        return rc ? 0 : length;
+    }
 
-        while ( 1 ) {
-            // msg_size = recv(fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
-            msg_size = recv(fd, nl_sock_resp_buf, BUF_SIZE, 0);
-            if ( msg_size < 0 ) {
-                return -1;
+    /**
+     * @brief
+     * Send a dump request and stream its reply to the visitor, see recv_dump()
+     * @param build build(nl_msg_builder&, uint32_t seq_num) writes the request
+     */
+    template <typename F>
+    int
+    request_dump (const int fd, F &&build, const std::function<void(nlmsghdr *)> &on_message)
+    {
+        uint32_t seq_num = ++a_seq_num;
+
+        nl_msg_builder &msg = local_msg_builder();
+        build(msg, seq_num);
+        if ( msg.overflow() ) {
+            return -EMSGSIZE;
+        }
+        if ( send_msg(fd, msg) == -1 ) {
+            return -errno;
+        }
+        return recv_dump(fd, seq_num, on_message);
+    }
+
+    /**
+     * @brief
+     * Read a non-blocking socket until EAGAIN, up to NL_DRAIN_BATCH datagrams per recvmmsg() call,
+     * and pass every message of every datagram to the visitor. Messages are valid only inside the visitor call
+     * @param on_message visitor, returns false to stop draining (the rest of the current recvmmsg() batch is dropped)
+     * @param on_overrun called on ENOBUFS (the kernel has dropped notifications) and on truncated datagrams,
+     * the draining goes on
+     * @return int count of visited messages; "-errno" - recvmmsg() failed
+     */
+    inline int
+    drain_notifications (const int fd, const std::function<bool(nlmsghdr *)> &on_message, const std::function<void()> &on_overrun = nullptr)
+    {
+        // on the heap: only the draining threads pay for it. One buffer per nesting level, a visitor may drain another socket
+        static thread_local std::deque<std::vector<uint64_t>> storage;
+        static thread_local size_t depth = 0;
+        if ( storage.size() <= depth ) {
+            storage.emplace_back(NL_DRAIN_BATCH * NL_DRAIN_DGRAM_SIZE / sizeof(uint64_t));
+        }
+        struct nesting
+        {
+            nesting() { ++depth; }
+            ~nesting() { --depth; }
+        } level;
+        char *bufs = (char *)storage[depth - 1].data();
+        iovec iov[NL_DRAIN_BATCH];
+        mmsghdr msgs[NL_DRAIN_BATCH];
+
+        int count = 0;
+        while ( true ) {
+            for ( int i = 0; i < NL_DRAIN_BATCH; ++i ) {
+                iov[i]                     = {bufs + i * NL_DRAIN_DGRAM_SIZE, NL_DRAIN_DGRAM_SIZE};
+                msgs[i]                   = {};
+                msgs[i].msg_hdr.msg_iov    = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
             }
-            auto hdr = ((nlmsghdr *)nl_sock_resp_buf);
-            _seq     = (hdr->nlmsg_seq);
-            if ( _seq == seq_num ) {
-                if ( ((nlmsghdr *)nl_sock_resp_buf)->nlmsg_type == NLMSG_ERROR ) {
-                    length = 0;
-                    break;
+            int received = recvmmsg(fd, msgs, NL_DRAIN_BATCH, MSG_DONTWAIT, nullptr);
+            if ( received < 0 ) {
+                if ( errno == EINTR ) {
+                    continue;
+                }
+                if ( errno == ENOBUFS ) {  // the rest of the queue is still readable
+                    if ( on_overrun ) {
+                        on_overrun();
+                    }
+                    continue;
                 }
-                if ( ((nlmsghdr *)nl_sock_resp_buf)->nlmsg_type == NLMSG_DONE ) {
-                    break;
+                return (errno == EAGAIN or errno == EWOULDBLOCK) ? count : -errno;
+            }
+            if ( received == 0 ) {
+                return count;
+            }
+
+            for ( int i = 0; i < received; ++i ) {
+                if ( (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) and on_overrun ) {
+                    on_overrun();
                 }
-                if ( (size_t)(length + msg_size) > result_allocated_size ) {
-                    result_allocated_size = result_allocated_size << 1;
-                    char *concat          = new char[result_allocated_size];
-                    memcpy(concat, result, length);
-                    delete[] result;
-                    result = concat;
+                ssize_t msg_size = msgs[i].msg_len;
+                nlmsghdr *nlh    = (nlmsghdr *)iov[i].iov_base;
+                for ( ; NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+                    ++count;
+                    if ( not on_message(nlh) ) {
+                        return count;
+                    }
                 }
-                memcpy(result+length, nl_sock_resp_buf, msg_size);
-                length += msg_size;
+            }
+            if ( received < NL_DRAIN_BATCH ) {  // the queue is empty, save a recvmmsg() returning EAGAIN
+                return count;
             }
         }
-
-        return length;
     }
 
     /*
@@ -352,51 +589,42 @@ namespace nl_socket_handler
     * @return "int" - error code absolute value;
     * @return "-1" - error during creation;
     */
-    inline int
-    request_create_vrf (const int fd, const std::string name, const uint32_t rt_number, bool up = true)
+    inline void
+    build_create_vrf (nl_msg_builder &msg, const uint32_t seq_num, const std::string &name, const uint32_t rt_number, bool up = true)
     {
-        uint32_t seq_num = ++a_seq_num;
-        const std::string kind = "vrf";
-
-        size_t data_size      = RTA_SPACE(sizeof(rt_number));    // IFLA_VRF_TABLE
-        size_t info_data_size = RTA_SPACE(kind.size())           // IFLA_INFO_KIND
-                                + RTA_SPACE(sizeof(data_size));  // IFLA_INFO_DATA
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(ifinfomsg)   //
-                          + RTA_SPACE(name.size())               // IFLA_IFNAME
-                          + RTA_SPACE(info_data_size);           // IFLA_LINKINFO
-
-        char *msg_buf = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header    = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len   = msg_size;
-        nl_message_header->nlmsg_type  = RTM_NEWLINK;
-        nl_message_header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | NLM_F_MATCH | NLM_F_ATOMIC;
-        nl_message_header->nlmsg_seq   = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ifinfomsg *info = (ifinfomsg *)msg_buf;
-
-        info->ifi_flags = (up ? IFF_UP | IFF_RUNNING : 0);
-        info->ifi_flags |= IFF_NOARP | IFF_MASTER;
-        info->ifi_change = ALL;
-        info->ifi_family = AF_LOCAL;
-        info->ifi_type   = 0;
-        info->ifi_index  = 0;
-        msg_buf += sizeof(ifinfomsg);
-
-        msg_buf = fill_in_attr<const char(&)>(msg_buf, IFLA_IFNAME, *name.c_str(), name.size());
-        msg_buf = fill_in_attr<std::nullptr_t>(msg_buf, IFLA_LINKINFO, nullptr, info_data_size);  // filling in only the header without data
+        msg.begin_msg(RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK | NLM_F_MATCH | NLM_F_ATOMIC, seq_num);
+
+        ifinfomsg *info = msg.put_header<ifinfomsg>();
+        if ( info ) {
+            info->ifi_flags = (up ? IFF_UP | IFF_RUNNING : 0);
+            info->ifi_flags |= IFF_NOARP | IFF_MASTER;
+            info->ifi_change = ALL;
+            info->ifi_family = AF_LOCAL;
+        }
+
+        msg.add_str(IFLA_IFNAME, name);
+        size_t linkinfo = msg.nest_begin(IFLA_LINKINFO);
         {
-            msg_buf = fill_in_attr<const char(&)>(msg_buf, IFLA_INFO_KIND, *kind.c_str(), kind.size());
-            msg_buf = fill_in_attr<std::nullptr_t>(msg_buf, IFLA_INFO_DATA, nullptr, data_size); // filling in only the header without data
+            msg.add_attr(IFLA_INFO_KIND, "vrf", 3);
+            size_t info_data = msg.nest_begin(IFLA_INFO_DATA);
             {
-                msg_buf = fill_in_attr<uint32_t>(msg_buf, IFLA_VRF_TABLE, rt_number);
+                msg.add_attr<uint32_t>(IFLA_VRF_TABLE, rt_number);
             }
+            msg.nest_end(info_data);
         }
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+        msg.nest_end(linkinfo);
+        msg.end_msg();
+    }
+
+    inline int
+    request_create_vrf (const int fd, const std::string name, const uint32_t rt_number, bool up = true)
+    {
+        uint32_t seq_num = ++a_seq_num;
+
+        nl_msg_builder &msg = local_msg_builder();
+        build_create_vrf(msg, seq_num, name, rt_number, up);
+
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! send() failed, err: " << strerror(errno) << std::endl;
             return -1;
@@ -404,6 +632,23 @@ namespace nl_socket_handler
         return recv_response(fd, seq_num);
     }
 
+    inline void
+    build_add_ip_addr (nl_msg_builder &msg, const uint32_t seq_num, const in_addr_t ip_addr, const uint8_t masklen, const uint32_t system_iface_id)
+    {
+        msg.begin_msg(RTM_NEWADDR, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+
+        ifaddrmsg *new_ip_address = msg.put_header<ifaddrmsg>();
+        if ( new_ip_address ) {
+            new_ip_address->ifa_family    = AF_INET;
+            new_ip_address->ifa_prefixlen = masklen;
+            new_ip_address->ifa_index     = system_iface_id;
+            new_ip_address->ifa_flags |= IFA_F_SECONDARY;
+        }
+
+        msg.add_attr<in_addr_t>(IFA_LOCAL, ip_addr);
+        msg.end_msg();
+    }
+
     /**
      * @brief 
      * Send request to add secondary ip to the linux interface
@@ -427,35 +672,15 @@ namespace nl_socket_handler
         if ( not masklen || (masklen >= 32) ) {
             return -EINVAL;  //invalid mask
         }
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(ifaddrmsg)  //
-                       + RTA_SPACE(sizeof(in_addr_t));       // RTA_DST
-        char *msg_buf = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header   = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len  = msg_size;
-        nl_message_header->nlmsg_type = RTM_NEWADDR;
-        nl_message_header->nlmsg_flags |= NLM_F_REQUEST;
-        nl_message_header->nlmsg_flags |= NLM_F_ACK;
-        nl_message_header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ifaddrmsg *new_ip_address     = (ifaddrmsg *)msg_buf;
-        new_ip_address->ifa_family    = AF_INET;
-        new_ip_address->ifa_prefixlen = masklen;
-        new_ip_address->ifa_index     = system_iface_id;
-        new_ip_address->ifa_flags |= IFA_F_SECONDARY;
-        msg_buf += sizeof(ifaddrmsg);
-
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, IFA_LOCAL, ip_addr);
-
-        int rc = send(fd, begin, msg_size, 0);
+
+        nl_msg_builder &msg = local_msg_builder();
+        build_add_ip_addr(msg, seq_num, ip_addr, masklen, system_iface_id);
+
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! netlink socket: send() failed, err: " << strerror(errno) << std::endl;
             return -1;
         }
-        delete[] begin;
         return recv_response(fd, seq_num);
     }
 
@@ -477,6 +702,127 @@ namespace nl_socket_handler
         return request_add_ip_addr(fd, ip, (uint8_t)masklen, system_iface_id);
     }
 
+    /**
+     * @brief
+     * Write RTM_NEWADDR/RTM_DELADDR of an IPv6 address into the builder
+     * @param flags IFA_F_* (IFA_F_NODAD ...)
+     */
+    inline void
+    build_ip_addr (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const in6_addr &ip_addr, const uint8_t masklen,  //
+                   const uint32_t system_iface_id, const uint8_t flags = 0)
+    {
+        msg.begin_msg(type, NLM_F_REQUEST | NLM_F_ACK | (type == RTM_NEWADDR ? NLM_F_CREATE | NLM_F_EXCL : 0), seq_num);
+
+        ifaddrmsg *ip_address = msg.put_header<ifaddrmsg>();
+        if ( ip_address ) {
+            ip_address->ifa_family    = AF_INET6;
+            ip_address->ifa_prefixlen = masklen;
+            ip_address->ifa_index     = system_iface_id;
+            ip_address->ifa_flags     = flags;
+        }
+
+        msg.add_attr<in6_addr>(IFA_LOCAL, ip_addr);
+        msg.add_attr<in6_addr>(IFA_ADDRESS, ip_addr);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Send request to add an IPv6 address to the linux interface
+     * @param nodad IFA_F_NODAD: the address is usable at once, without duplicate address detection
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_ip_addr (const int fd, const in6_addr &ip_addr, const uint8_t masklen, const uint32_t system_iface_id, const bool nodad = false)
+    {
+        if ( system_iface_id == NO_SYSTEM_ID ) {
+            return -EINVAL;  //invalid interface
+        }
+        if ( not masklen || (masklen > 128) ) {
+            return -EINVAL;  //invalid mask
+        }
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_ip_addr(msg, seq_num, RTM_NEWADDR, ip_addr, masklen, system_iface_id, nodad ? IFA_F_NODAD : 0);
+        });
+    }
+
+    inline int
+    request_del_ip_addr (const int fd, const in6_addr &ip_addr, const uint8_t masklen, const uint32_t system_iface_id)
+    {
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_ip_addr(msg, seq_num, RTM_DELADDR, ip_addr, masklen, system_iface_id);
+        });
+    }
+
+    /**
+     * @brief
+     * Check the IPv4 route destination and masklen the same way request_add_route does
+     * @return int "0" - valid; "-EINVAL" - invalid mask or dest/mask combination
+     */
+    inline int
+    check_route_args (const in_addr_t dst_addr, const uint8_t masklen)
+    {
+        if ( not masklen || (masklen >= 32) ) {
+            return -EINVAL;  //invalid mask
+        }
+
+        in_addr_t mask = ~(((uint32_t)(-1) >> (masklen)) << masklen);
+        if ( (dst_addr & mask) != dst_addr ) {
+            return -EINVAL;  // invalid dest/mask combination
+        }
+        return 0;
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWROUTE/RTM_DELROUTE for an IPv4 route into the builder. Arguments are not checked
+     * @param type RTM_NEWROUTE or RTM_DELROUTE
+     * @param flags additional nlmsg flags (NLM_F_CREATE, NLM_F_REPLACE ...)
+     */
+    inline void
+    build_route (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags,  //
+                 const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen,                    //
+                 const uint32_t metric, const uint32_t oif_id, const uint32_t rtm_table, const uint8_t proto)
+    {
+        msg.begin_msg(type, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        rtmsg *routing_table_specification = msg.put_header<rtmsg>();
+        if ( routing_table_specification ) {
+            routing_table_specification->rtm_family   = AF_INET;
+            routing_table_specification->rtm_table    = 0;  // will be set by attr
+            routing_table_specification->rtm_protocol = proto;
+            routing_table_specification->rtm_scope    = RT_SCOPE_UNIVERSE;
+            if ( dst_addr ) {
+                routing_table_specification->rtm_scope   = RT_SCOPE_LINK;
+                routing_table_specification->rtm_dst_len = masklen;
+            }
+            if ( type == RTM_DELROUTE ) {
+                routing_table_specification->rtm_scope = RT_SCOPE_NOWHERE;  // any scope
+            }
+            routing_table_specification->rtm_type = RTN_UNICAST;
+        }
+
+        msg.add_attr<in_addr_t>(RTA_GATEWAY, gw);
+        msg.add_attr<in_addr_t>(RTA_DST, dst_addr);
+        msg.add_attr<uint32_t>(RTA_PRIORITY, metric);
+        msg.add_attr<uint32_t>(RTA_OIF, oif_id);
+        msg.add_attr<uint32_t>(RTA_TABLE, rtm_table);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWROUTE for an IPv4 route into the builder. Arguments are not checked
+     */
+    inline void
+    build_add_route (nl_msg_builder &msg, const uint32_t seq_num, const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen,  //
+                     const uint32_t metric, const uint32_t oif_id, const uint32_t rtm_table, const uint8_t proto)
+    {
+        build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+    }
+
     /**
      * @brief 
      * Send request to add IPv4 route with parameters
@@ -498,64 +844,14 @@ namespace nl_socket_handler
     request_add_route (const int fd, const in_addr_t dst_addr = 0, const in_addr_t gw = 0, uint8_t masklen = 32u,  //
                        const uint32_t metric = 0, const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
     {
-        if ( not masklen || (masklen >= 32) ) {
-            return -EINVAL;  //invalid mask
-        }
-
-        in_addr_t mask = ~(((uint32_t)(-1) >> (masklen)) << masklen);
-        in_addr_t dst_addr_sub = dst_addr & mask;  // apply mask to avoid errors
-        if (dst_addr_sub != dst_addr)
-        {
-            return -EINVAL;  // invalid dest/mask combination
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
         }
 
-        uint32_t seq_num = ++a_seq_num;
-
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(rtmsg)  //
-                       + RTA_SPACE(sizeof(in_addr_t))    // RTA_DST
-                       + RTA_SPACE(sizeof(in_addr_t))    // RTA_GATEWAY
-                       + RTA_SPACE(sizeof(uint32_t))     // RTA_PRIORITY
-                       + RTA_SPACE(sizeof(uint32_t))     // RTA_OIF
-                       + RTA_SPACE(sizeof(uint32_t))     // RTA_TABLE
-            ;
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size * sizeof(char));
-
-        nlmsghdr *header   = (nlmsghdr *)msg_buf;
-        header->nlmsg_type = RTM_NEWROUTE;
-        header->nlmsg_len  = msg_size;
-        header->nlmsg_flags |= NLM_F_REQUEST;
-        header->nlmsg_flags |= NLM_F_ACK;
-        // header->nlmsg_flags |= NLM_F_REPLACE;
-        header->nlmsg_flags |= NLM_F_CREATE;
-        header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        rtmsg *routing_table_specification        = (rtmsg *)msg_buf;
-        routing_table_specification->rtm_family   = AF_INET;
-        routing_table_specification->rtm_table    = 0;  // will be set by attr
-        routing_table_specification->rtm_protocol = proto;
-        routing_table_specification->rtm_scope    = RT_SCOPE_UNIVERSE;
-        if ( dst_addr ) {
-            routing_table_specification->rtm_scope   = RT_SCOPE_LINK;
-            routing_table_specification->rtm_dst_len = masklen;
-        }
-        routing_table_specification->rtm_type = RTN_UNICAST;
-        msg_buf += sizeof(rtmsg);
-
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, RTA_GATEWAY, gw);
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, RTA_DST, dst_addr);
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_PRIORITY, metric);
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_OIF, oif_id);
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_TABLE, rtm_table);
-
-        auto rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
-        if ( rc == -1 ) {
-            return -EBUSY;
-        }
-        return recv_response(fd, seq_num);
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_add_route(msg, seq_num, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        });
     }
 
     /**
@@ -595,6 +891,420 @@ namespace nl_socket_handler
         return nl_socket_handler::request_add_route(fd, dst_ip, gw_ip, masklen, metric, oif_id, rtm_table, proto);
     }
 
+    /**
+     * @brief
+     * Send request to delete IPv4 route. gw, metric and oif_id narrow the match when they are set
+     * @param fd netlink socket fd
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_del_route (const int fd, const in_addr_t dst_addr, const uint8_t masklen, const uint32_t metric = 0,  //
+                       const uint32_t rtm_table = RT_TABLE_MAIN, const in_addr_t gw = 0, const uint32_t oif_id = NO_SYSTEM_ID)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route(msg, seq_num, RTM_DELROUTE, 0, dst_addr, gw, masklen, metric, oif_id, rtm_table, 0);
+        });
+    }
+
+    /**
+     * @brief
+     * Send request to add IPv4 route or to change the route with the same destination, masklen, metric and table
+     * in place (NLM_F_REPLACE): unlike a delete and an add, there is no moment without the route and one round trip.
+     * The metric is a part of the route identity, see request_change_route() to change it
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_replace_route (const int fd, const in_addr_t dst_addr, const in_addr_t gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                           const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Check the IPv6 route destination and masklen: ::/0 and /128 are valid, host bits must be zero
+     * @return int "0" - valid; "-EINVAL" - invalid mask or dest/mask combination
+     */
+    inline int
+    check_route_args (const in6_addr &dst_addr, const uint8_t masklen)
+    {
+        if ( masklen > 128 ) {
+            return -EINVAL;  //invalid mask
+        }
+        for ( size_t i = masklen; i < 128; ++i ) {
+            if ( dst_addr.s6_addr[i / 8] & (0x80 >> (i % 8)) ) {
+                return -EINVAL;  // invalid dest/mask combination
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWROUTE/RTM_DELROUTE for an IPv6 route into the builder. Arguments are not checked
+     * @param gw nexthop/gateway IP, "::" - none
+     * @param oif_id output linux interface id, "0" - none
+     * @param metric "0" - the kernel default (1024) for a new route, any metric for a deleted one
+     */
+    inline void
+    build_route (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags,  //
+                 const in6_addr &dst_addr, const in6_addr &gw, const uint8_t masklen,                   //
+                 const uint32_t metric, const uint32_t oif_id, const uint32_t rtm_table, const uint8_t proto)
+    {
+        msg.begin_msg(type, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        rtmsg *routing_table_specification = msg.put_header<rtmsg>();
+        if ( routing_table_specification ) {
+            routing_table_specification->rtm_family   = AF_INET6;
+            routing_table_specification->rtm_dst_len  = masklen;
+            routing_table_specification->rtm_protocol = proto;
+            routing_table_specification->rtm_scope    = (type == RTM_DELROUTE) ? RT_SCOPE_NOWHERE : RT_SCOPE_UNIVERSE;
+            routing_table_specification->rtm_type     = RTN_UNICAST;
+        }
+
+        if ( masklen ) {
+            msg.add_attr<in6_addr>(RTA_DST, dst_addr);
+        }
+        if ( not IN6_IS_ADDR_UNSPECIFIED(&gw) ) {
+            msg.add_attr<in6_addr>(RTA_GATEWAY, gw);
+        }
+        if ( metric ) {
+            msg.add_attr<uint32_t>(RTA_PRIORITY, metric);
+        }
+        if ( oif_id ) {
+            msg.add_attr<uint32_t>(RTA_OIF, oif_id);
+        }
+        msg.add_attr<uint32_t>(RTA_TABLE, rtm_table);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Send request to add IPv6 route with parameters
+     * @param fd netlink socket fd
+     * @param dst_addr route dsetination IP
+     * @param gw nexthop/gateway IP, "::" - the route is on the link of oif_id
+     * @param masklen length of netmask (0..128)
+     * @param metric metric/priority of the route, "0" - the kernel default
+     * @param oif_id output linux interface id
+     * @param rtm_table number of linux routing tabel
+     * @param proto number of route protocol
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_route (const int fd, const in6_addr &dst_addr, const in6_addr &gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                       const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Send request to delete IPv6 route. gw, metric and oif_id narrow the match when they are set
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_del_route (const int fd, const in6_addr &dst_addr, const uint8_t masklen, const uint32_t metric = 0,  //
+                       const uint32_t rtm_table = RT_TABLE_MAIN, const in6_addr &gw = in6addr_any, const uint32_t oif_id = NO_SYSTEM_ID)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route(msg, seq_num, RTM_DELROUTE, 0, dst_addr, gw, masklen, metric, oif_id, rtm_table, 0);
+        });
+    }
+
+    /**
+     * @brief
+     * Send request to add IPv6 route or to change the route with the same destination, masklen, metric and table
+     * in place (NLM_F_REPLACE)
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_replace_route (const int fd, const in6_addr &dst_addr, const in6_addr &gw, const uint8_t masklen, const uint32_t metric = 0,  //
+                           const uint32_t oif_id = NO_SYSTEM_ID, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | NLM_F_REPLACE, dst_addr, gw, masklen, metric, oif_id, rtm_table, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWROUTE/RTM_DELROUTE for an IPv4 route which refers to a nexthop object (RTA_NH_ID) into the builder.
+     * The route has no gateway and oif of its own, a change of the nexthop moves it. Arguments are not checked
+     * @param type RTM_NEWROUTE or RTM_DELROUTE
+     * @param flags additional nlmsg flags (NLM_F_CREATE, NLM_F_REPLACE ...)
+     */
+    inline void
+    build_route_nh (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags,  //
+                    const in_addr_t dst_addr, const uint8_t masklen, const uint32_t nh_id,                 //
+                    const uint32_t metric, const uint32_t rtm_table, const uint8_t proto)
+    {
+        msg.begin_msg(type, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        rtmsg *routing_table_specification = msg.put_header<rtmsg>();
+        if ( routing_table_specification ) {
+            routing_table_specification->rtm_family   = AF_INET;
+            routing_table_specification->rtm_dst_len  = masklen;
+            routing_table_specification->rtm_protocol = proto;
+            routing_table_specification->rtm_scope    = (type == RTM_DELROUTE) ? RT_SCOPE_NOWHERE : RT_SCOPE_UNIVERSE;
+            routing_table_specification->rtm_type     = RTN_UNICAST;
+        }
+
+        msg.add_attr<in_addr_t>(RTA_DST, dst_addr);
+        msg.add_attr<uint32_t>(RTA_PRIORITY, metric);
+        msg.add_attr<uint32_t>(RTA_TABLE, rtm_table);
+        if ( nh_id ) {
+            msg.add_attr<uint32_t>(RTA_NH_ID, nh_id);
+        }
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Send request to add (or to replace) an IPv4 route via a nexthop object
+     * @param nh_id id of a nexthop or a nexthop group
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_route_nh (const int fd, const in_addr_t dst_addr, const uint8_t masklen, const uint32_t nh_id, const uint32_t metric = 0,  //
+                          const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC, const bool replace = false)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route_nh(msg, seq_num, RTM_NEWROUTE, NLM_F_CREATE | (replace ? NLM_F_REPLACE : 0), dst_addr, masklen, nh_id, metric, rtm_table, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWROUTE for an IPv4 ECMP route (RTA_MULTIPATH) into the builder. Arguments are not checked
+     * @param flags additional nlmsg flags (NLM_F_CREATE, NLM_F_REPLACE ...)
+     * @param hops paths of the route: gateway (AF_UNSPEC - none), oif and weight (1..256)
+     */
+    inline void
+    build_route_multipath (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t flags, const in_addr_t dst_addr, const uint8_t masklen,  //
+                           const route_hop *hops, const size_t count, const uint32_t metric, const uint32_t rtm_table, const uint8_t proto)
+    {
+        msg.begin_msg(RTM_NEWROUTE, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        rtmsg *routing_table_specification = msg.put_header<rtmsg>();
+        if ( routing_table_specification ) {
+            routing_table_specification->rtm_family   = AF_INET;
+            routing_table_specification->rtm_dst_len  = masklen;
+            routing_table_specification->rtm_protocol = proto;
+            routing_table_specification->rtm_scope    = RT_SCOPE_UNIVERSE;
+            routing_table_specification->rtm_type     = RTN_UNICAST;
+        }
+
+        msg.add_attr<in_addr_t>(RTA_DST, dst_addr);
+        msg.add_attr<uint32_t>(RTA_PRIORITY, metric);
+        msg.add_attr<uint32_t>(RTA_TABLE, rtm_table);
+        size_t multipath = msg.nest_begin(RTA_MULTIPATH);
+        for ( size_t i = 0; i < count; ++i ) {
+            size_t rtnh = msg.rtnh_begin(hops[i].iface_id, hops[i].weight - 1);
+            if ( hops[i].family ) {
+                msg.add_attr(RTA_GATEWAY, hops[i].gw, hops[i].family == AF_INET6 ? sizeof(in6_addr) : sizeof(in_addr_t));
+            }
+            msg.rtnh_end(rtnh);
+        }
+        msg.nest_end(multipath);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Send request to add (or to replace) an IPv4 ECMP route
+     * @param hops paths of the route, the weight of a hop is 1..256
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_route_multipath (const int fd, const in_addr_t dst_addr, const uint8_t masklen, const std::vector<route_hop> &hops,  //
+                                 const uint32_t metric = 0, const uint32_t rtm_table = RT_TABLE_MAIN, const uint8_t proto = RTPROT_STATIC,  //
+                                 const bool replace = false)
+    {
+        int valid = check_route_args(dst_addr, masklen);
+        if ( valid < 0 ) {
+            return valid;
+        }
+        if ( hops.empty() ) {
+            return -EINVAL;
+        }
+
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_route_multipath(msg, seq_num, NLM_F_CREATE | (replace ? NLM_F_REPLACE : 0), dst_addr, masklen, hops.data(), hops.size(), metric, rtm_table, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWNEXTHOP of an IPv4 nexthop object into the builder
+     * @param flags additional nlmsg flags (NLM_F_CREATE, NLM_F_REPLACE ...)
+     * @param gw gateway IP, "0" - the nexthop is the device itself
+     * @param oif_id output linux interface id, "0" with no gw - a blackhole
+     */
+    inline void
+    build_nexthop (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t flags, const uint32_t nh_id,  //
+                   const in_addr_t gw, const uint32_t oif_id, const uint8_t proto = RTPROT_STATIC)
+    {
+        msg.begin_msg(RTM_NEWNEXTHOP, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        nhmsg *nexthop_specification = msg.put_header<nhmsg>();
+        if ( nexthop_specification ) {
+            nexthop_specification->nh_family   = AF_INET;
+            nexthop_specification->nh_protocol = proto;
+        }
+
+        msg.add_attr<uint32_t>(NHA_ID, nh_id);
+        if ( not gw and not oif_id ) {
+            msg.add_attr(NHA_BLACKHOLE, nullptr, 0);
+            msg.end_msg();
+            return;
+        }
+        if ( gw ) {
+            msg.add_attr<in_addr_t>(NHA_GATEWAY, gw);
+        }
+        msg.add_attr<uint32_t>(NHA_OIF, oif_id);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWNEXTHOP of a nexthop group into the builder
+     * @param members ids of the nexthops with their weights (the weight is stored minus one)
+     */
+    inline void
+    build_nexthop_group (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t flags, const uint32_t nh_id,  //
+                         const nexthop_grp *members, const size_t count, const uint8_t proto = RTPROT_STATIC)
+    {
+        msg.begin_msg(RTM_NEWNEXTHOP, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        nhmsg *nexthop_specification = msg.put_header<nhmsg>();
+        if ( nexthop_specification ) {
+            nexthop_specification->nh_family   = AF_UNSPEC;  // a group has no family
+            nexthop_specification->nh_protocol = proto;
+        }
+
+        msg.add_attr<uint32_t>(NHA_ID, nh_id);
+        msg.add_attr(NHA_GROUP, members, count * sizeof(nexthop_grp));
+        msg.end_msg();
+    }
+
+    inline void
+    build_del_nexthop (nl_msg_builder &msg, const uint32_t seq_num, const uint32_t nh_id)
+    {
+        msg.begin_msg(RTM_DELNEXTHOP, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+        msg.put_header<nhmsg>();
+        msg.add_attr<uint32_t>(NHA_ID, nh_id);
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Send request to create or to replace an IPv4 nexthop object. A replace moves every route which uses it
+     * @param fd netlink socket fd
+     * @param nh_id nexthop id, it must not be "0"
+     * @param gw gateway IP, "0" - the nexthop is the device itself
+     * @param oif_id output linux interface id, "0" with no gw - a blackhole
+     * @param replace NLM_F_REPLACE: change an existing nexthop
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_nexthop (const int fd, const uint32_t nh_id, const in_addr_t gw, const uint32_t oif_id, const bool replace = false,  //
+                         const uint8_t proto = RTPROT_STATIC)
+    {
+        if ( not nh_id ) {
+            return -EINVAL;
+        }
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_nexthop(msg, seq_num, replace ? NLM_F_CREATE | NLM_F_REPLACE : NLM_F_CREATE | NLM_F_EXCL, nh_id, gw, oif_id, proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Send request to create or to replace a nexthop group: the routes which use it are balanced over the members
+     * @param members nexthop ids with their weights (the weight is stored minus one)
+     * @param replace NLM_F_REPLACE: change the members of an existing group
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_nexthop_group (const int fd, const uint32_t nh_id, const std::vector<nexthop_grp> &members, const bool replace = false,  //
+                               const uint8_t proto = RTPROT_STATIC)
+    {
+        if ( not nh_id or members.empty() ) {
+            return -EINVAL;
+        }
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_nexthop_group(msg, seq_num, replace ? NLM_F_CREATE | NLM_F_REPLACE : NLM_F_CREATE | NLM_F_EXCL, nh_id, members.data(), members.size(), proto);
+        });
+    }
+
+    /**
+     * @brief
+     * Send request to delete a nexthop object. The kernel deletes the routes which use it without notifications
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_del_nexthop (const int fd, const uint32_t nh_id)
+    {
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_del_nexthop(msg, seq_num, nh_id);
+        });
+    }
+
     /**
     * @brief 
     * Send request to find an interface into LINUX
@@ -644,9 +1354,34 @@ namespace nl_socket_handler
         return interface_index;
     }
 
+    inline void
+    build_get_link_list (nl_msg_builder &msg, const uint32_t seq_num)
+    {
+        msg.begin_msg(RTM_GETLINK, NLM_F_REQUEST | NLM_F_DUMP, seq_num);
+        msg.put_header<ifinfomsg>();
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Dump all the interfaces and pass every RTM_NEWLINK message to the visitor
+     * @return "0" - success; "int" - error code absolute value; "<0" - -errno
+     */
+    inline int
+    request_get_link_list (const int fd, const std::function<void(nlmsghdr *)> &on_link)
+    {
+        return request_dump(fd, [] (nl_msg_builder &msg, uint32_t seq_num) { build_get_link_list(msg, seq_num); },
+                            [&on_link] (nlmsghdr *nlh) {
+                                if ( nlh->nlmsg_type == RTM_NEWLINK ) {
+                                    on_link(nlh);
+                                }
+                            });
+    }
+
     /**
      * @brief 
-     * Send get-reqest for the vrf and parse the response to find routing table number
+     * Send get-reqest for the vrf and parse the response to find routing table number.
+     * A round trip per call: vrf_registry keeps all of them
      * @param fd netlink socket fd
      * @param vrf_name linux VRF name
      * 
@@ -663,7 +1398,6 @@ namespace nl_socket_handler
         char nl_sock_resp_buf[BUF_SIZE];
         char *iterator = nullptr;
         char *interface_name;
-        char *data;
         int msg_size = 0;
         uint32_t _seq;
         do {
@@ -683,14 +1417,9 @@ namespace nl_socket_handler
                 break;
             }
             if ( vrf_name == std::string(interface_name) ) {
-                int size = nl_socket_handler::get_nl_sock_data(iterator, msg_size, RTM_NEWLINK, IFLA_LINKINFO, &data);
-                if ( size < 0 ) {
-                    break;
-                }
-               
-                char *ptr = data + size - sizeof(uint32_t); // last 4 bytes of the data is rt_num
-                rt_num = *(uint32_t *)(ptr);
-
+                link_event event;  // IFLA_LINKINFO/IFLA_INFO_DATA/IFLA_VRF_TABLE, "0" if it isn't a VRF
+                link_event::parse((nlmsghdr *)iterator, event);
+                rt_num = event.vrf_table;
                 break;
             }
             iterator = nl_socket_handler::get_next_multipart_message(iterator);
@@ -699,6 +1428,18 @@ namespace nl_socket_handler
         return rt_num;
     }
 
+    inline void
+    build_del_link (nl_msg_builder &msg, const uint32_t seq_num, const int index)
+    {
+        msg.begin_msg(RTM_DELLINK, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+
+        ifinfomsg *info = msg.put_header<ifinfomsg>();
+        if ( info ) {
+            info->ifi_index = index;
+        }
+        msg.end_msg();
+    }
+
     /*
     * Send request to delete a VRF into LINUX
     * @param {fd} netlink socket fd
@@ -714,25 +1455,10 @@ namespace nl_socket_handler
     {
         uint32_t seq_num = ++a_seq_num;
 
-        size_t msg_size  = sizeof(nlmsghdr) + sizeof(ifinfomsg);
-        char *msg_buf = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header    = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len   = msg_size;
-        nl_message_header->nlmsg_type  = RTM_DELLINK;
-        nl_message_header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
-        nl_message_header->nlmsg_seq   = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ifinfomsg *info = (ifinfomsg *)msg_buf;
-        info->ifi_type  = 0;
-        info->ifi_index = index;
-        msg_buf += sizeof(ifinfomsg);
-
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+        nl_msg_builder &msg = local_msg_builder();
+        build_del_link(msg, seq_num, index);
+
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! send() failed, err: " << strerror(errno) << std::endl;
             return -1;
@@ -740,6 +1466,19 @@ namespace nl_socket_handler
         return recv_response(fd, seq_num);
     }
 
+    inline void
+    build_set_master (nl_msg_builder &msg, const uint32_t seq_num, const uint32_t vrf_index, const uint32_t iface_index)
+    {
+        msg.begin_msg(RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+
+        ifinfomsg *info = msg.put_header<ifinfomsg>();
+        if ( info ) {
+            info->ifi_index = iface_index;
+        }
+        msg.add_attr<uint32_t>(IFLA_MASTER, vrf_index);
+        msg.end_msg();
+    }
+
     /*
     * Send request to add a linux interface to VRF
     * @param {fd} netlink socket fd
@@ -754,27 +1493,11 @@ namespace nl_socket_handler
     inline int request_add_iface_to_vrf (const int fd, const uint32_t vrf_index, const uint32_t iface_index)
     {
         uint32_t seq_num = ++a_seq_num;
-        size_t msg_size     = sizeof(nlmsghdr) + sizeof(ifinfomsg)  //
-                       + RTA_SPACE(sizeof(uint32_t));            // IFLA_MASTER
-        char *msg_buf           = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header    = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len   = msg_size;
-        nl_message_header->nlmsg_type  = RTM_NEWLINK;
-        nl_message_header->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
-        nl_message_header->nlmsg_seq   = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ifinfomsg *info = (ifinfomsg *)msg_buf;
-        info->ifi_index = iface_index;
-        msg_buf += sizeof(ifinfomsg);
-
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, IFLA_MASTER, vrf_index);
-
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+
+        nl_msg_builder &msg = local_msg_builder();
+        build_set_master(msg, seq_num, vrf_index, iface_index);
+
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             std::cout << "ERORR! send() failed, err: " << strerror(errno) << std::endl;
             return -1;
@@ -797,6 +1520,25 @@ namespace nl_socket_handler
         return request_add_iface_to_vrf(fd, 0, iface_index);
     }
 
+    /**
+     * @brief
+     * Write an IPv4 route dump request. RT_TABLE_UNSPEC dumps every table by one request
+     * (the socket needs NETLINK_GET_STRICT_CHK for the kernel to filter by the table)
+     */
+    inline void
+    build_get_route_list (nl_msg_builder &msg, const uint32_t seq_num, const uint32_t rtm_table, const uint8_t family = AF_INET)
+    {
+        msg.begin_msg(RTM_GETROUTE, NLM_F_REQUEST | NLM_F_DUMP, seq_num);
+
+        rtmsg *rt_specification = msg.put_header<rtmsg>();
+        if ( rt_specification ) {
+            rt_specification->rtm_family = family;
+            rt_specification->rtm_table  = 0;  // set into the attribute
+        }
+        msg.add_attr<uint32_t>(RTA_TABLE, rtm_table);
+        msg.end_msg();
+    }
+
     /**
      * @brief 
      * 
@@ -809,30 +1551,12 @@ namespace nl_socket_handler
     inline size_t
     request_get_route_list (const int fd, const uint32_t rtm_table, char *&result, size_t result_allocated_size)
     {
-        static uint32_t seq_num = ++a_seq_num;
-
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(rtmsg)  //
-                       + RTA_SPACE(sizeof(uint32_t));    // RTA_TABLE
-        char *msg_buf = new char[msg_size];
-        memset(msg_buf, 0, msg_size * sizeof(char));
-        char *begin = msg_buf;
-
-        nlmsghdr *nl_message_header    = (nlmsghdr *)msg_buf;
-        nl_message_header->nlmsg_len   = msg_size;
-        nl_message_header->nlmsg_type  = RTM_GETROUTE;
-        nl_message_header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
-        nl_message_header->nlmsg_seq   = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        rtmsg *rt_specification      = (rtmsg *)msg_buf;
-        rt_specification->rtm_family = AF_INET;
-        rt_specification->rtm_table  = 0;  // set into the attribute
-        msg_buf += sizeof(rtmsg);
+        uint32_t seq_num = ++a_seq_num;
 
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, RTA_TABLE, rtm_table);
+        nl_msg_builder &msg = local_msg_builder();
+        build_get_route_list(msg, seq_num, rtm_table);
 
-        int rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
+        int rc = send_msg(fd, msg);
         if ( rc == -1 ) {
             return return_code::unix_send_err;
         }
@@ -841,6 +1565,159 @@ namespace nl_socket_handler
         return dump_size;
     }
 
+    /**
+     * @brief
+     * Dump the routes of the table and pass every RTM_NEWROUTE message to the visitor without buffering the dump
+     * @param family AF_INET, AF_INET6 or AF_UNSPEC for both
+     * @return "0" - success; "int" - error code absolute value; "<0" - -errno
+     */
+    inline int
+    request_get_route_list (const int fd, const uint32_t rtm_table, const std::function<void(nlmsghdr *)> &on_route, const uint8_t family = AF_UNSPEC)
+    {
+        return request_dump(fd, [rtm_table, family] (nl_msg_builder &msg, uint32_t seq_num) { build_get_route_list(msg, seq_num, rtm_table, family); },
+                            [&on_route] (nlmsghdr *nlh) {
+                                if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
+                                    on_route(nlh);
+                                }
+                            });
+    }
+
+    inline void
+    build_get_nexthop_list (nl_msg_builder &msg, const uint32_t seq_num)
+    {
+        msg.begin_msg(RTM_GETNEXTHOP, NLM_F_REQUEST | NLM_F_DUMP, seq_num);
+        msg.put_header<nhmsg>();
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Dump the nexthop objects and groups and pass every RTM_NEWNEXTHOP message to the visitor
+     * @return "0" - success; "int" - error code absolute value; "<0" - -errno
+     */
+    inline int
+    request_get_nexthop_list (const int fd, const std::function<void(nlmsghdr *)> &on_nexthop)
+    {
+        return request_dump(fd, [] (nl_msg_builder &msg, uint32_t seq_num) { build_get_nexthop_list(msg, seq_num); },
+                            [&on_nexthop] (nlmsghdr *nlh) {
+                                if ( nlh->nlmsg_type == RTM_NEWNEXTHOP ) {
+                                    on_nexthop(nlh);
+                                }
+                            });
+    }
+
+    /**
+     * @brief
+     * Write an RTM_GETNEIGH dump request into the builder
+     * @param oif_id dump the neighbours of one interface only, "0" - of all the interfaces
+     */
+    inline void
+    build_get_neigh_list (nl_msg_builder &msg, const uint32_t seq_num, const uint8_t family = AF_UNSPEC, const uint32_t oif_id = 0)
+    {
+        msg.begin_msg(RTM_GETNEIGH, NLM_F_REQUEST | NLM_F_DUMP, seq_num);
+        ndmsg *neighbor_specification = msg.put_header<ndmsg>();
+        if ( neighbor_specification ) {
+            neighbor_specification->ndm_family = family;
+        }
+        if ( oif_id ) {
+            msg.add_attr<uint32_t>(NDA_IFINDEX, oif_id);  // the kernel filters the dump by it
+        }
+        msg.end_msg();
+    }
+
+    /**
+     * @brief
+     * Dump the neighbour (ARP/NDP) tables and pass every RTM_NEWNEIGH message to the visitor
+     * @param oif_id dump the neighbours of one interface only, "0" - of all the interfaces
+     * @return "0" - success; "int" - error code absolute value; "<0" - -errno
+     */
+    inline int
+    request_get_neigh_list (const int fd, const std::function<void(nlmsghdr *)> &on_neigh, const uint8_t family = AF_UNSPEC,  //
+                            const uint32_t oif_id = 0)
+    {
+        return request_dump(fd, [family, oif_id] (nl_msg_builder &msg, uint32_t seq_num) { build_get_neigh_list(msg, seq_num, family, oif_id); },
+                            [&on_neigh] (nlmsghdr *nlh) {
+                                if ( nlh->nlmsg_type == RTM_NEWNEIGH ) {
+                                    on_neigh(nlh);
+                                }
+                            });
+    }
+
+    /**
+     * @brief
+     * Write RTM_NEWNEIGH/RTM_DELNEIGH for a PROBE entity of any family into the builder
+     * @param type RTM_NEWNEIGH or RTM_DELNEIGH
+     * @param flags additional nlmsg flags (NLM_F_CREATE ...)
+     * @param addr 4 or 16 bytes of the address, as the family requires
+     * @param lladdr mac addr or nullptr if it's not needed
+     * @param state NUD_* of the entity
+     */
+    inline void
+    build_neighbor (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags, const uint8_t family,  //
+                    const void *addr, const uint32_t oif_id, const char *lladdr = nullptr, const uint16_t state = NUD_PROBE)
+    {
+        msg.begin_msg(type, NLM_F_REQUEST | NLM_F_ACK | flags, seq_num);
+
+        ndmsg *neighbor_specification = msg.put_header<ndmsg>();
+        if ( neighbor_specification ) {
+            neighbor_specification->ndm_family  = family;
+            neighbor_specification->ndm_ifindex = oif_id;
+            neighbor_specification->ndm_flags   = NTF_SELF;//NTF_USE;
+            neighbor_specification->ndm_state   = state;
+            neighbor_specification->ndm_type    = 1;
+        }
+
+        msg.add_attr(NDA_DST, addr, family == AF_INET6 ? sizeof(in6_addr) : sizeof(in_addr_t));
+        if ( type == RTM_DELNEIGH ) {
+            msg.end_msg();
+            return;
+        }
+        if ( lladdr ) {
+            msg.add_attr(NDA_LLADDR, lladdr, 6);
+        }
+        msg.add_attr<uint32_t>(NDA_PROBES, 0);
+        msg.add_attr<nda_cacheinfo>(NDA_CACHEINFO, nda_cacheinfo {
+                                                       .ndm_confirmed = 0,
+                                                       .ndm_used      = 0,
+                                                       .ndm_updated   = 0,
+                                                       .ndm_refcnt    = 1,
+                                                   });
+        msg.end_msg();
+    }
+
+    inline void
+    build_neighbor (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags,  //
+                    const in_addr_t dst_addr, const uint32_t oif_id, const char *lladdr = nullptr, const uint16_t state = NUD_PROBE)
+    {
+        build_neighbor(msg, seq_num, type, flags, AF_INET, &dst_addr, oif_id, lladdr, state);
+    }
+
+    inline void
+    build_neighbor (nl_msg_builder &msg, const uint32_t seq_num, const uint16_t type, const uint16_t flags,  //
+                    const in6_addr &dst_addr, const uint32_t oif_id, const char *lladdr = nullptr, const uint16_t state = NUD_PROBE)
+    {
+        build_neighbor(msg, seq_num, type, flags, AF_INET6, &dst_addr, oif_id, lladdr, state);
+    }
+
+    /**
+     * @brief
+     * Write RTM_DELNEIGH of an IPv4 or IPv6 entity into the builder
+     * @param addr 4 or 16 bytes of the address, as the family requires
+     */
+    inline void
+    build_del_neighbor (nl_msg_builder &msg, const uint32_t seq_num, const uint8_t family, const void *addr, const uint32_t oif_id)
+    {
+        msg.begin_msg(RTM_DELNEIGH, NLM_F_REQUEST | NLM_F_ACK, seq_num);
+
+        ndmsg *neighbor_specification = msg.put_header<ndmsg>();
+        if ( neighbor_specification ) {
+            neighbor_specification->ndm_family  = family;
+            neighbor_specification->ndm_ifindex = oif_id;
+        }
+        msg.add_attr(NDA_DST, addr, family == AF_INET6 ? sizeof(in6_addr) : sizeof(in_addr_t));
+        msg.end_msg();
+    }
+
     /**
      * @brief 
      * adds a PROBE entity to the linux arp table
@@ -856,51 +1733,9 @@ namespace nl_socket_handler
     inline int
     request_add_neighbor (const int fd, const in_addr_t dst_addr, const char (&lladdr)[6], const uint32_t oif_id)
     {
-        uint32_t seq_num = ++a_seq_num;
-
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(ndmsg)    //
-                          + RTA_SPACE(sizeof(in_addr_t))      // NDA_DST
-                          + RTA_SPACE(sizeof(lladdr))         // NDA_LLADDR
-                          + RTA_SPACE(sizeof(uint32_t))       // NDA_PROBES
-                          + RTA_SPACE(sizeof(nda_cacheinfo))  // NDA_CACHEINFO
-            ;
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size * sizeof(char));
-
-        nlmsghdr *header   = (nlmsghdr *)msg_buf;
-        header->nlmsg_type = RTM_NEWNEIGH;
-        header->nlmsg_len  = msg_size;
-        header->nlmsg_flags |= NLM_F_REQUEST;
-        header->nlmsg_flags |= NLM_F_ACK;
-        header->nlmsg_flags |= NLM_F_CREATE;
-        header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ndmsg *neighbor_specification       = (ndmsg *)msg_buf;
-        neighbor_specification->ndm_family  = AF_INET;
-        neighbor_specification->ndm_ifindex = oif_id;
-        neighbor_specification->ndm_flags   = NTF_SELF;//NTF_USE;
-        neighbor_specification->ndm_state   = NUD_PROBE;
-        neighbor_specification->ndm_type    = 1;
-        msg_buf += sizeof(ndmsg);
-
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, NDA_DST, dst_addr);
-        msg_buf = fill_in_attr<const char(&)>(msg_buf, NDA_LLADDR, *lladdr, sizeof(lladdr));
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, NDA_PROBES, 0);
-        msg_buf = fill_in_attr<nda_cacheinfo>(msg_buf, NDA_CACHEINFO, nda_cacheinfo {
-                                                                          .ndm_confirmed = 0,
-                                                                          .ndm_used      = 0,
-                                                                          .ndm_updated   = 0,
-                                                                          .ndm_refcnt    = 1,
-                                                                      });
-
-        auto rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
-        if ( rc == -1 ) {
-            return -EBUSY;
-        }
-        return recv_response(fd, seq_num);
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id, lladdr);
+        });
     }
 
     /**
@@ -918,50 +1753,9 @@ namespace nl_socket_handler
     inline int
     request_update_neighbor (const int fd, const in_addr_t dst_addr, const uint32_t oif_id)
     {
-        uint32_t seq_num = ++a_seq_num;
-
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(ndmsg)    //
-                          + RTA_SPACE(sizeof(in_addr_t))      // NDA_DST
-                          + RTA_SPACE(sizeof(uint32_t))       // NDA_PROBES
-                          + RTA_SPACE(sizeof(nda_cacheinfo))  // NDA_CACHEINFO
-            ;
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size * sizeof(char));
-
-        nlmsghdr *header   = (nlmsghdr *)msg_buf;
-        header->nlmsg_type = RTM_NEWNEIGH;
-        header->nlmsg_len  = msg_size;
-        header->nlmsg_flags |= NLM_F_REQUEST;
-        header->nlmsg_flags |= NLM_F_ACK;
-        header->nlmsg_flags |= NLM_F_CREATE;
-        header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ndmsg *neighbor_specification       = (ndmsg *)msg_buf;
-        neighbor_specification->ndm_family  = AF_INET;
-        neighbor_specification->ndm_ifindex = oif_id;
-        neighbor_specification->ndm_flags   = NTF_SELF;//NTF_USE;
-        neighbor_specification->ndm_state   = NUD_PROBE;
-        neighbor_specification->ndm_type    = 1;
-        msg_buf += sizeof(ndmsg);
-
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, NDA_DST, dst_addr);
-        // msg_buf = fill_in_attr<const char(&)[6]>(msg_buf, NDA_LLADDR, lladdr);
-        msg_buf = fill_in_attr<uint32_t>(msg_buf, NDA_PROBES, 0);
-        msg_buf = fill_in_attr<nda_cacheinfo>(msg_buf, NDA_CACHEINFO, nda_cacheinfo {
-                                                                          .ndm_confirmed = 0,
-                                                                          .ndm_used      = 0,
-                                                                          .ndm_updated   = 0,
-                                                                          .ndm_refcnt    = 1,
-                                                                      });
-
-        auto rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
-        if ( rc == -1 ) {
-            return -EBUSY;
-        }
-        return recv_response(fd, seq_num);
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id);
+        });
     }
 
     /**
@@ -1001,76 +1795,40 @@ namespace nl_socket_handler
     inline int
     request_delete_neighbor (const int fd, const in_addr_t dst_addr, const uint32_t oif_id)
     {
-        uint32_t seq_num = ++a_seq_num;
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_neighbor(msg, seq_num, RTM_DELNEIGH, 0, dst_addr, oif_id);
+        });
+    }
 
-        size_t msg_size = sizeof(nlmsghdr) + sizeof(ndmsg)    //
-                          + RTA_SPACE(sizeof(in_addr_t))      // NDA_DST
-            ;
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size * sizeof(char));
-
-        nlmsghdr *header   = (nlmsghdr *)msg_buf;
-        header->nlmsg_type = RTM_DELNEIGH;
-        header->nlmsg_len  = msg_size;
-        header->nlmsg_flags |= NLM_F_REQUEST;
-        header->nlmsg_flags |= NLM_F_ACK;
-        header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ndmsg *neighbor_specification       = (ndmsg *)msg_buf;
-        neighbor_specification->ndm_family  = AF_INET;
-        neighbor_specification->ndm_ifindex = oif_id;
-        neighbor_specification->ndm_flags   = NTF_SELF;//NTF_USE;
-        neighbor_specification->ndm_state   = NUD_PROBE;
-        neighbor_specification->ndm_type    = 1;
-        msg_buf += sizeof(ndmsg);
-
-        msg_buf = fill_in_attr<in_addr_t>(msg_buf, NDA_DST, dst_addr);
-
-
-        auto rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
-        if ( rc == -1 ) {
-            return -EBUSY;
-        }
-        return recv_response(fd, seq_num);
+    /**
+     * @brief
+     * adds a PROBE entity to the linux IPv6 neighbour (NDP) table
+     * @return "0" - success;
+     * @return ">0" - a responce error code absolute value;
+     * @return "<0" - the request hasn't sent error code;
+     */
+    inline int
+    request_add_neighbor (const int fd, const in6_addr &dst_addr, const char (&lladdr)[6], const uint32_t oif_id)
+    {
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id, lladdr);
+        });
     }
-    //doesn't work yet
+
     inline int
-    request_flush_stale (const int fd, const uint32_t oif_id = 0)
+    request_update_neighbor (const int fd, const in6_addr &dst_addr, const uint32_t oif_id)
     {
-        uint32_t seq_num = ++a_seq_num;
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_neighbor(msg, seq_num, RTM_NEWNEIGH, NLM_F_CREATE, dst_addr, oif_id);
+        });
+    }
 
-        size_t msg_size  = sizeof(nlmsghdr) + sizeof(rtmsg);
-        char *msg_buf = new char[msg_size];
-        char *begin   = msg_buf;
-        memset(msg_buf, 0, msg_size * sizeof(char));
-
-        nlmsghdr *header   = (nlmsghdr *)msg_buf;
-        header->nlmsg_type = RTM_DELNEIGH;
-        header->nlmsg_len  = msg_size;
-        header->nlmsg_flags |= NLM_F_REQUEST;
-        header->nlmsg_flags |= NLM_F_ACK;
-        // header->nlmsg_flags |= NLM_F_DUMP;
-        header->nlmsg_seq = seq_num;
-        msg_buf += sizeof(nlmsghdr);
-
-        ndmsg *neighbor_specification       = (ndmsg *)msg_buf;
-        neighbor_specification->ndm_family  = AF_INET;
-        neighbor_specification->ndm_ifindex = oif_id;
-        neighbor_specification->ndm_flags   = 0;
-        neighbor_specification->ndm_state   = NUD_STALE;
-        neighbor_specification->ndm_type    = 1;
-        msg_buf += sizeof(ndmsg);
-
-      
-        auto rc = send(fd, begin, msg_size, 0);
-        delete[] begin;
-        if ( rc == -1 ) {
-            return -EBUSY;
-        }
-        return recv_response(fd, seq_num);
+    inline int
+    request_delete_neighbor (const int fd, const in6_addr &dst_addr, const uint32_t oif_id)
+    {
+        return request_ack(fd, [&] (nl_msg_builder &msg, uint32_t seq_num) {
+            build_del_neighbor(msg, seq_num, AF_INET6, &dst_addr, oif_id);
+        });
     }
 }  // namespace nl_socket_handler
 
@@ -0,0 +1,170 @@
+#ifndef PROJECT_NL_URING_H
+#define PROJECT_NL_URING_H
+
+#include <functional>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+
+#include "nl_socket_handler.h"
+
+#define NL_URING_ENTRIES  64
+#define NL_URING_BUFS     256           // provided receive buffers, power of 2. Also the limit of ACKs in flight
+#define NL_URING_BUF_SIZE (8 * 1024)    // bigger than NLMSG_GOODSIZE, so a dump part always fits
+#define NL_URING_RCVBUF   (1024 * 1024)
+#define NL_URING_DUMP_TIMEOUT_MS NL_DUMP_TIMEOUT_MS
+
+namespace nl_socket_handler
+{
+    /**
+     * @brief
+     * io_uring transport for one netlink socket (raw syscalls, no liburing).
+     * A multishot receive is armed once and delivers every datagram into a ring of provided buffers,
+     * sends are queued as SQEs (optionally linked, so they are executed in order) and submitted together
+     * with waiting for completions by one io_uring_enter().
+     * If the kernel has no io_uring (or no multishot receive / provided buffer rings) is_open() is false
+     * and the users fall back to send()/recv() on get_fd().
+     * The socket should be used only by this transport and should not be subscribed to multicast groups.
+     */
+    class nl_uring
+    {
+       public:
+        /**
+         * @brief
+         * Receives one datagram. The buffer is given back to the kernel after the call
+         */
+        using datagram_handler = std::function<void(char *buf, size_t size)>;
+        /**
+         * @brief
+         * Completion of a queued send: id - the id passed to send(); rc - "0" or "-errno"
+         */
+        using send_handler = std::function<void(uint32_t id, int rc)>;
+
+       private:
+        int _fd      = -1;  // netlink socket
+        int _ring_fd = -1;
+
+        void *_sq_ptr      = nullptr;
+        size_t _sq_size    = 0;
+        void *_cq_ptr      = nullptr;
+        size_t _cq_size    = 0;
+        io_uring_sqe *_sqes = nullptr;
+        size_t _sqes_size  = 0;
+
+        unsigned *_sq_head  = nullptr;
+        unsigned *_sq_tail  = nullptr;
+        unsigned *_sq_array = nullptr;
+        unsigned _sq_mask   = 0;
+        unsigned _sq_entries = 0;
+        unsigned _sq_local_tail = 0;  // SQEs up to it are filled, up to *_sq_tail are published
+        unsigned *_cq_head  = nullptr;
+        unsigned *_cq_tail  = nullptr;
+        unsigned _cq_mask   = 0;
+        io_uring_cqe *_cqes = nullptr;
+
+        io_uring_buf_ring *_buf_ring = nullptr;
+        size_t _buf_ring_size        = 0;
+        char *_bufs                  = nullptr;
+        uint16_t _buf_tail           = 0;
+
+        unsigned _to_submit = 0;
+        bool _recv_armed    = false;
+        bool _overrun       = false;
+        size_t _syscalls    = 0;
+
+        int setup (const unsigned entries);
+        void release ();
+        io_uring_sqe *get_sqe ();
+        void recycle (const uint16_t bid);
+        int enter (const unsigned to_submit, const unsigned min_complete, const int timeout_ms);
+        int reap (const datagram_handler &on_datagram, const send_handler &on_send);
+
+       public:
+        explicit nl_uring(const int fd, const unsigned entries = NL_URING_ENTRIES);
+        ~nl_uring();
+
+        void operator= (nl_uring const &) = delete;  // we won't copy file descripors and mappings
+        nl_uring(nl_uring const &)        = delete;
+
+        static bool supported ();
+
+        bool is_open () const { return _ring_fd >= 0; }
+        int get_fd () const { return _fd; }
+        size_t syscalls () const { return _syscalls; }
+
+        /**
+         * @brief
+         * Check and clear the overrun flag: the socket reported ENOBUFS, some datagrams are lost
+         */
+        bool take_overrun ()
+        {
+            bool overrun = _overrun;
+            _overrun     = false;
+            return overrun;
+        }
+
+        int send (const char *buf, const size_t length, const uint32_t id, const bool link = false);
+        int wait (const int timeout_ms, const datagram_handler &on_datagram, const send_handler &on_send = nullptr);
+
+        /**
+         * @brief
+         * Send a dump request and pass every reply message to on_message until NLMSG_DONE.
+         * Falls back to send()/recv() if io_uring is not available
+         * @param build build(nl_msg_builder&, uint32_t seq_num) writes the request
+         * @return int "0" - success; ">0" - a responce error code; "<0" - -errno
+         */
+        template <typename F>
+        int dump (F &&build, const std::function<void(nlmsghdr *)> &on_message)
+        {
+            nl_msg_builder &msg = local_msg_builder();
+            uint32_t seq_num    = ++a_seq_num;
+            build(msg, seq_num);
+            if ( msg.overflow() ) {
+                return -EMSGSIZE;
+            }
+
+            if ( not is_open() ) {
+                if ( send_msg(_fd, msg) == -1 ) {
+                    return -errno;
+                }
+                return recv_dump(_fd, seq_num, on_message);
+            }
+
+            int code  = 0;
+            bool done = false;
+            auto on_datagram = [&] (char *buf, size_t size) {
+                ssize_t msg_size = size;
+                nlmsghdr *nlh    = (nlmsghdr *)buf;
+                for ( ; not done and NLMSG_OK(nlh, msg_size); nlh = NLMSG_NEXT(nlh, msg_size) ) {
+                    if ( nlh->nlmsg_seq != seq_num ) {
+                        continue;
+                    }
+                    if ( nlh->nlmsg_type == NLMSG_DONE or nlh->nlmsg_type == NLMSG_ERROR ) {
+                        code = (nlh->nlmsg_type == NLMSG_ERROR) ? get_ack_code(nlh) : 0;
+                        done = true;
+                        break;
+                    }
+                    on_message(nlh);
+                }
+            };
+
+            int send_rc = send(msg.data(), msg.size(), 0);
+            if ( send_rc < 0 ) {
+                return send_rc;
+            }
+            while ( not done ) {
+                int rc = wait(NL_URING_DUMP_TIMEOUT_MS, on_datagram, [&send_rc] (uint32_t, int rc) { send_rc = rc; });
+                if ( send_rc < 0 ) {
+                    return send_rc;
+                }
+                if ( rc < 0 ) {
+                    return rc;
+                }
+                take_overrun();  // a dump is flow controlled, ENOBUFS here only means the buffers were busy
+            }
+            return code;
+        }
+    };
+}  // namespace nl_socket_handler
+
+#endif  //PROJECT_NL_URING_H
@@ -0,0 +1,59 @@
+#ifndef PROJECT_ROUTE_JOURNAL_H
+#define PROJECT_ROUTE_JOURNAL_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "route_store.h"
+
+#define ROUTE_JOURNAL_SIZE 4096  // deltas kept per table
+
+/**
+ * @brief
+ * One change of a table. The route is packed: route_v6 if is_v6, route_v4 otherwise
+ */
+struct route_delta
+{
+    enum e_op : uint8_t {
+        ADD    = 1,  // may replace a route with the same identity if the table was filled by a dump
+        DELETE = 2,
+        MODIFY = 3   // same identity, other proto/metrics. A replace with another gateway/oif is a DELETE and an ADD
+    };
+
+    uint64_t version = 0;
+    e_op op          = ADD;
+    bool is_v6       = false;
+    route_v4 v4      = {};
+    route_v6 v6      = {};
+};
+
+/**
+ * @brief
+ * Versioned ring of the last ROUTE_JOURNAL_SIZE changes of one table. Every change gets the next version, the table
+ * version is the version of its last change. A consumer keeps the version it has synced to (a cursor) and asks for the
+ * changes after it; if they have left the ring (or the journal was reset) it has to read the whole table again.
+ */
+class route_journal
+{
+    std::vector<route_delta> _ring = {};  // version % capacity to its delta
+    size_t _capacity               = ROUTE_JOURNAL_SIZE;
+    uint64_t _version              = 0;
+    uint64_t _floor                = 0;  // cursors below it have to resync
+
+    route_delta &next (const route_delta::e_op op);
+
+   public:
+    explicit route_journal(const size_t capacity = ROUTE_JOURNAL_SIZE)
+        : _capacity(capacity ? capacity : 1){};
+
+    uint64_t version () const { return _version; }
+    size_t size () const;
+
+    void record (const route_delta::e_op op, const route_v4 &route);
+    void record (const route_delta::e_op op, const route_v6 &route);
+    void reset ();
+
+    int changes_since (const uint64_t version, std::vector<route_delta> &deltas) const;
+};
+
+#endif  // PROJECT_ROUTE_JOURNAL_H
@@ -0,0 +1,107 @@
+#ifndef PROJECT_ROUTE_MULTIPATH_H
+#define PROJECT_ROUTE_MULTIPATH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+
+#define ROUTE_MULTIPATH_SEGMENT  4096  // hop lists per segment
+#define ROUTE_MULTIPATH_SEGMENTS 1024  // up to 4M hop lists alive at once
+
+/**
+ * @brief
+ * One path of an ECMP route (an rtnexthop of RTA_MULTIPATH): 24 bytes
+ */
+struct route_hop
+{
+    uint8_t gw[16]    = {0};  // IPv4 in the first 4 bytes
+    uint32_t iface_id = 0;
+    uint8_t family    = AF_UNSPEC;  // of gw, AF_UNSPEC - no gateway
+    uint8_t weight    = 1;          // rtnh_hops + 1
+
+    bool operator== (const route_hop &hop) const
+    {
+        return family == hop.family and iface_id == hop.iface_id and weight == hop.weight and memcmp(gw, hop.gw, sizeof(gw)) == 0;
+    }
+};
+
+/**
+ * @brief
+ * Interned hop lists of the ECMP routes. A packed route keeps only the id of its list (route_v4::HAS_MP), so
+ * single-path routes pay nothing and the routes with the same paths share one list. The routing tables hold
+ * a reference per stored route: a list is dropped when its last route is deleted, or at once by discard() if no
+ * table has taken it. Dropped lists are freed by retire_dropped() once the readers which could see them are gone
+ * (nl_epoch), then their ids are reused. intern(), retain(), release(), discard() and retire_dropped() are called
+ * by the updating thread, get() by any thread without locks. The hops of a route no table holds are valid until
+ * the route is applied
+ */
+class route_multipath
+{
+    struct hops_hash
+    {
+        size_t operator() (const std::vector<route_hop> &hops) const;
+    };
+
+    struct entry
+    {
+        std::vector<route_hop> hops = {};
+        uint32_t refs               = 0;      // routes of the tables
+        uint32_t drops              = 0;      // only the retirement of the last drop frees the list
+        bool live                   = false;  // may be returned by intern(), not dropped
+    };
+
+    std::atomic<entry *> _segments[ROUTE_MULTIPATH_SEGMENTS] = {};
+    std::atomic<uint32_t> _size                              = 0;  // ids handed out so far, freed ones included
+    std::unordered_map<std::vector<route_hop>, uint32_t, hops_hash> _ids = {};  // live hop list to its id
+    std::vector<uint32_t> _free                                          = {};  // freed ids
+    std::vector<std::pair<uint32_t, uint32_t>> _dropped                  = {};  // id and its drop, not retired yet
+
+    route_multipath() = default;
+    ~route_multipath();
+
+    entry &at (const uint32_t id) const
+    {
+        return _segments[(id - 1) / ROUTE_MULTIPATH_SEGMENT].load(std::memory_order_relaxed)[(id - 1) % ROUTE_MULTIPATH_SEGMENT];
+    }
+    void drop (const uint32_t id);
+
+   public:
+    static route_multipath &get_instance ()
+    {
+        static route_multipath instance;
+        return instance;
+    }
+
+    void operator= (route_multipath const &) = delete;
+    route_multipath(route_multipath const &) = delete;
+
+    uint32_t intern (const std::vector<route_hop> &hops);  // "0" - no hops or no room
+    void retain (const uint32_t id);
+    void release (const uint32_t id);
+    void discard (const uint32_t id);
+    void retire_dropped ();
+
+    /**
+     * @brief
+     * Hop list of the id, valid while a table holds a route with it (see retire_dropped())
+     * @return empty span - no such list
+     */
+    std::span<const route_hop> get (const uint32_t id) const
+    {
+        if ( not id or id > _size.load(std::memory_order_acquire) ) {
+            return {};
+        }
+        const entry *segment = _segments[(id - 1) / ROUTE_MULTIPATH_SEGMENT].load(std::memory_order_acquire);
+        return segment[(id - 1) % ROUTE_MULTIPATH_SEGMENT].hops;
+    }
+
+    size_t size () const { return _ids.size(); }  // live lists, the updating thread only
+};
+
+#endif  // PROJECT_ROUTE_MULTIPATH_H
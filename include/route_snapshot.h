@@ -0,0 +1,251 @@
+#ifndef PROJECT_ROUTE_SNAPSHOT_H
+#define PROJECT_ROUTE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "nl_epoch.h"
+#include "route_store.h"
+
+#define SNAPSHOT_CHUNK_SIZE 1024  // routes or index slots per copy-on-write chunk
+
+/**
+ * @brief
+ * Array of fixed size chunks shared by the writer and the snapshots. The writer copies a chunk before its first
+ * change after a snapshot has taken it, so publishing a snapshot costs one pointer per chunk.
+ * Chunk reference counts are changed only by the writer thread (readers don't copy snapshots)
+ */
+template <typename T>
+class cow_array
+{
+    std::vector<std::shared_ptr<std::vector<T>>> _chunks = {};
+
+   public:
+    size_t capacity () const { return _chunks.size() * SNAPSHOT_CHUNK_SIZE; }
+
+    const T &operator[] (const size_t pos) const { return (*_chunks[pos / SNAPSHOT_CHUNK_SIZE])[pos % SNAPSHOT_CHUNK_SIZE]; }
+
+    T &at (const size_t pos)  // writer
+    {
+        auto &chunk = _chunks[pos / SNAPSHOT_CHUNK_SIZE];
+        if ( chunk.use_count() > 1 ) {  // a snapshot shares it
+            chunk = std::make_shared<std::vector<T>>(*chunk);
+        }
+        return (*chunk)[pos % SNAPSHOT_CHUNK_SIZE];
+    }
+
+    void grow (const size_t count)
+    {
+        while ( capacity() < count ) {
+            _chunks.push_back(std::make_shared<std::vector<T>>(SNAPSHOT_CHUNK_SIZE));
+        }
+    }
+
+    void assign (const size_t count, const T &value)
+    {
+        _chunks.clear();
+        while ( capacity() < count ) {
+            _chunks.push_back(std::make_shared<std::vector<T>>(SNAPSHOT_CHUNK_SIZE, value));
+        }
+    }
+
+    size_t bytes () const { return capacity() * sizeof(T) + _chunks.size() * sizeof(_chunks[0]); }
+};
+
+/**
+ * @brief
+ * Packed routes over copy-on-write chunks with an open addressing index in chunks as well. A delete leaves
+ * a tombstone in the index, so every change writes at most two index slots (the moved route included)
+ * and touches only their chunks; the index is rebuilt when routes and tombstones fill half of it.
+ * R provides hash() and same()
+ */
+template <typename R>
+class cow_store
+{
+    static constexpr uint32_t EMPTY     = 0;
+    static constexpr uint32_t TOMBSTONE = UINT32_MAX;
+
+    cow_array<R> _routes        = {};
+    cow_array<uint32_t> _slots  = {};  // position + 1 into _routes, EMPTY or TOMBSTONE
+    size_t _size                = 0;
+    size_t _used                = 0;  // not empty slots: routes and tombstones
+    size_t _mask                = 0;
+
+    size_t slot_of (const R &route) const
+    {
+        uint64_t hash = route.hash();
+        return (hash ^ (hash >> 32)) & _mask;
+    }
+
+    /**
+     * @brief
+     * @return the slot holding the route or the slot where it would be inserted (the first tombstone on the way)
+     */
+    std::pair<bool, size_t> probe (const R &route) const
+    {
+        size_t slot      = slot_of(route);
+        size_t insert_at = SIZE_MAX;
+        while ( _slots[slot] != EMPTY ) {
+            if ( _slots[slot] == TOMBSTONE ) {
+                insert_at = insert_at == SIZE_MAX ? slot : insert_at;
+            } else if ( _routes[_slots[slot] - 1].same(route) ) {
+                return {true, slot};
+            }
+            slot = (slot + 1) & _mask;
+        }
+        return {false, insert_at == SIZE_MAX ? slot : insert_at};
+    }
+
+    void rehash (const size_t slots)
+    {
+        _slots.assign(slots, EMPTY);
+        _mask = slots - 1;
+        _used = _size;
+        for ( size_t pos = 0; pos < _size; ++pos ) {
+            size_t slot = slot_of(_routes[pos]);
+            while ( _slots[slot] != EMPTY ) {
+                slot = (slot + 1) & _mask;
+            }
+            _slots.at(slot) = pos + 1;
+        }
+    }
+
+   public:
+    size_t size () const { return _size; }
+    bool empty () const { return _size == 0; }
+    const R &operator[] (const size_t pos) const { return _routes[pos]; }
+    size_t bytes () const { return _routes.bytes() + _slots.bytes(); }
+
+    /**
+     * @brief
+     * @return std::pair<bool, size_t> was the route found or not; its position if it was
+     */
+    std::pair<bool, size_t> find (const R &route) const
+    {
+        if ( not _mask ) {
+            return {false, 0};
+        }
+        auto found = probe(route);
+        return {found.first, found.first ? _slots[found.second] - 1 : 0};
+    }
+
+    template <typename F>
+    void for_each (F on_route) const
+    {
+        for ( size_t pos = 0; pos < _size; ++pos ) {
+            on_route(_routes[pos]);
+        }
+    }
+
+    void clear ()
+    {
+        *this = cow_store();
+    }
+
+    /**
+     * @brief
+     * Insert the route or replace the route with the same identity
+     */
+    void upsert (const R &route)
+    {
+        if ( (_used + 1) * 2 > _mask + 1 ) {  // grow if the routes fill a quarter, drop the tombstones otherwise
+            size_t slots = (_size + 1) * 4 > _mask + 1 ? (_mask + 1) * 2 : _mask + 1;
+            rehash(std::max<size_t>(SNAPSHOT_CHUNK_SIZE, slots));
+        }
+        auto found = probe(route);
+        if ( found.first ) {
+            _routes.at(_slots[found.second] - 1) = route;
+            return;
+        }
+        _used += _slots[found.second] == EMPTY;
+        _routes.grow(_size + 1);
+        _routes.at(_size)         = route;
+        _slots.at(found.second) = ++_size;
+    }
+
+    bool erase (const R &route)
+    {
+        if ( not _mask ) {
+            return false;
+        }
+        auto found = probe(route);
+        if ( not found.first ) {
+            return false;
+        }
+        size_t pos               = _slots[found.second] - 1;
+        _slots.at(found.second) = TOMBSTONE;
+
+        size_t last = _size - 1;
+        if ( pos != last ) {  // swap-and-pop, the index of the moved route follows it
+            R moved     = _routes[last];
+            size_t slot = slot_of(moved);
+            while ( _slots[slot] != last + 1 ) {
+                slot = (slot + 1) & _mask;
+            }
+            _slots.at(slot) = pos + 1;
+            _routes.at(pos) = moved;
+        }
+        --_size;
+        return true;
+    }
+};
+
+/**
+ * @brief
+ * Immutable state of a table at a version (route_journal version)
+ */
+struct route_snapshot
+{
+    uint32_t rt_number = 0;
+    uint64_t version   = 0;
+    cow_store<route_v4> v4 = {};
+    cow_store<route_v6> v6 = {};
+};
+
+/**
+ * @brief
+ * Publisher of the snapshots of one table. The writer (the thread which updates linux_rt_manager) applies every change
+ * and publishes a snapshot once in a while, readers take the current one inside an nl_epoch::guard:
+ *
+ *     nl_epoch::guard guard;
+ *     const route_snapshot *snapshot = snapshots->current();
+ *
+ * Readers and the writer never wait for each other; an old snapshot is freed after its last reader has left
+ */
+class route_snapshots
+{
+    route_snapshot _next                          = {};  // writer copy
+    std::atomic<const route_snapshot *> _current = nullptr;
+    bool _changed                                 = true;
+
+   public:
+    explicit route_snapshots(const uint32_t rt_number)
+    {
+        _next.rt_number = rt_number;
+    }
+    ~route_snapshots();
+
+    void operator= (route_snapshots const &) = delete;  // readers point to us
+    route_snapshots(route_snapshots const &) = delete;
+
+    /**
+     * @brief
+     * The last published snapshot, nullptr - nothing has been published. Valid until the guard of the caller is destroyed
+     */
+    const route_snapshot *current () const { return _current.load(); }
+
+    void add (const route_v4 &route);
+    void add (const route_v6 &route);
+    void del (const route_v4 &route);
+    void del (const route_v6 &route);
+    void clear ();
+
+    bool changed () const { return _changed; }
+    void publish (const uint64_t version);
+};
+
+#endif  // PROJECT_ROUTE_SNAPSHOT_H
@@ -0,0 +1,299 @@
+#ifndef PROJECT_ROUTE_STORE_H
+#define PROJECT_ROUTE_STORE_H
+
+#include <stdint.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief
+ * Mix a value into a hash (boost::hash_combine with a 64-bit constant)
+ */
+inline uint64_t route_hash_mix (uint64_t hash, const uint64_t value)
+{
+    return hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+/**
+ * @brief
+ * Packed IPv4 route: 24 bytes, addresses in network byte order
+ */
+struct route_v4
+{
+    enum e_flags : uint8_t {
+        HAS_DEST = 1,  // RTA_DST was given (not a default route)
+        HAS_GW   = 2,
+        HAS_NH   = 4,  // gw holds the id of a nexthop object (RTA_NH_ID), the route has no gateway and oif of its own
+        HAS_MP   = 8   // gw holds the id of an ECMP hop list in route_multipath (RTA_MULTIPATH)
+    };
+
+    uint32_t dest      = 0;
+    uint32_t gw        = 0;
+    uint32_t rt_number = 0;
+    uint32_t priority  = 0;
+    uint32_t iface_id  = 0;
+    uint8_t mask_len   = 0;
+    uint8_t proto      = 0;
+    uint8_t metrics    = 0;
+    uint8_t flags      = 0;
+
+    /**
+     * @brief
+     * Same route identity: table, destination, prefix length, gateway, oif and priority
+     */
+    bool same (const route_v4 &route) const
+    {
+        return dest == route.dest and gw == route.gw and rt_number == route.rt_number and priority == route.priority  //
+               and iface_id == route.iface_id and mask_len == route.mask_len and flags == route.flags;
+    }
+
+    /**
+     * @brief
+     * Same key: table, destination, prefix length and priority. A replace of the kernel (NLM_F_REPLACE) changes
+     * the route with the same key
+     */
+    bool same_key (const route_v4 &route) const
+    {
+        return dest == route.dest and rt_number == route.rt_number and priority == route.priority and mask_len == route.mask_len;
+    }
+
+    uint32_t nh_id () const { return (flags & HAS_NH) ? gw : 0; }
+    uint32_t mp_id () const { return (flags & HAS_MP) ? gw : 0; }
+
+    /**
+     * @brief
+     * Hash of the key only, so the routes with the same key are on one probe chain (route_store::find_key())
+     */
+    uint64_t hash () const
+    {
+        uint64_t hash = route_hash_mix(0, ((uint64_t)dest << 32) | rt_number);
+        return route_hash_mix(hash, ((uint64_t)priority << 8) | mask_len);
+    }
+};
+
+/**
+ * @brief
+ * Packed IPv6 route: 48 bytes
+ */
+struct route_v6
+{
+    uint8_t dest[16]   = {};
+    uint8_t gw[16]     = {};
+    uint32_t rt_number = 0;
+    uint32_t priority  = 0;
+    uint32_t iface_id  = 0;
+    uint8_t mask_len   = 0;
+    uint8_t proto      = 0;
+    uint8_t metrics    = 0;
+    uint8_t flags      = 0;  // route_v4::e_flags
+
+    bool same (const route_v6 &route) const
+    {
+        return memcmp(dest, route.dest, sizeof(dest)) == 0 and memcmp(gw, route.gw, sizeof(gw)) == 0  //
+               and rt_number == route.rt_number and priority == route.priority and iface_id == route.iface_id  //
+               and mask_len == route.mask_len and flags == route.flags;
+    }
+
+    bool same_key (const route_v6 &route) const
+    {
+        return memcmp(dest, route.dest, sizeof(dest)) == 0 and rt_number == route.rt_number and priority == route.priority  //
+               and mask_len == route.mask_len;
+    }
+
+    uint32_t nh_id () const
+    {
+        uint32_t id = 0;
+        if ( flags & route_v4::HAS_NH ) {
+            memcpy(&id, gw, sizeof(id));
+        }
+        return id;
+    }
+    uint32_t mp_id () const
+    {
+        uint32_t id = 0;
+        if ( flags & route_v4::HAS_MP ) {
+            memcpy(&id, gw, sizeof(id));
+        }
+        return id;
+    }
+
+    uint64_t hash () const  // of the key only, as route_v4::hash()
+    {
+        uint64_t words[2];
+        memcpy(words, dest, sizeof(dest));
+        uint64_t hash = route_hash_mix(route_hash_mix(0, words[0]), words[1]);
+        hash          = route_hash_mix(hash, ((uint64_t)rt_number << 32) | priority);
+        return route_hash_mix(hash, mask_len);
+    }
+};
+
+/**
+ * @brief
+ * Dense array of packed routes with an open addressing index (linear probing over 4-byte positions).
+ * Find, insert and erase are O(1) on average; erase moves the last route into the freed position.
+ * R provides hash() of its key, same() and same_key()
+ */
+template <typename R>
+class route_store
+{
+    std::vector<R> _routes       = {};
+    std::vector<uint32_t> _slots = {};  // position + 1 into _routes, 0 - empty slot
+    size_t _mask                 = 0;
+
+    size_t slot_of (const R &route) const
+    {
+        uint64_t hash = route.hash();
+        return (hash ^ (hash >> 32)) & _mask;
+    }
+
+    void rehash (const size_t slots)
+    {
+        _slots.assign(slots, 0);
+        _mask = slots - 1;
+        for ( size_t pos = 0; pos < _routes.size(); ++pos ) {
+            size_t slot = slot_of(_routes[pos]);
+            while ( _slots[slot] ) {
+                slot = (slot + 1) & _mask;
+            }
+            _slots[slot] = pos + 1;
+        }
+    }
+
+    /**
+     * @brief
+     * @return the slot holding the route or the empty slot where it would be inserted
+     */
+    size_t probe (const R &route) const
+    {
+        size_t slot = slot_of(route);
+        while ( _slots[slot] and not _routes[_slots[slot] - 1].same(route) ) {
+            slot = (slot + 1) & _mask;
+        }
+        return slot;
+    }
+
+   public:
+    using const_iterator = typename std::vector<R>::const_iterator;
+
+    size_t size () const { return _routes.size(); }
+    bool empty () const { return _routes.empty(); }
+    const R &operator[] (const size_t pos) const { return _routes[pos]; }
+    R &at (const size_t pos) { return _routes[pos]; }  // the fields of same()/hash() must not be changed
+    const_iterator begin () const { return _routes.begin(); }
+    const_iterator end () const { return _routes.end(); }
+
+    /**
+     * @brief
+     * Memory used by the routes and the index
+     */
+    size_t bytes () const { return _routes.capacity() * sizeof(R) + _slots.capacity() * sizeof(uint32_t); }
+
+    void reserve (const size_t count)
+    {
+        _routes.reserve(count);
+        size_t slots = 16;
+        while ( slots < count * 2 ) {
+            slots <<= 1;
+        }
+        if ( slots > _slots.size() ) {
+            rehash(slots);
+        }
+    }
+
+    void clear ()
+    {
+        _routes.clear();
+        _slots.clear();
+        _mask = 0;
+    }
+
+    std::pair<bool, size_t> find (const R &route) const
+    {
+        if ( _slots.empty() ) {
+            return {false, 0};
+        }
+        size_t slot = probe(route);
+        if ( not _slots[slot] ) {
+            return {false, 0};
+        }
+        return {true, _slots[slot] - 1};
+    }
+
+    /**
+     * @brief
+     * @return std::pair<bool, size_t> was a route with the same key (R::same_key()) found or not; its position if it was
+     */
+    std::pair<bool, size_t> find_key (const R &route) const
+    {
+        if ( _slots.empty() ) {
+            return {false, 0};
+        }
+        for ( size_t slot = slot_of(route); _slots[slot]; slot = (slot + 1) & _mask ) {
+            if ( _routes[_slots[slot] - 1].same_key(route) ) {
+                return {true, _slots[slot] - 1};
+            }
+        }
+        return {false, 0};
+    }
+
+    /**
+     * @brief
+     * @param replace overwrite a route with the same identity (proto, metrics ...)
+     * @return true if the route has been inserted or replaced
+     */
+    bool insert (const R &route, const bool replace = false)
+    {
+        if ( (_routes.size() + 1) * 2 > _slots.size() ) {
+            rehash(_slots.empty() ? 16 : _slots.size() * 2);  // load factor <= 0.5
+        }
+        size_t slot = probe(route);
+        if ( _slots[slot] ) {
+            if ( replace ) {
+                _routes[_slots[slot] - 1] = route;
+            }
+            return replace;
+        }
+        _slots[slot] = _routes.size() + 1;
+        _routes.push_back(route);
+        return true;
+    }
+
+    bool erase (const R &route)
+    {
+        if ( _slots.empty() ) {
+            return false;
+        }
+        size_t slot = probe(route);
+        if ( not _slots[slot] ) {
+            return false;
+        }
+        size_t pos = _slots[slot] - 1;
+
+        // backward shift: pull up the entries of the probe chain which may not stay behind the hole
+        size_t hole = slot;
+        for ( size_t next = (hole + 1) & _mask; _slots[next]; next = (next + 1) & _mask ) {
+            size_t home = slot_of(_routes[_slots[next] - 1]);
+            bool stays  = (hole <= next) ? (hole < home and home <= next) : (hole < home or home <= next);
+            if ( not stays ) {
+                _slots[hole] = _slots[next];
+                hole         = next;
+            }
+        }
+        _slots[hole] = 0;
+
+        size_t last = _routes.size() - 1;
+        if ( pos != last ) {  // swap-and-pop, the index of the moved route follows it
+            size_t moved = slot_of(_routes[last]);
+            while ( _slots[moved] != last + 1 ) {
+                moved = (moved + 1) & _mask;
+            }
+            _slots[moved] = pos + 1;
+            _routes[pos]  = _routes[last];
+        }
+        _routes.pop_back();
+        return true;
+    }
+};
+
+#endif  // PROJECT_ROUTE_STORE_H
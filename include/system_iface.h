@@ -11,6 +11,8 @@
 #include "nl_socket_handler.h"
 #include "linux_route.h"
 
+struct nl_event_handlers;
+
 struct system_iface
 {
     bool ip_is_set               = false;
@@ -20,7 +22,6 @@ struct system_iface
     uint32_t linux_interface_id  = NO_SYSTEM_ID;
     uint32_t id_in_config        = -1;
     bool up                      = false;
-    struct sockaddr_nl nl_addr;
 
     std::string vrf_name     = NONE;
     uint32_t vrf_index       = NO_SYSTEM_ID;
@@ -28,7 +29,9 @@ struct system_iface
     uint32_t linux_rt_number = 0;
 
     int iface_fd  = 0;
-    int nl_socket = 0;
+    int nl_socket = 0;  // request socket from the nl_hub pool, not owned
+    uint64_t hub_subscription = 0;  // nl_hub subscription of attach()
+    nl_reactor *hub_reactor   = nullptr;  // the reactor of attach(), the hub is attached to it once for us
 
     system_iface(const std::string name, const std::string ip_addr, const bool already_allocated = true, const bool is_tap = true)
         : name(name), ip_addr(ip_addr)
@@ -63,6 +66,8 @@ struct system_iface
     static uint32_t search_iface (const int fd, const std ::string &name);
     bool update_routes (linux_route &route);
     int add_to_vrf (const std::string &linux_vrf_name);
+    int attach (nl_reactor &reactor, const nl_event_handlers &handlers);
+    int detach (nl_reactor &reactor);
 
     void stop ();
 };
@@ -0,0 +1,82 @@
+#ifndef PROJECT_VRF_REGISTRY_H
+#define PROJECT_VRF_REGISTRY_H
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "nl_events.h"
+
+struct vrf_entry
+{
+    std::string name   = "";
+    uint32_t ifindex   = 0;
+    uint32_t rt_number = 0;  // IFLA_VRF_TABLE
+    bool up            = false;
+};
+
+/**
+ * @brief
+ * Every VRF of the system: name to table number to ifindex. Learnt from the link_cache (one link dump) and kept live by
+ * the link events of the nl_hub, so per-VRF setup needs no netlink round trip. Listeners are told about every VRF
+ * which appears or disappears (a VRF which changes its table disappears with the old one). Lookups don't read the hub
+ * socket: the events are applied when the hub is drained (by its reactor or by poll()), callers without a reactor call
+ * sync() first. Called on one thread with the hub
+ */
+class vrf_registry
+{
+    using listener = std::function<void(const vrf_entry &vrf, const bool removed)>;
+
+    std::unordered_map<uint32_t, vrf_entry> _vrfs      = {};  // ifindex to its VRF
+    std::unordered_map<std::string, uint32_t> _names   = {};  // name to ifindex
+    std::unordered_map<uint32_t, uint32_t> _tables     = {};  // table number to ifindex
+    std::vector<std::pair<uint64_t, listener>> _listeners = {};
+    uint64_t _last_id                                  = 0;
+    uint64_t _subscription                             = 0;
+    bool _stale                                        = true;  // not filled yet or the hub has lost events
+
+    vrf_registry();
+    ~vrf_registry();
+
+    void add (const vrf_entry &vrf);
+    void remove (const uint32_t ifindex);
+    void notify (const vrf_entry &vrf, const bool removed);
+    void fill ();
+
+   public:
+    static vrf_registry &get_instance ()
+    {
+        static vrf_registry instance;
+        return instance;
+    }
+
+    void operator= (vrf_registry const &) = delete;
+    vrf_registry(vrf_registry const &)    = delete;
+
+    void apply (const link_event &event);  // fed by the hub, public for the events read by other sockets
+    void rebuild ();
+    void sync ();
+
+    const vrf_entry *find (const std::string &name);  // valid until the next event or rebuild
+    const vrf_entry *find_by_table (const uint32_t rt_number);
+    const vrf_entry *find_by_index (const uint32_t ifindex);
+    uint32_t rt_number (const std::string &name);    // "0" - no such VRF
+    size_t size ();
+
+    template <typename F>
+    void for_each (F on_vrf)
+    {
+        fill();
+        for ( const auto &[ifindex, vrf] : _vrfs ) {
+            on_vrf(vrf);
+        }
+    }
+
+    uint64_t listen (listener on_change);
+    bool unlisten (const uint64_t id);
+};
+
+#endif  // PROJECT_VRF_REGISTRY_H
@@ -0,0 +1,117 @@
+#include "link_cache.h"
+#include "nl_hub.h"
+
+link_cache::link_cache()
+{
+    nl_event_handlers handlers;
+    handlers.on_link    = [this] (const link_event &event) { apply(event); };
+    handlers.on_overrun = [this] () { _stale = true; };
+    _subscription       = nl_hub::get_instance().subscribe(NO_SYSTEM_ID, std::move(handlers));
+}
+
+link_cache::~link_cache()
+{
+    nl_hub::get_instance().unsubscribe(_subscription);  // the hub is created first, so it's destroyed after us
+}
+
+void link_cache::apply(const link_event &event)
+{
+    auto pos = _links.find(event.ifindex);
+    if ( pos != _links.end() ) {
+        auto name = _indexes.find(pos->second.name);
+        if ( name != _indexes.end() and name->second == event.ifindex ) {  // renamed or deleted
+            _indexes.erase(name);
+        }
+    }
+    if ( event.deleted ) {
+        if ( pos != _links.end() ) {
+            _links.erase(pos);
+        }
+        return;
+    }
+    _links[event.ifindex] = event;
+    _indexes[event.name]  = event.ifindex;
+}
+
+/**
+ * @brief
+ * Dump the interfaces if the cache isn't filled yet or some events are lost. No socket read otherwise
+ */
+void link_cache::fill()
+{
+    if ( _stale ) {
+        refill();
+    }
+}
+
+/**
+ * @brief
+ * Apply the events queued into the hub, dump the interfaces again if some events are lost. For the callers
+ * whose hub isn't drained by a reactor
+ */
+void link_cache::sync()
+{
+    nl_hub::get_instance().poll();
+    fill();
+}
+
+/**
+ * @brief
+ * Replace the cache with a dump of all the interfaces. The events queued meanwhile are applied by the next drain of
+ * the hub
+ * @return int "0" - success; "int" - error code absolute value; "<0" - -errno. The cache stays stale on error
+ */
+int link_cache::refill()
+{
+    std::unordered_map<uint32_t, link_event> links    = {};
+    std::unordered_map<std::string, uint32_t> indexes = {};
+    int rc = nl_socket_handler::request_get_link_list(nl_hub::get_instance().request_socket(), [&links, &indexes] (nlmsghdr *nlh) {
+        link_event event;
+        if ( link_event::parse(nlh, event) ) {
+            indexes[event.name]  = event.ifindex;
+            links[event.ifindex] = event;
+        }
+    });
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump interfaces: " << strerror(abs(rc)) << std::endl;
+        _stale = true;
+        return rc;
+    }
+    _links   = std::move(links);
+    _indexes = std::move(indexes);
+    _stale   = false;
+    ++_dumps;
+    return 0;
+}
+
+size_t link_cache::size()
+{
+    fill();
+    return _links.size();
+}
+
+const link_event *link_cache::find(const uint32_t ifindex)
+{
+    fill();
+    auto pos = _links.find(ifindex);
+    return pos == _links.end() ? nullptr : &pos->second;
+}
+
+const link_event *link_cache::find(const std::string &name)
+{
+    fill();
+    auto pos = _indexes.find(name);
+    return pos == _indexes.end() ? nullptr : &_links[pos->second];
+}
+
+uint32_t link_cache::ifindex(const std::string &name)
+{
+    const link_event *link = find(name);
+    return link ? link->ifindex : NO_SYSTEM_ID;
+}
+
+std::string link_cache::name(const uint32_t ifindex)
+{
+    const link_event *link = find(ifindex);
+    return link ? link->name : NONE;
+}
@@ -0,0 +1,173 @@
+#include "linux_neigh.h"
+#include "nl_hub.h"
+
+static bool same_neigh (const neigh_event &a, const neigh_event &b)
+{
+    return a.state == b.state and a.flags == b.flags and a.has_lladdr == b.has_lladdr and memcmp(a.lladdr, b.lladdr, sizeof(a.lladdr)) == 0;
+}
+
+int linux_neigh_manager::open_nl_socket()
+{
+    nl_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if ( nl_socket == -1 ) {
+        std::cerr << "Failed to create NL socket: " << strerror(errno) << std::endl;
+        return -1;
+    }
+    if ( nl_socket_handler::set_rcvbuf(nl_socket) < 0 ) {  // an ARP storm is a burst of events
+        std::cerr << "Failed to size NL socket receive buffer: " << strerror(errno) << std::endl;
+    }
+
+    sockaddr_nl nl_addr = {};
+    nl_addr.nl_family   = AF_NETLINK;
+    nl_addr.nl_groups   = RTMGRP_NEIGH;
+    if ( bind(nl_socket, (sockaddr *)&nl_addr, sizeof(nl_addr)) < 0 ) {
+        std::cerr << "Failed to bind NL socket: " << strerror(errno) << std::endl;
+        return -1;
+    }
+    return 1;
+}
+
+void linux_neigh_manager::stop()
+{
+    if ( nl_socket >= 0 ) {
+        close(nl_socket);
+        nl_socket = -1;
+    }
+}
+
+/**
+ * @brief
+ * Apply one neighbour event. The bridge FDB events of the same group are skipped
+ * @return int "0" - the mirror has been changed; "-1" - nothing to change
+ */
+int linux_neigh_manager::update(const neigh_event &event)
+{
+    if ( event.family != AF_INET and event.family != AF_INET6 ) {
+        return -1;
+    }
+    neigh_key key(event.ifindex, event.family, event.addr);
+    if ( event.deleted ) {
+        return m_neighs.erase(key) ? 0 : -1;
+    }
+    auto [pos, added] = m_neighs.try_emplace(key, event);
+    if ( not added ) {
+        if ( same_neigh(pos->second, event) ) {
+            return -1;
+        }
+        pos->second = event;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Replace the mirror with a dump of the neighbour tables. The dump goes through an nl_hub request socket,
+ * the events queued meanwhile aren't lost
+ * @param on_change called for every entry which differs from the mirror, the removed ones come as deleted events
+ * @return int count of neighbours; "<0" - the dump failed, the mirror isn't changed
+ */
+int linux_neigh_manager::update_all(const std::function<void(const neigh_event &)> &on_change)
+{
+    std::unordered_map<neigh_key, neigh_event, neigh_key::hash> neighs = {};
+    int rc = nl_socket_handler::request_get_neigh_list(nl_hub::get_instance().request_socket(), [&neighs] (nlmsghdr *nlh) {
+        neigh_event event;
+        if ( neigh_event::parse(nlh, event) and (event.family == AF_INET or event.family == AF_INET6) ) {  // no bridge FDB
+            neighs[neigh_key(event.ifindex, event.family, event.addr)] = event;
+        }
+    });
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump neighbours: " << strerror(abs(rc)) << std::endl;
+        _resync_needed = true;
+        return -abs(rc);
+    }
+
+    if ( on_change ) {
+        for ( auto &[key, event] : neighs ) {
+            auto pos = m_neighs.find(key);
+            if ( pos == m_neighs.end() or not same_neigh(pos->second, event) ) {
+                on_change(event);
+            }
+        }
+        for ( auto &[key, event] : m_neighs ) {
+            if ( not neighs.count(key) ) {
+                neigh_event deleted = event;
+                deleted.deleted     = true;
+                on_change(deleted);
+            }
+        }
+    }
+    m_neighs       = std::move(neighs);
+    _resync_needed = false;
+    ++_resyncs;
+    return m_neighs.size();
+}
+
+/**
+ * @brief
+ * Drain the notification socket and apply every neighbour event, dump the tables again if some are lost
+ * @param on_change called for every change of the mirror
+ * @return int count of changes; "-errno" - the socket can't be read
+ */
+int linux_neigh_manager::apply_notifications(const std::function<void(const neigh_event &)> &on_change)
+{
+    int changed = 0;
+    int rc      = nl_socket_handler::drain_notifications(
+        nl_socket,
+        [this, &changed, &on_change] (nlmsghdr *nlh) {
+            neigh_event event;
+            if ( neigh_event::parse(nlh, event) and update(event) == 0 ) {
+                ++changed;
+                if ( on_change ) {
+                    on_change(event);
+                }
+            }
+            return true;
+        },
+        [this] () {
+            ++_overruns;
+            _resync_needed = true;
+        });
+    if ( rc < 0 ) {
+        std::cerr << "Failed to read NL socket " << nl_socket << ": " << strerror(-rc) << std::endl;
+        return rc;
+    }
+    if ( _resync_needed ) {
+        update_all([&changed, &on_change] (const neigh_event &event) {
+            ++changed;
+            if ( on_change ) {
+                on_change(event);
+            }
+        });
+    }
+    return changed;
+}
+
+/**
+ * @brief
+ * Let the reactor deliver the neighbour events instead of polling apply_notifications()
+ * @param on_change called after the mirror was changed
+ * @return int "0" - success; "-errno" - the socket can't be registered
+ */
+int linux_neigh_manager::attach(nl_reactor &reactor, std::function<void(const neigh_event &)> on_change)
+{
+    nl_event_handlers handlers;
+    handlers.on_neigh = [this, on_change] (const neigh_event &event) {
+        if ( update(event) == 0 and on_change ) {
+            on_change(event);
+        }
+    };
+    handlers.on_overrun = [this, on_change, &reactor] () {
+        ++_overruns;
+        if ( _resync_needed ) {
+            return;
+        }
+        _resync_needed = true;
+        reactor.post([this, on_change] () { update_all(on_change); });  // after the queued events of the socket
+    };
+    return reactor.add_socket(nl_socket, std::move(handlers));
+}
+
+int linux_neigh_manager::detach(nl_reactor &reactor)
+{
+    return reactor.remove_socket(nl_socket);
+}
@@ -1,4 +1,6 @@
 #include "linux_route.h"
+#include "nl_reactor.h"
+#include "vrf_registry.h"
 
 linux_route linux_route::parse_route_from_nl_resp_hdr(nlmsghdr *nlh)
 {
@@ -16,6 +18,7 @@ linux_route linux_route::parse_route_from_nl_resp_hdr(nlmsghdr *nlh)
 
     /* Get the route atttibutes len */
     int route_attribute_len = RTM_PAYLOAD(nlh);
+    bool no_room            = false;  // for the hop list
     /* Loop through all attributes */
     for ( ; RTA_OK(route_attribute, route_attribute_len);
           route_attribute = RTA_NEXT(route_attribute, route_attribute_len) ) {
@@ -54,7 +57,7 @@ linux_route linux_route::parse_route_from_nl_resp_hdr(nlmsghdr *nlh)
         }
 
         if ( route_attribute->rta_type == RTA_PRIORITY ) {
-            route.priority = *(uint8_t *)RTA_DATA(route_attribute);
+            route.priority = *(uint32_t *)RTA_DATA(route_attribute);
             continue;
         }
 
@@ -64,48 +67,356 @@ linux_route linux_route::parse_route_from_nl_resp_hdr(nlmsghdr *nlh)
         }
 
         if ( route_attribute->rta_type == RTA_OIF ) {
-            route.iface_id = *(uint8_t *)RTA_DATA(route_attribute);
+            route.iface_id = *(uint32_t *)RTA_DATA(route_attribute);
+            continue;
+        }
+
+        if ( route_attribute->rta_type == RTA_NH_ID ) {
+            route.nh_id = *(uint32_t *)RTA_DATA(route_attribute);
+            continue;
+        }
+
+        if ( route_attribute->rta_type == RTA_MULTIPATH and not route.nh_id ) {  // the kernel puts RTA_NH_ID before it
+            route.mp_id = parse_multipath(route_attribute, route_entry->rtm_family);
+            no_room     = not route.mp_id;
             continue;
         }
     }
+    if ( route_entry->rtm_family == AF_INET6 and route.dest.ss_family == AF_UNSPEC ) {  // ::/0 has no RTA_DST, yet it isn't 0.0.0.0/0
+        route.dest.ss_family = AF_INET6;
+    }
+    if ( route.nh_id ) {  // the kernel adds the gateway and oif of the nexthop, they're stale after the nexthop is replaced
+        memset(&route.gw, 0, sizeof(route.gw));
+        route.iface_id = 0;
+        route.mp_id    = 0;
+    }
 
     if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
-        route.status = linux_route::e_status::NEW;
+        route.status = (nlh->nlmsg_flags & NLM_F_REPLACE) ? linux_route::e_status::REPLACE : linux_route::e_status::NEW;
     };
     if ( nlh->nlmsg_type == RTM_DELROUTE ) {
         route.status = linux_route::e_status::DELETE;
     };
+    if ( no_room and not route.nh_id ) {  // not a change the tables can apply
+        route.status = linux_route::e_status::EMPTY;
+    }
     return route;
 
     // std::cout << route << endl;
 }
 
-int linux_routing_table::update(const linux_route &route, const bool need_to_check)
+/**
+ * @brief
+ * Decode the rtnexthop array of RTA_MULTIPATH and intern it
+ * @return uint32_t id of the hop list in route_multipath, "0" - no hops or no room for the list
+ */
+uint32_t linux_route::parse_multipath(const rtattr *multipath, const uint8_t family)
+{
+    thread_local std::vector<route_hop> hops;  // no allocation per route
+    hops.clear();
+
+    int len = RTA_PAYLOAD(multipath);
+    for ( rtnexthop *rtnh = (rtnexthop *)RTA_DATA(multipath); RTNH_OK(rtnh, len); len -= NLMSG_ALIGN(rtnh->rtnh_len), rtnh = RTNH_NEXT(rtnh) ) {
+        route_hop &hop = hops.emplace_back();
+        hop.iface_id   = rtnh->rtnh_ifindex;
+        hop.weight     = rtnh->rtnh_hops + 1;
+
+        int attr_len = rtnh->rtnh_len - sizeof(rtnexthop);
+        for ( rtattr *attr = RTNH_DATA(rtnh); RTA_OK(attr, attr_len); attr = RTA_NEXT(attr, attr_len) ) {
+            if ( attr->rta_type == RTA_GATEWAY ) {
+                memcpy(hop.gw, RTA_DATA(attr), std::min<size_t>(RTA_PAYLOAD(attr), sizeof(hop.gw)));
+                hop.family = family;
+            }
+        }
+    }
+    uint32_t id = route_multipath::get_instance().intern(hops);
+    if ( not id and not hops.empty() ) {
+        std::cerr << "No room for an ECMP hop list, " << route_multipath::get_instance().size() << " lists are in use" << std::endl;
+    }
+    return id;
+}
+
+linux_route::linux_route(const route_v4 &route)
+    : linux_route()
+{
+    if ( route.flags & route_v4::HAS_DEST ) {
+        ((sockaddr_in *)&dest)->sin_addr.s_addr = route.dest;
+        dest.ss_family                          = AF_INET;
+    }
+    if ( route.flags & route_v4::HAS_GW ) {
+        ((sockaddr_in *)&gw)->sin_addr.s_addr = route.gw;
+        gw.ss_family                          = AF_INET;
+    }
+    nh_id     = route.nh_id();
+    mp_id     = route.mp_id();
+    rt_number = route.rt_number;
+    priority  = route.priority;
+    iface_id  = route.iface_id;
+    mask_len  = route.mask_len;
+    proto     = route.proto;
+    metrics   = route.metrics;
+    status    = e_status::NEW;
+}
+
+linux_route::linux_route(const route_v6 &route)
+    : linux_route()
+{
+    if ( route.flags & route_v4::HAS_DEST ) {
+        memcpy(&((sockaddr_in6 *)&dest)->sin6_addr, route.dest, sizeof(route.dest));
+        dest.ss_family = AF_INET6;
+    }
+    if ( route.flags & route_v4::HAS_GW ) {
+        memcpy(&((sockaddr_in6 *)&gw)->sin6_addr, route.gw, sizeof(route.gw));
+        gw.ss_family = AF_INET6;
+    }
+    nh_id     = route.nh_id();
+    mp_id     = route.mp_id();
+    rt_number = route.rt_number;
+    priority  = route.priority;
+    iface_id  = route.iface_id;
+    mask_len  = route.mask_len;
+    proto     = route.proto;
+    metrics   = route.metrics;
+    status    = e_status::NEW;
+}
+
+route_v4 linux_route::to_v4() const
+{
+    route_v4 route;
+    if ( dest.ss_family == AF_INET ) {
+        route.dest = ((sockaddr_in *)&dest)->sin_addr.s_addr;
+        route.flags |= route_v4::HAS_DEST;
+    }
+    if ( gw.ss_family == AF_INET ) {
+        route.gw = ((sockaddr_in *)&gw)->sin_addr.s_addr;
+        route.flags |= route_v4::HAS_GW;
+    } else if ( nh_id ) {
+        route.gw = nh_id;
+        route.flags |= route_v4::HAS_NH;
+    } else if ( mp_id ) {
+        route.gw = mp_id;
+        route.flags |= route_v4::HAS_MP;
+    }
+    route.rt_number = rt_number;
+    route.priority  = priority;
+    route.iface_id  = iface_id;
+    route.mask_len  = mask_len;
+    route.proto     = proto;
+    route.metrics   = metrics;
+    return route;
+}
+
+route_v6 linux_route::to_v6() const
+{
+    route_v6 route;
+    if ( dest.ss_family == AF_INET6 ) {
+        memcpy(route.dest, &((sockaddr_in6 *)&dest)->sin6_addr, sizeof(route.dest));
+        route.flags |= route_v4::HAS_DEST;
+    }
+    if ( gw.ss_family == AF_INET6 ) {
+        memcpy(route.gw, &((sockaddr_in6 *)&gw)->sin6_addr, sizeof(route.gw));
+        route.flags |= route_v4::HAS_GW;
+    } else if ( nh_id ) {
+        memcpy(route.gw, &nh_id, sizeof(nh_id));
+        route.flags |= route_v4::HAS_NH;
+    } else if ( mp_id ) {
+        memcpy(route.gw, &mp_id, sizeof(mp_id));
+        route.flags |= route_v4::HAS_MP;
+    }
+    route.rt_number = rt_number;
+    route.priority  = priority;
+    route.iface_id  = iface_id;
+    route.mask_len  = mask_len;
+    route.proto     = proto;
+    route.metrics   = metrics;
+    return route;
+}
+
+/**
+ * @brief
+ * Get the routing table number of a route message without parsing the rest of it
+ */
+uint32_t linux_route::rt_number_from_nl_resp_hdr(nlmsghdr *nlh)
+{
+    rtmsg *route_entry      = (struct rtmsg *)NLMSG_DATA(nlh);
+    rtattr *route_attribute = (struct rtattr *)RTM_RTA(route_entry);
+    int route_attribute_len = RTM_PAYLOAD(nlh);
+    for ( ; RTA_OK(route_attribute, route_attribute_len); route_attribute = RTA_NEXT(route_attribute, route_attribute_len) ) {
+        if ( route_attribute->rta_type == RTA_TABLE ) {  // the kernel puts it first
+            return *(uint32_t *)RTA_DATA(route_attribute);
+        }
+    }
+    return route_entry->rtm_table;
+}
+
+template <typename R>
+static void retain_hops (const route_store<R> &store, const bool retain)
 {
-    std::pair<bool, size_t> index = {false, 0};
-    if ( need_to_check ) {
-        index = find(route);  // O(n)
+    route_multipath &multipath = route_multipath::get_instance();
+    for ( const R &route : store ) {
+        retain ? multipath.retain(route.mp_id()) : multipath.release(route.mp_id());
     }
-    if ( (not index.first) and route.status == linux_route::e_status::NEW ) {
-        _table.push_back(route);
+}
+
+/**
+ * @brief
+ * A copy holds its own references to the ECMP hop lists of its routes
+ */
+linux_routing_table::linux_routing_table(const linux_routing_table &rt)
+    : _v4(rt._v4), _v6(rt._v6), _routes(rt._routes), _routes_changed(rt._routes_changed), _rt_number(rt._rt_number), _vrf_name(rt._vrf_name)
+{
+    retain_hops(_v4, true);
+    retain_hops(_v6, true);
+}
+
+linux_routing_table::~linux_routing_table()
+{
+    retain_hops(_v4, false);
+    retain_hops(_v6, false);
+}
+
+linux_routing_table &linux_routing_table::operator= (linux_routing_table rt)
+{
+    retain_hops(_v4, false);
+    retain_hops(_v6, false);
+    const_cast<std::string &>(this->_vrf_name) = rt._vrf_name;
+    const_cast<uint32_t &>(this->_rt_number)   = rt._rt_number;
+    this->_v4                                  = std::move(rt._v4);
+    this->_v6                                  = std::move(rt._v6);
+    this->_routes                              = std::move(rt._routes);
+    this->_routes_changed                      = rt._routes_changed;
+    return *this;
+}
+
+template <typename R>
+static int insert_route (route_store<R> &store, const R &route, const bool need_to_check)
+{
+    if ( not need_to_check ) {
+        size_t count = store.size();
+        store.insert(route, true);
+        if ( store.size() != count ) {
+            route_multipath::get_instance().retain(route.mp_id());
+        }
         return 0;
     }
-    if ( index.first and route.status == linux_route::e_status::DELETE ) {
-        _table.erase(_table.begin() + index.second);
+    auto found = store.find(route);
+    if ( not found.first ) {
+        store.insert(route);
+        route_multipath::get_instance().retain(route.mp_id());
         return 0;
     }
+    const R &stored = store[found.second];
+    if ( stored.proto == route.proto and stored.metrics == route.metrics ) {
+        return -1;
+    }
+    store.insert(route, true);
+    return 1;
+}
 
-    return -1;
+/**
+ * @brief
+ * Put the route in place of the stored one with the same key: the same route, or else one with the same table,
+ * destination, prefix length and priority
+ * @return int "0" - there is no such route, the route is added; "1" - the route has been replaced;
+ * "-1" - the route is already there
+ */
+template <typename R>
+static int replace_route (route_store<R> &store, const R &route, R &replaced)
+{
+    auto found = store.find(route);
+    if ( not found.first ) {
+        found = store.find_key(route);
+    }
+    if ( not found.first ) {
+        store.insert(route);
+        route_multipath::get_instance().retain(route.mp_id());
+        return 0;
+    }
+    replaced = store[found.second];
+    if ( replaced.same(route) and replaced.proto == route.proto and replaced.metrics == route.metrics ) {
+        return -1;
+    }
+    store.erase(replaced);  // the gateway/oif is a part of the identity, the route moves in the index
+    store.insert(route);
+    route_multipath::get_instance().retain(route.mp_id());  // before the release: the lists may be the same one
+    route_multipath::get_instance().release(replaced.mp_id());
+    return 1;
+}
+
+/**
+ * @brief
+ * Add a NEW route or remove a DELETE one. A delete moves the last route into the freed position (swap-and-pop)
+ * @param need_to_check false - the route is known to be new (a dump): an existing route with the same identity is replaced
+ * @return int "0" - the route has been added/deleted; "1" - a route with the same identity has got other proto/metrics;
+ * "-1" - the route is already there (NEW) or hasn't been found (DELETE)
+ */
+int linux_routing_table::update(const linux_route &route, const bool need_to_check)
+{
+    if ( route.status == linux_route::e_status::REPLACE ) {
+        linux_route replaced;
+        return replace(route, replaced);
+    }
+    int rc = -1;
+    if ( route.status == linux_route::e_status::NEW ) {
+        rc = route.is_v6() ? insert_route(_v6, route.to_v6(), need_to_check) : insert_route(_v4, route.to_v4(), need_to_check);
+    }
+    if ( route.status == linux_route::e_status::DELETE ) {
+        rc = (route.is_v6() ? _v6.erase(route.to_v6()) : _v4.erase(route.to_v4())) ? 0 : -1;
+        if ( rc == 0 ) {
+            route_multipath::get_instance().release(route.mp_id);  // a part of the identity: the one of the erased route
+        }
+    }
+    if ( rc >= 0 ) {
+        release_view();
+    } else {
+        route_multipath::get_instance().discard(route.mp_id);
+    }
+    return rc;
 };
 
-std::pair<bool, size_t> linux_routing_table::find(const linux_route &route) const
+/**
+ * @brief
+ * Apply a REPLACE route: one change of the table instead of a DELETE and a NEW
+ * @param replaced the route which has been replaced (status DELETE), if the result is "1"
+ * @return int "0" - there was no route to replace, the route is added; "1" - a route has been replaced;
+ * "-1" - the route is already there
+ */
+int linux_routing_table::replace(const linux_route &route, linux_route &replaced)
 {
-    for ( size_t i = 0, n = _table.size(); i < n; ++i ) {
-        if ( _table[i] == route ) {
-            return {true, i};
+    int rc = -1;
+    if ( route.is_v6() ) {
+        route_v6 old;
+        rc = replace_route(_v6, route.to_v6(), old);
+        if ( rc == 1 ) {
+            replaced = linux_route(old);
+        }
+    } else {
+        route_v4 old;
+        rc = replace_route(_v4, route.to_v4(), old);
+        if ( rc == 1 ) {
+            replaced = linux_route(old);
         }
     }
-    return {false, 0};
+    if ( rc == 1 ) {
+        replaced.status = linux_route::e_status::DELETE;
+    }
+    if ( rc >= 0 ) {
+        release_view();
+    }
+    return rc;
+}
+
+/**
+ * @brief
+ * @return std::pair<bool, size_t> was the route found or not; its index into get() if it was
+ */
+std::pair<bool, size_t> linux_routing_table::find(const linux_route &route) const
+{
+    if ( route.is_v6() ) {
+        auto found = _v6.find(route.to_v6());
+        return {found.first, _v4.size() + found.second};
+    }
+    return _v4.find(route.to_v4());
 };
 
 void linux_routing_table::change_vrf_name(const std::string &name)
@@ -114,14 +425,48 @@ void linux_routing_table::change_vrf_name(const std::string &name)
     return;
 }
 
-std::vector<linux_route> *linux_routing_table::get()
+/**
+ * @brief
+ * linux_route view of the table for the code which works with sockaddr_storage. The routes are stored packed,
+ * the view is a read-only copy (~400 bytes a route) built by the first call after a change and released by the
+ * next change, so only the tables which are read by get() pay for it. Iterate routes_v4()/routes_v6() instead
+ * where possible
+ */
+const std::vector<linux_route> *linux_routing_table::get()
 {
-    return &_table;
+    if ( _routes_changed ) {
+        _routes.reserve(size());
+        for ( const route_v4 &route : _v4 ) {
+            _routes.emplace_back(route);
+        }
+        for ( const route_v6 &route : _v6 ) {
+            _routes.emplace_back(route);
+        }
+        _routes_changed = false;
+    }
+    return &_routes;
 };
 
+void linux_routing_table::release_view()
+{
+    if ( not _routes.empty() ) {
+        std::vector<linux_route>().swap(_routes);
+    }
+    _routes_changed = true;
+}
+
 uint32_t linux_routing_table::size() const
 {
-    return _table.size();
+    return _v4.size() + _v6.size();
+}
+
+/**
+ * @brief
+ * Memory used by the stored routes and their index (without the get() view)
+ */
+size_t linux_routing_table::bytes() const
+{
+    return _v4.bytes() + _v6.bytes();
 }
 
 uint32_t linux_routing_table::get_routes_from_nl_resp(const char *nl_sock_resp_buf, ssize_t msg_size)
@@ -137,6 +482,25 @@ uint32_t linux_routing_table::get_routes_from_nl_resp(const char *nl_sock_resp_b
     return counter;
 }
 
+/**
+ * @brief
+ * Dump the table from the kernel and parse the routes while they are received
+ * @param fd netlink socket fd
+ * @return uint32_t - count of received routes
+ */
+uint32_t linux_routing_table::get_routes_from_nl_dump(const int fd)
+{
+    size_t counter = 0;
+    int rc         = nl_socket_handler::request_get_route_list(fd, _rt_number, [this, &counter] (nlmsghdr *nlh) {
+        update(linux_route::parse_route_from_nl_resp_hdr(nlh), false);  // no need to check. The kernel stores unique routes
+        ++counter;
+    });
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump routing table " << _rt_number << ": " << strerror(abs(rc)) << std::endl;
+    }
+    return counter;
+}
+
 int linux_rt_manager::open_nl_socket()
 {
     memset(&nl_addr, 0, sizeof(nl_addr));
@@ -151,6 +515,9 @@ int linux_rt_manager::open_nl_socket()
         std::cerr << "Failed to create NL socket: " << strerror(errno) << std::endl;
         return -1;
     }
+    if ( nl_socket_handler::set_rcvbuf(nl_socket) < 0 ) {  // the default one overruns on a burst of route events
+        std::cerr << "Failed to size NL socket receive buffer: " << strerror(errno) << std::endl;
+    }
     // struct timeval tv;
     // tv.tv_sec = 1;
     // tv.tv_usec = 0;
@@ -166,6 +533,10 @@ int linux_rt_manager::open_nl_socket()
         std::cerr << "Failed to bind NL socket: " << strerror(errno) << std::endl;
         return -1;
     };
+    int group = RTNLGRP_NEXTHOP;  // no RTMGRP_ mask for it
+    if ( setsockopt(nl_socket, SOL_NETLINK, NETLINK_ADD_MEMBERSHIP, &group, sizeof(group)) < 0 ) {
+        std::cerr << "Failed to join the nexthop group: " << strerror(errno) << std::endl;
+    }
     return 1;
 }
 
@@ -191,9 +562,96 @@ void linux_rt_manager::follow_rt(const uint32_t rt_number, std::string vrf_name)
     add_name(rt_number, vrf_name);
     followed_rt_list.push_back(rt_number);
     m_tables[rt_number] = linux_routing_table(rt_number, get_name(rt_number));
+    m_journals[rt_number].reset();
+    rebuild_views(rt_number);
+    publish_snapshots();
     return;
 }
 
+/**
+ * @brief
+ * Stop following the table: drop it with its lookups, journal and snapshots. The snapshots are freed
+ * once the readers have left them, the route_snapshots pointer must not be used after the call
+ * @return int "0" - success; "-1" - rt_number is not followed
+ */
+int linux_rt_manager::unfollow_rt(const uint32_t rt_number)
+{
+    if ( not rt_number_is_followed(rt_number) ) {
+        return -1;
+    }
+    std::erase(followed_rt_list, rt_number);
+    std::erase(m_vrf_tables, rt_number);
+    m_tables.erase(rt_number);
+    m_lpm.erase(rt_number);
+    m_lpm6.erase(rt_number);
+    m_journals.erase(rt_number);
+    m_name.erase(rt_number);
+    m_id.erase(rt_number);
+
+    auto snapshots = m_snapshots.find(rt_number);
+    if ( snapshots != m_snapshots.end() ) {
+        nl_epoch::get_instance().retire([retired = snapshots->second.release()] () { delete retired; });
+        m_snapshots.erase(snapshots);
+    }
+    route_multipath::get_instance().retire_dropped();
+    _was_changed = true;
+    return 0;
+}
+
+/**
+ * @brief
+ * Follow the table of every VRF (vrf_registry, no netlink round trip per VRF): the existing ones now,
+ * the new ones once they appear. The tables of removed VRFs are unfollowed, the names are kept current.
+ * The routes of the existing VRF tables are read by one dump of all the tables. A new VRF table is dumped when it
+ * starts being followed: its routes may have been notified before the hub has delivered the link event
+ * @return int count of routes into the followed tables; "<0" - the dump failed
+ */
+int linux_rt_manager::follow_vrfs()
+{
+    vrf_registry &vrfs = vrf_registry::get_instance();
+    auto on_vrf        = [this] (const vrf_entry &vrf, const bool removed, const bool dump) {
+        bool own = std::find(m_vrf_tables.begin(), m_vrf_tables.end(), vrf.rt_number) != m_vrf_tables.end();
+        if ( removed ) {
+            if ( own ) {
+                unfollow_rt(vrf.rt_number);
+            }
+            return;
+        }
+        if ( not rt_number_is_followed(vrf.rt_number) ) {
+            if ( dump ) {
+                update(vrf.rt_number, vrf.name);  // follows the table and dumps it through a request socket
+            } else {
+                follow_rt(vrf.rt_number, vrf.name);
+            }
+            m_vrf_tables.push_back(vrf.rt_number);
+            return;
+        }
+        m_name[vrf.rt_number] = vrf.name;
+        m_tables[vrf.rt_number].change_vrf_name(vrf.name);
+    };
+    if ( not _vrf_listener ) {
+        _vrf_listener = vrfs.listen([on_vrf] (const vrf_entry &vrf, const bool removed) { on_vrf(vrf, removed, true); });
+    }
+    vrfs.sync();
+    vrfs.for_each([&on_vrf] (const vrf_entry &vrf) { on_vrf(vrf, false, false); });  // dumped together by update_all()
+    return update_all();
+}
+
+/**
+ * @brief
+ * Stop following the VRFs: the tables followed by follow_vrfs() are unfollowed
+ */
+void linux_rt_manager::unfollow_vrfs()
+{
+    if ( _vrf_listener ) {
+        vrf_registry::get_instance().unlisten(_vrf_listener);
+        _vrf_listener = 0;
+    }
+    for ( uint32_t rt_number : std::vector<uint32_t>(m_vrf_tables) ) {
+        unfollow_rt(rt_number);
+    }
+}
+
 std::vector<uint32_t> linux_rt_manager::get_follow_list() const
  {
     return followed_rt_list;
@@ -224,8 +682,11 @@ int linux_rt_manager::update(const linux_routing_table &table)
     if (not rt_number_is_followed(table._rt_number)){
         return -1;
     };
-    _was_changed               = true;
+    _was_changed = true;
+    journal_diff(m_tables[table._rt_number], table);
     m_tables[table._rt_number] = table;
+    rebuild_views(table._rt_number);
+    publish_snapshots();
     return 0;
 };
 
@@ -233,14 +694,64 @@ int linux_rt_manager::update(const linux_route &route, const bool need_to_check)
 {
     auto pos = m_tables.find(route.rt_number);
     if ( pos == m_tables.end() ) {
+        route_multipath::get_instance().discard(route.mp_id);
         return -1;
     }
     auto _table = &(pos->second);
 
-    if ( _table->update(route, need_to_check) < 0 ) {
+    linux_route replaced;  // by a REPLACE route
+    int rc = (route.status == linux_route::e_status::REPLACE) ? _table->replace(route, replaced) : _table->update(route, need_to_check);
+    if ( rc < 0 ) {
         return -1;
     }
     _was_changed = true;
+
+    route_delta::e_op op = (route.status == linux_route::e_status::DELETE) ? route_delta::DELETE : (rc == 1) ? route_delta::MODIFY : route_delta::ADD;
+    route_journal &journal = m_journals[route.rt_number];
+    bool moved = replaced.status == linux_route::e_status::DELETE  // another gateway/oif is another identity
+                 and not(route.is_v6() ? replaced.to_v6().same(route.to_v6()) : replaced.to_v4().same(route.to_v4()));
+    if ( moved ) {  // the consumers find the old route by its identity
+        route.is_v6() ? journal.record(route_delta::DELETE, replaced.to_v6()) : journal.record(route_delta::DELETE, replaced.to_v4());
+        op = route_delta::ADD;
+    }
+    route.is_v6() ? journal.record(op, route.to_v6()) : journal.record(op, route.to_v4());
+
+    bool add = route.status != linux_route::e_status::DELETE;
+    bool del = replaced.status == linux_route::e_status::DELETE;  // the replaced route may have another identity
+    if ( route.is_v6() ) {
+        auto lpm = m_lpm6.find(route.rt_number);
+        if ( lpm != m_lpm6.end() ) {
+            if ( del ) {
+                lpm->second->del(replaced.to_v6());
+            }
+            add ? lpm->second->add(route.to_v6()) : lpm->second->del(route.to_v6());
+        }
+    } else {
+        auto lpm = m_lpm.find(route.rt_number);
+        if ( lpm != m_lpm.end() ) {
+            if ( del ) {
+                lpm->second->del(replaced.to_v4());
+            }
+            add ? lpm->second->add(route.to_v4()) : lpm->second->del(route.to_v4());
+        }
+    }
+
+    auto snapshots = m_snapshots.find(route.rt_number);
+    if ( snapshots != m_snapshots.end() ) {
+        if ( route.is_v6() ) {
+            if ( del ) {
+                snapshots->second->del(replaced.to_v6());
+            }
+            add ? snapshots->second->add(route.to_v6()) : snapshots->second->del(route.to_v6());
+        } else {
+            if ( del ) {
+                snapshots->second->del(replaced.to_v4());
+            }
+            add ? snapshots->second->add(route.to_v4()) : snapshots->second->del(route.to_v4());
+        }
+    } else if ( m_snapshots.empty() ) {  // no reader can hold the hop lists of the deleted routes
+        route_multipath::get_instance().retire_dropped();
+    }
     return 0;
 };
 
@@ -249,7 +760,7 @@ int linux_rt_manager::update(const linux_route &route, const bool need_to_check)
   * Send NL response to update all the routing table 
   * 
   * @param rt_number - number of linux routing table
-  * @return int - counts of routes into the routing table
+  * @return int - counts of routes into the routing table; "-1" - no request socket, the resync is needed
   */
 int linux_rt_manager::update(const uint32_t rt_number, const std::string &vrf_name)
 {
@@ -257,20 +768,65 @@ int linux_rt_manager::update(const uint32_t rt_number, const std::string &vrf_na
     if (not rt_number_is_followed(rt_number)){
         follow_rt(rt_number,vrf_name);
     };
-    char *result     = nullptr;
-    size_t dump_size = 0;
-
-    result    = new char[BUF_SIZE];
-    dump_size = nl_socket_handler::request_get_route_list(nl_socket, rt_number, result, BUF_SIZE);
-
+    int fd = nl_socket_handler::open_request_socket();  // the notification socket would drop the events queued meanwhile
+    if ( fd < 0 ) {
+        _resync_needed = true;
+        return -1;
+    }
     linux_routing_table rt(rt_number, get_name(rt_number));
-    auto count = rt.get_routes_from_nl_resp(result, dump_size);
+    auto count = rt.get_routes_from_nl_dump(fd);
+    close(fd);
     update(rt); // _was_changed = true ;
 
-    delete[] result;
     return count;
 };
 
+/**
+ * @brief
+ * Resync all the followed tables by one dump of every table: one kernel FIB walk instead of one per table.
+ * Routes of the tables which are not followed are skipped before parsing. The dump goes through a separate socket
+ * as resync() does
+ * @return int - count of routes into the followed tables; "<0" - the dump failed, the tables are not changed
+ */
+int linux_rt_manager::update_all()
+{
+    update_nexthops();
+    std::map<uint32_t, linux_routing_table> tables = {};
+    for ( auto &[rt_number, table] : m_tables ) {
+        tables.emplace(rt_number, linux_routing_table(rt_number, table._vrf_name));
+    }
+
+    int fd = nl_socket_handler::open_request_socket();  // the notification socket would drop the events queued meanwhile
+    if ( fd < 0 ) {
+        _resync_needed = true;
+        return -1;
+    }
+    int count = 0;
+    int rc    = nl_socket_handler::request_get_route_list(fd, RT_TABLE_UNSPEC, [&tables, &count] (nlmsghdr *nlh) {
+        auto pos = tables.find(linux_route::rt_number_from_nl_resp_hdr(nlh));
+        if ( pos == tables.end() ) {
+            return;
+        }
+        pos->second.update(linux_route::parse_route_from_nl_resp_hdr(nlh), false);  // no need to check. The kernel stores unique routes
+        ++count;
+    });
+    close(fd);
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump routing tables: " << strerror(abs(rc)) << std::endl;
+        _resync_needed = true;
+        return -abs(rc);
+    }
+
+    for ( auto &[rt_number, table] : tables ) {
+        journal_diff(m_tables[rt_number], table);
+        m_tables[rt_number] = std::move(table);
+        rebuild_views(rt_number);
+    }
+    _was_changed = true;
+    publish_snapshots();
+    return count;
+}
+
 /**
  * @brief 
  * Finding a route into saved routing tables
@@ -291,7 +847,8 @@ std::pair<bool,size_t> linux_rt_manager::find(const linux_route &route) const
 
 /**
  * @brief 
- * Chech if at least one table was changed
+ * Chech if at least one table was changed since the last get(). Use version()/changes_since()
+ * to know which table and which routes have changed
  * 
  * @return true - was 
  * @return false -wasn't
@@ -358,7 +915,7 @@ std::string linux_rt_manager::get_name(const uint32_t rt_number) const
     return "";
 }
 
-std::vector<linux_route> *linux_rt_manager::get(const uint32_t rt_number)
+const std::vector<linux_route> *linux_rt_manager::get(const uint32_t rt_number)
 {
     _was_changed = false;
 
@@ -375,52 +932,502 @@ uint32_t linux_rt_manager::get_routes_from_nl_resp(const uint32_t rt_number, con
 {
     _was_changed = true;
 
-    auto pos = m_tables.find(rt_number);
-    if ( pos == m_tables.end() ) {
-        m_tables[rt_number] = linux_routing_table(rt_number, get_name(rt_number));
-    }
-    auto _table = &(pos->second);
+    auto pos = m_tables.try_emplace(rt_number, rt_number, get_name(rt_number)).first;  // a new table if it isn't followed
 
-    return _table->get_routes_from_nl_resp(nl_sock_resp_buf, msg_size);
+    uint32_t count = pos->second.get_routes_from_nl_resp(nl_sock_resp_buf, msg_size);
+    m_journals[rt_number].reset();  // the routes are added in place, there is no old table to diff with
+    rebuild_views(rt_number);
+    publish_snapshots();
+    return count;
 }
 
+/**
+ * @brief
+ * Take one route notification. The notifications are drained in batches (see catch_route_update_notifications()),
+ * the routes which aren't returned yet are kept for the next calls, so none of them is lost
+ * @return true - the route has been taken; false - no notification is queued
+ */
 bool linux_rt_manager::catch_route_update_notification(linux_route &route)
 {
-    ssize_t msg_size = 0;
-    char nl_sock_resp_buf[BUF_SIZE] = {0};
+    if ( m_pending.empty() ) {
+        std::vector<linux_route> routes;
+        catch_route_update_notifications(routes);
+        m_pending.insert(m_pending.end(), routes.begin(), routes.end());
+    }
+    if ( m_pending.empty() ) {
+        return false;
+    }
+    route = m_pending.front();
+    m_pending.pop_front();
+    return true;
+}
+
+/**
+ * @brief
+ * Drain the notification socket until EAGAIN and parse every route message of every datagram
+ * @param routes the route events are appended to it in the order the kernel has sent them
+ * @return int count of appended routes; "-errno" - the socket can't be read
+ */
+int linux_rt_manager::catch_route_update_notifications(std::vector<linux_route> &routes)
+{
+    size_t count = m_pending.size();
+    routes.insert(routes.end(), m_pending.begin(), m_pending.end());
+    m_pending.clear();
 
-    struct nlmsghdr *nlh;
-    while ( 1 ) {
-        msg_size = recv(nl_socket, nl_sock_resp_buf, BUF_SIZE, 0);
-        if ( msg_size <= 0 ) {
-            break;
+    int rc = nl_socket_handler::drain_notifications(
+        nl_socket,
+        [this, &routes, &count] (nlmsghdr *nlh) {
+            if ( nlh->nlmsg_type == RTM_NEWROUTE or nlh->nlmsg_type == RTM_DELROUTE ) {
+                routes.push_back(linux_route::parse_route_from_nl_resp_hdr(nlh));
+                ++count;
+                return true;
+            }
+            nexthop_event nexthop;
+            if ( nexthop_event::parse(nlh, nexthop) and update(nexthop) == 0 and nexthop.deleted ) {
+                for ( const linux_route &route : nexthop_routes(nexthop.id) ) {  // deleted by the kernel without events
+                    routes.push_back(route);
+                    ++count;
+                }
+            }
+            return true;
+        },
+        [this] () {
+            ++_overruns;
+            _resync_needed = true;
+        });
+    if ( rc < 0 ) {
+        std::cerr << "Failed to read NL socket " << nl_socket << ": " << strerror(-rc) << std::endl;
+        return rc;
+    }
+    return count;
+}
+
+/**
+ * @brief
+ * Drain the notification socket and apply every route event to the followed tables
+ * @return int count of changes of the followed tables; "-errno" - the socket can't be read
+ */
+int linux_rt_manager::apply_route_update_notifications()
+{
+    std::vector<linux_route> routes;
+    int rc = catch_route_update_notifications(routes);
+    if ( rc < 0 ) {
+        return rc;
+    }
+    int changed = 0;
+    for ( const linux_route &route : routes ) {
+        changed += update(route) == 0;
+    }
+    if ( _resync_needed ) {  // some events are lost, the applied ones aren't enough
+        rc = resync();
+        changed += rc > 0 ? rc : 0;
+    }
+    if ( changed ) {
+        publish_snapshots();
+    }
+    return changed;
+}
+
+/**
+ * @brief
+ * Let the reactor deliver route notifications instead of polling catch_route_update_notification().
+ * Every notification for a followed table is applied to it.
+ * @param reactor event loop the manager socket is registered in
+ * @param on_change called after a followed table was changed
+ * @return int "0" - success; "-errno" - the socket can't be registered
+ */
+int linux_rt_manager::attach(nl_reactor &reactor, std::function<void(const linux_route &)> on_change)
+{
+    nl_event_handlers handlers;
+    auto on_route = [this, on_change, &reactor] (const linux_route &route) {
+        if ( update(route) != 0 ) {
+            return;
         }
-        nlh = (struct nlmsghdr *)nl_sock_resp_buf;
-        // If we received all data
-        if ( nlh->nlmsg_type == NLMSG_DONE ) {
-            break;
+        if ( not m_snapshots.empty() and not _publish_posted ) {  // one snapshot for all the notifications of a loop iteration
+            _publish_posted = true;
+            reactor.post([this] () {
+                _publish_posted = false;
+                publish_snapshots();
+            });
         }
-        if ( nlh->nlmsg_type == RTM_DELROUTE ) {
-            break;
+        if ( on_change ) {
+            on_change(route);
         }
-        if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
-            break;
+    };
+    handlers.on_route   = on_route;
+    handlers.on_nexthop = [this, on_route] (const nexthop_event &nexthop) {
+        if ( update(nexthop) == 0 and nexthop.deleted ) {
+            for ( const linux_route &route : nexthop_routes(nexthop.id) ) {  // deleted by the kernel without events
+                on_route(route);
+            }
         }
-        if ( nl_addr.nl_groups == RTMGRP_IPV4_ROUTE ) {
-            break;
+    };
+    handlers.on_overrun = [this, on_change, &reactor] () {
+        ++_overruns;
+        if ( _resync_needed ) {
+            return;
         }
-        if ( nl_addr.nl_groups == RTMGRP_IPV6_ROUTE ) {
-            break;
+        _resync_needed = true;
+        reactor.post([this, on_change] () { resync(on_change); });  // after the queued events of the socket
+    };
+    return reactor.add_socket(nl_socket, std::move(handlers));
+}
+
+int linux_rt_manager::detach(nl_reactor &reactor)
+{
+    return reactor.remove_socket(nl_socket);
+}
+
+/**
+ * @brief
+ * Build the IPv4 and IPv6 longest prefix match for the table. They're kept up to date by every later update of the table.
+ * DIR-24-8 takes 64 MB per table, so they're built only for the tables which need lookups
+ * @return int "0" - success; "-1" - rt_number is not followed
+ */
+int linux_rt_manager::enable_lookup(const uint32_t rt_number)
+{
+    if ( not rt_number_is_followed(rt_number) ) {
+        return -1;
+    }
+    if ( m_lpm.find(rt_number) == m_lpm.end() ) {
+        m_lpm[rt_number]  = std::make_unique<lpm_v4>();
+        m_lpm6[rt_number] = std::make_unique<lpm_v6>();
+    }
+    rebuild_views(rt_number);
+    return 0;
+}
+
+/**
+ * @brief
+ * Rebuild the lookup engines and the snapshot copy of a table which has been replaced
+ */
+void linux_rt_manager::rebuild_views(const uint32_t rt_number)
+{
+    auto table = m_tables.find(rt_number);
+    if ( table == m_tables.end() ) {
+        return;
+    }
+    auto snapshots = m_snapshots.find(rt_number);
+    if ( snapshots != m_snapshots.end() ) {
+        snapshots->second->clear();
+        for ( const route_v4 &route : table->second.routes_v4() ) {
+            snapshots->second->add(route);
+        }
+        for ( const route_v6 &route : table->second.routes_v6() ) {
+            snapshots->second->add(route);
         }
     }
 
-    for ( ; NLMSG_OK(nlh, msg_size);
-          nlh = NLMSG_NEXT(nlh, msg_size) ) {
+    auto lpm = m_lpm.find(rt_number);
+    if ( lpm == m_lpm.end() ) {
+        return;
+    }
+    lpm->second->clear();
+    for ( const route_v4 &route : table->second.routes_v4() ) {
+        lpm->second->add(route);
+    }
+    auto &lpm6 = m_lpm6[rt_number];
+    lpm6->clear();
+    for ( const route_v6 &route : table->second.routes_v6() ) {
+        lpm6->add(route);
+    }
+}
 
-        route = linux_route::parse_route_from_nl_resp_hdr(nlh);
-        if (route.status != linux_route::e_status::EMPTY){
-            return true;
+/**
+ * @brief
+ * Longest prefix match into a table with enabled lookup
+ * @param addr IPv4 address in network byte order
+ * @return const route_v4* the best route; nullptr - no route or the lookup isn't enabled for the table
+ */
+const route_v4 *linux_rt_manager::lookup(const uint32_t rt_number, const in_addr_t addr) const
+{
+    auto lpm = m_lpm.find(rt_number);
+    if ( lpm == m_lpm.end() ) {
+        return nullptr;
+    }
+    return lpm->second->lookup(addr);
+}
+
+/**
+ * @brief
+ * Batched longest prefix match, see lpm_v4::lookup()
+ * @return int "0" - success; "-1" - the lookup isn't enabled for the table
+ */
+int linux_rt_manager::lookup(const uint32_t rt_number, const in_addr_t *addrs, const size_t count, const route_v4 **results) const
+{
+    auto lpm = m_lpm.find(rt_number);
+    if ( lpm == m_lpm.end() ) {
+        return -1;
+    }
+    lpm->second->lookup(addrs, count, results);
+    return 0;
+}
+
+const route_v6 *linux_rt_manager::lookup(const uint32_t rt_number, const in6_addr &addr) const
+{
+    auto lpm = m_lpm6.find(rt_number);
+    if ( lpm == m_lpm6.end() ) {
+        return nullptr;
+    }
+    return lpm->second->lookup(addr);
+}
+
+/**
+ * @brief
+ * Batched IPv6 longest prefix match, see lpm_v6::lookup()
+ * @return int "0" - success; "-1" - the lookup isn't enabled for the table
+ */
+int linux_rt_manager::lookup(const uint32_t rt_number, const in6_addr *addrs, const size_t count, const route_v6 **results) const
+{
+    auto lpm = m_lpm6.find(rt_number);
+    if ( lpm == m_lpm6.end() ) {
+        return -1;
+    }
+    lpm->second->lookup(addrs, count, results);
+    return 0;
+}
+
+/**
+ * @brief
+ * Visit the difference between two stores of a table: on_delta(op, route) for every added, modified and deleted route
+ */
+template <typename R, typename F>
+static void store_diff (const route_store<R> &old_routes, const route_store<R> &new_routes, F on_delta)
+{
+    for ( const R &route : new_routes ) {
+        auto found = old_routes.find(route);
+        if ( not found.first ) {
+            on_delta(route_delta::ADD, route);
+        } else if ( old_routes[found.second].proto != route.proto or old_routes[found.second].metrics != route.metrics ) {
+            on_delta(route_delta::MODIFY, route);
+        }
+    }
+    for ( const R &route : old_routes ) {
+        if ( not new_routes.find(route).first ) {
+            on_delta(route_delta::DELETE, route);
+        }
+    }
+}
+
+/**
+ * @brief
+ * Journal the difference between the table and the one which replaces it, so a resync costs the consumers
+ * only the routes which have really changed
+ */
+void linux_rt_manager::journal_diff(const linux_routing_table &old_table, const linux_routing_table &new_table)
+{
+    route_journal &journal = m_journals[new_table._rt_number];
+    auto record            = [&journal] (route_delta::e_op op, const auto &route) { journal.record(op, route); };
+    store_diff(old_table.routes_v4(), new_table.routes_v4(), record);
+    store_diff(old_table.routes_v6(), new_table.routes_v6(), record);
+}
+
+/**
+ * @brief
+ * Version of the table: the version of its last change
+ * @return uint64_t "0" - the table has never been changed or isn't followed
+ */
+uint64_t linux_rt_manager::version(const uint32_t rt_number) const
+{
+    auto pos = m_journals.find(rt_number);
+    return pos == m_journals.end() ? 0 : pos->second.version();
+}
+
+/**
+ * @brief
+ * Get the changes of the table since the cursor and move the cursor to the current version. Doesn't touch was_changed()
+ * @param cursor the version the consumer has synced to, "0" - nothing has been read yet
+ * @param deltas the changes are appended to it, oldest first
+ * @return int "0" - the deltas have been appended; "1" - the consumer has fallen out of the journal:
+ * read the whole table by get() and go on from the new cursor; "-1" - rt_number is not followed
+ */
+int linux_rt_manager::changes_since(const uint32_t rt_number, uint64_t &cursor, std::vector<route_delta> &deltas) const
+{
+    if ( not rt_number_is_followed(rt_number) ) {
+        return -1;
+    }
+    auto pos = m_journals.find(rt_number);
+    if ( pos == m_journals.end() ) {
+        return cursor == 0 ? 0 : 1;
+    }
+    int rc = pos->second.changes_since(cursor, deltas);
+    cursor = pos->second.version();
+    return rc;
+}
+
+/**
+ * @brief
+ * Publish immutable snapshots of the table for reader threads (see route_snapshots). Call it on the thread which updates
+ * the manager, before the readers start. Snapshots are published after every table resync, once per reactor loop
+ * iteration if the manager is attached, and by publish_snapshots()
+ * @return const route_snapshots* the publisher readers take the snapshots from; nullptr - rt_number is not followed
+ */
+const route_snapshots *linux_rt_manager::enable_snapshots(const uint32_t rt_number)
+{
+    if ( not rt_number_is_followed(rt_number) ) {
+        return nullptr;
+    }
+    auto &snapshots = m_snapshots[rt_number];
+    if ( not snapshots ) {
+        snapshots = std::make_unique<route_snapshots>(rt_number);
+        rebuild_views(rt_number);
+        snapshots->publish(version(rt_number));
+    }
+    return snapshots.get();
+}
+
+/**
+ * @brief
+ * Publish a snapshot of every changed table and free the old ones no reader holds
+ */
+void linux_rt_manager::publish_snapshots()
+{
+    for ( auto &[rt_number, snapshots] : m_snapshots ) {
+        if ( snapshots->changed() ) {
+            snapshots->publish(version(rt_number));
+        }
+    }
+    route_multipath::get_instance().retire_dropped();  // after the snapshots without their routes
+    nl_epoch::get_instance().reclaim();
+}
+
+/**
+ * @brief
+ * Resync the followed tables after lost notifications (ENOBUFS) without replacing them: one dump of every table
+ * marks the routes the kernel has, then only the difference is applied route by route. The routes which the kernel
+ * doesn't have any more are swept. Journals, lookups and snapshots get only the real changes, the tables nobody has
+ * touched stay as they are. The dump goes through a separate socket, the notifications queued meanwhile aren't lost
+ * @param on_change called for every applied change
+ * @return int count of changed routes; "<0" - the dump failed, the resync is still needed
+ */
+int linux_rt_manager::resync(const std::function<void(const linux_route &)> &on_change)
+{
+    _resync_needed = false;
+    update_nexthops();
+    std::map<uint32_t, linux_routing_table> dumped = {};
+    for ( auto &[rt_number, table] : m_tables ) {
+        dumped.emplace(rt_number, linux_routing_table(rt_number, table._vrf_name));
+    }
+
+    int fd = nl_socket_handler::open_request_socket();
+    if ( fd < 0 ) {
+        _resync_needed = true;
+        return -1;
+    }
+    int rc = nl_socket_handler::request_get_route_list(fd, RT_TABLE_UNSPEC, [&dumped] (nlmsghdr *nlh) {
+        auto pos = dumped.find(linux_route::rt_number_from_nl_resp_hdr(nlh));
+        if ( pos != dumped.end() ) {
+            pos->second.update(linux_route::parse_route_from_nl_resp_hdr(nlh), false);
+        }
+    });
+    close(fd);
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump routing tables: " << strerror(abs(rc)) << std::endl;
+        _resync_needed = true;
+        return -abs(rc);
+    }
+
+    std::vector<linux_route> changes = {};
+    auto collect = [&changes] (route_delta::e_op op, const auto &route) {
+        changes.emplace_back(route);
+        changes.back().status = op == route_delta::DELETE ? linux_route::DELETE : linux_route::NEW;
+    };
+    for ( auto &[rt_number, table] : dumped ) {
+        store_diff(m_tables[rt_number].routes_v4(), table.routes_v4(), collect);
+        store_diff(m_tables[rt_number].routes_v6(), table.routes_v6(), collect);
+    }
+
+    int changed = 0;
+    for ( const linux_route &route : changes ) {
+        if ( update(route) == 0 ) {
+            ++changed;
+            if ( on_change ) {
+                on_change(route);
+            }
+        }
+    }
+    ++_resyncs;
+    publish_snapshots();
+    return changed;
+}
+
+/**
+ * @brief
+ * Apply a nexthop event. A deleted nexthop is dropped from the groups too, as the kernel does
+ * @return int "0" - the nexthops have been changed; "-1" - nothing to change
+ */
+int linux_rt_manager::update(const nexthop_event &nexthop)
+{
+    if ( not nexthop.deleted ) {
+        m_nexthops[nexthop.id] = nexthop;
+        return 0;
+    }
+    if ( not m_nexthops.erase(nexthop.id) ) {
+        return -1;
+    }
+    for ( auto &[id, group] : m_nexthops ) {
+        auto end         = std::remove_if(group.group, group.group + group.group_size, [&nexthop] (const nexthop_grp &member) { return member.id == nexthop.id; });
+        group.group_size = end - group.group;  // an empty group is deleted by the kernel with its own event
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Replace the nexthops with a dump of the kernel ones. The dump goes through a separate socket
+ * @return int count of nexthops; "<0" - the dump failed, the nexthops are not changed
+ */
+int linux_rt_manager::update_nexthops()
+{
+    int fd = nl_socket_handler::open_request_socket();
+    if ( fd < 0 ) {
+        return -1;
+    }
+    std::unordered_map<uint32_t, nexthop_event> nexthops = {};
+    int rc = nl_socket_handler::request_get_nexthop_list(fd, [&nexthops] (nlmsghdr *nlh) {
+        nexthop_event nexthop;
+        if ( nexthop_event::parse(nlh, nexthop) ) {
+            nexthops[nexthop.id] = nexthop;
+        }
+    });
+    close(fd);
+    if ( rc != 0 ) {
+        std::cerr << "Failed to dump nexthops: " << strerror(abs(rc)) << std::endl;
+        return -abs(rc);
+    }
+    m_nexthops = std::move(nexthops);
+    return m_nexthops.size();
+}
+
+/**
+ * @brief
+ * The nexthop object or group a route refers to (linux_route::nh_id, route_v4::nh_id())
+ * @return nullptr - no such nexthop
+ */
+const nexthop_event *linux_rt_manager::find_nexthop(const uint32_t nh_id) const
+{
+    auto pos = m_nexthops.find(nh_id);
+    return pos == m_nexthops.end() ? nullptr : &pos->second;
+}
+
+/**
+ * @brief
+ * Routes of the followed tables which use the nexthop, as deletions
+ */
+std::vector<linux_route> linux_rt_manager::nexthop_routes(const uint32_t nh_id) const
+{
+    std::vector<linux_route> routes = {};
+    for ( const auto &[rt_number, table] : m_tables ) {
+        for ( const route_v4 &route : table.routes_v4() ) {
+            if ( route.nh_id() == nh_id ) {
+                routes.emplace_back(route).status = linux_route::DELETE;
+            }
+        }
+        for ( const route_v6 &route : table.routes_v6() ) {
+            if ( route.nh_id() == nh_id ) {
+                routes.emplace_back(route).status = linux_route::DELETE;
+            }
         }
     }
-    return false;
+    return routes;
 }
@@ -0,0 +1,256 @@
+#include "lpm_v4.h"
+
+lpm_v4::lpm_v4()
+    : _tbl24(LPM_V4_TBL24_SIZE, 0)
+{
+}
+
+void lpm_v4::clear()
+{
+    std::fill(_tbl24.begin(), _tbl24.end(), 0);
+    _tbl8.clear();
+    _free_groups.clear();
+    _results.clear();
+    _free_results.clear();
+    _rules.clear();
+    _alternates.clear();
+}
+
+/**
+ * @brief
+ * Memory used by the tables, the results and the rules (approximately for the hash maps)
+ */
+size_t lpm_v4::bytes() const
+{
+    return (_tbl24.capacity() + _tbl8.capacity()) * sizeof(uint32_t) + _results.capacity() * sizeof(route_v4)  //
+           + _rules.size() * (sizeof(std::pair<uint64_t, rule>) + 2 * sizeof(void *))                        //
+           + _alternates.size() * (sizeof(std::pair<uint64_t, route_v4>) + 2 * sizeof(void *));
+}
+
+uint32_t lpm_v4::alloc_result(const route_v4 &route)
+{
+    if ( not _free_results.empty() ) {
+        uint32_t index = _free_results.back();
+        _free_results.pop_back();
+        _results[index] = route;
+        return index;
+    }
+    _results.push_back(route);
+    return _results.size() - 1;
+}
+
+/**
+ * @brief
+ * Get a tbl8 group with every entry set to the value of the tbl24 entry it extends
+ */
+uint32_t lpm_v4::alloc_group(const uint32_t fill)
+{
+    uint32_t group = 0;
+    if ( not _free_groups.empty() ) {
+        group = _free_groups.back();
+        _free_groups.pop_back();
+    } else {
+        group = _tbl8.size() / LPM_V4_TBL8_SIZE;
+        _tbl8.resize(_tbl8.size() + LPM_V4_TBL8_SIZE);
+    }
+    std::fill(_tbl8.begin() + (size_t)group * LPM_V4_TBL8_SIZE, _tbl8.begin() + (size_t)(group + 1) * LPM_V4_TBL8_SIZE, fill);
+    return group;
+}
+
+/**
+ * @brief
+ * Write the value into the entries of the prefix.
+ * Add (remove = false): entries filled by a shorter or the same prefix are overwritten, longer prefixes are kept.
+ * Delete (remove = true): only entries filled by this prefix (its depth) are overwritten, with the covering prefix or 0
+ */
+void lpm_v4::fill(const uint32_t prefix, const uint8_t depth, const uint32_t value, const bool remove)
+{
+    auto apply = [depth, value, remove] (uint32_t &entry) {
+        bool own = remove ? ((entry & VALID) and depth_of(entry) == depth) : (not(entry & VALID) or depth_of(entry) <= depth);
+        if ( own ) {
+            entry = value;
+        }
+    };
+
+    if ( depth <= 24 ) {
+        uint32_t first = prefix >> 8;
+        uint32_t count = 1u << (24 - depth);
+        for ( uint32_t i = first; i < first + count; ++i ) {
+            uint32_t &entry = _tbl24[i];
+            if ( not(entry & EXTENDED) ) {
+                apply(entry);
+                continue;
+            }
+            uint32_t *group = &_tbl8[(size_t)(entry & INDEX) * LPM_V4_TBL8_SIZE];
+            for ( uint32_t j = 0; j < LPM_V4_TBL8_SIZE; ++j ) {
+                apply(group[j]);
+            }
+        }
+        return;
+    }
+
+    uint32_t &entry = _tbl24[prefix >> 8];
+    if ( not(entry & EXTENDED) ) {
+        if ( remove ) {
+            return;
+        }
+        entry = EXTENDED | alloc_group(entry);
+    }
+    uint32_t *group = &_tbl8[(size_t)(entry & INDEX) * LPM_V4_TBL8_SIZE];
+    uint32_t first  = prefix & 0xff;
+    uint32_t count  = 1u << (32 - depth);
+    for ( uint32_t j = first; j < first + count; ++j ) {
+        apply(group[j]);
+    }
+}
+
+/**
+ * @brief
+ * Give the tbl8 group back if no prefix longer than /24 is left in it
+ */
+void lpm_v4::try_collapse(const uint32_t tbl24_index)
+{
+    uint32_t &entry = _tbl24[tbl24_index];
+    if ( not(entry & EXTENDED) ) {
+        return;
+    }
+    uint32_t group     = entry & INDEX;
+    const uint32_t *it = &_tbl8[(size_t)group * LPM_V4_TBL8_SIZE];
+    for ( uint32_t j = 0; j < LPM_V4_TBL8_SIZE; ++j ) {
+        if ( it[j] != it[0] or ((it[j] & VALID) and depth_of(it[j]) > 24) ) {
+            return;
+        }
+    }
+    entry = it[0];
+    _free_groups.push_back(group);
+}
+
+/**
+ * @brief
+ * Add a route or replace the route with the same identity
+ * @return int "0" - success; "-1" - invalid prefix length or no room for results
+ */
+int lpm_v4::add(const route_v4 &route)
+{
+    uint8_t depth = (route.flags & route_v4::HAS_DEST) ? route.mask_len : 0;
+    if ( depth > 32 ) {
+        return -1;
+    }
+    uint32_t prefix = prefix_of(ntohl(route.dest), depth);
+    uint64_t key    = rule_key(prefix, depth);
+    auto pos        = _rules.find(key);
+    if ( pos != _rules.end() ) {
+        route_v4 &best = _results[pos->second.result];
+        if ( best.same(route) ) {
+            best = route;
+            return 0;
+        }
+        auto range = _alternates.equal_range(key);
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.same(route) ) {
+                it->second = route;
+                return 0;
+            }
+        }
+        ++pos->second.routes;
+        if ( route.priority < best.priority ) {  // the tables point to the result, so only the result changes
+            _alternates.emplace(key, best);
+            best = route;
+        } else {
+            _alternates.emplace(key, route);
+        }
+        return 0;
+    }
+
+    if ( _free_results.empty() and _results.size() > INDEX ) {
+        return -1;
+    }
+    uint32_t result = alloc_result(route);
+    _rules[key]     = {result, 1};
+    fill(prefix, depth, entry(depth, result), false);
+    return 0;
+}
+
+/**
+ * @brief
+ * Delete a route. When the last route of a prefix is deleted its entries go to the covering prefix
+ * @return int "0" - success; "-1" - the route hasn't been found
+ */
+int lpm_v4::del(const route_v4 &route)
+{
+    uint8_t depth = (route.flags & route_v4::HAS_DEST) ? route.mask_len : 0;
+    if ( depth > 32 ) {
+        return -1;
+    }
+    uint32_t prefix = prefix_of(ntohl(route.dest), depth);
+    uint64_t key    = rule_key(prefix, depth);
+    auto pos        = _rules.find(key);
+    if ( pos == _rules.end() ) {
+        return -1;
+    }
+
+    rule &current  = pos->second;
+    route_v4 &best = _results[current.result];
+    auto range     = _alternates.equal_range(key);
+    if ( not best.same(route) ) {
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.same(route) ) {
+                _alternates.erase(it);
+                --current.routes;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    if ( current.routes > 1 ) {  // the next best route of the prefix takes the result
+        auto next = range.first;
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.priority < next->second.priority ) {
+                next = it;
+            }
+        }
+        best = next->second;
+        _alternates.erase(next);
+        --current.routes;
+        return 0;
+    }
+
+    _free_results.push_back(current.result);
+    _rules.erase(pos);
+
+    uint32_t value = 0;
+    for ( int covering = depth - 1; covering >= 0; --covering ) {
+        auto parent = _rules.find(rule_key(prefix_of(prefix, covering), covering));
+        if ( parent != _rules.end() ) {
+            value = entry(covering, parent->second.result);
+            break;
+        }
+    }
+    fill(prefix, depth, value, true);
+    if ( depth > 24 ) {
+        try_collapse(prefix >> 8);
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Look up a vector of addresses (network byte order). The tbl24 entries of LPM_V4_BATCH addresses are
+ * prefetched before they are resolved, so their cache misses overlap
+ * @param results the best route per address or nullptr
+ */
+void lpm_v4::lookup(const in_addr_t *addrs, const size_t count, const route_v4 **results) const
+{
+    uint32_t host[LPM_V4_BATCH];
+    for ( size_t base = 0; base < count; base += LPM_V4_BATCH ) {
+        size_t n = std::min<size_t>(LPM_V4_BATCH, count - base);
+        for ( size_t i = 0; i < n; ++i ) {
+            host[i] = ntohl(addrs[base + i]);
+            __builtin_prefetch(&_tbl24[host[i] >> 8]);
+        }
+        for ( size_t i = 0; i < n; ++i ) {
+            results[base + i] = result_of(resolve(host[i]));
+        }
+    }
+}
@@ -0,0 +1,307 @@
+#include "lpm_v6.h"
+
+void lpm_v6::clear()
+{
+    _slots.clear();
+    std::fill(std::begin(_lengths), std::end(_lengths), 0);
+    _default = 0;
+    _prefixes.clear();
+    _results.clear();
+    _free_results.clear();
+    _alternates.clear();
+}
+
+/**
+ * @brief
+ * Memory used by the slots, the results and the prefix index (approximately for the tree and the hash map)
+ */
+size_t lpm_v6::bytes() const
+{
+    return _slots.bytes() + _results.capacity() * sizeof(route_v6)  //
+           + _prefixes.size() * (sizeof(prefix_key) + 4 * sizeof(void *))       //
+           + _alternates.size() * (sizeof(std::pair<uint32_t, route_v6>) + 2 * sizeof(void *));
+}
+
+uint32_t lpm_v6::alloc_result(const route_v6 &route)
+{
+    if ( not _free_results.empty() ) {
+        uint32_t index = _free_results.back();
+        _free_results.pop_back();
+        _results[index] = route;
+        return index + 1;
+    }
+    _results.push_back(route);
+    return _results.size();
+}
+
+/**
+ * @brief
+ * The longest prefix covering the key, not longer than it and not the default route
+ * @return std::pair<uint32_t, uint8_t> its result and length; {0, 0} - none
+ */
+std::pair<uint32_t, uint8_t> lpm_v6::covering(const slot &key) const
+{
+    for ( int len = key.len; len > 0; --len ) {
+        if ( not _lengths[len] ) {
+            continue;
+        }
+        auto found = _slots.find(key_of(key.hi, key.lo, len));
+        if ( found.first and _slots[found.second].result ) {
+            return {_slots[found.second].result, len};
+        }
+    }
+    return {0, 0};
+}
+
+void lpm_v6::add_marker(const slot &key)
+{
+    auto found = _slots.find(key);
+    if ( found.first ) {
+        ++_slots.at(found.second).markers;
+        return;
+    }
+    slot marker                             = key;
+    marker.markers                          = 1;
+    std::tie(marker.bmp, marker.bmp_len)    = covering(key);
+    _slots.insert(marker);
+    ++_lengths[key.len];
+}
+
+void lpm_v6::del_marker(const slot &key)
+{
+    auto found = _slots.find(key);
+    if ( not found.first ) {
+        return;
+    }
+    slot &marker = _slots.at(found.second);
+    if ( --marker.markers == 0 and marker.result == 0 ) {
+        _slots.erase(key);
+        --_lengths[key.len];
+    }
+}
+
+/**
+ * @brief
+ * Call on_marker(slot&) for the markers (not prefixes) longer than the key which lie under it:
+ * they are the markers of the longer prefixes under the key
+ */
+template <typename F>
+void lpm_v6::for_each_marker_under(const slot &key, F on_marker)
+{
+    slot last = key;  // the key with every host bit set
+    if ( key.len < 64 ) {
+        last.hi |= ~0ull >> key.len;
+        last.lo = ~0ull;
+    } else if ( key.len < 128 ) {
+        last.lo |= ~0ull >> (key.len - 64);
+    }
+
+    for ( auto it = _prefixes.lower_bound({key.hi, key.lo, 0}); it != _prefixes.end(); ++it ) {
+        auto [hi, lo, len] = *it;
+        if ( std::make_pair(hi, lo) > std::make_pair(last.hi, last.lo) ) {
+            break;
+        }
+        if ( len <= key.len ) {
+            continue;
+        }
+        walk_markers(len, [&, hi = hi, lo = lo] (uint8_t mid) {
+            if ( mid <= key.len ) {
+                return;
+            }
+            auto found = _slots.find(key_of(hi, lo, mid));
+            if ( found.first and _slots[found.second].result == 0 ) {
+                on_marker(_slots.at(found.second));
+            }
+        });
+    }
+}
+
+/**
+ * @brief
+ * Add a route or replace the route with the same identity
+ * @return int "0" - success; "-1" - invalid prefix length
+ */
+int lpm_v6::add(const route_v6 &route)
+{
+    uint8_t len = (route.flags & route_v4::HAS_DEST) ? route.mask_len : 0;
+    if ( len > LPM_V6_MAX_LEN ) {
+        return -1;
+    }
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    load(route.dest, hi, lo);
+    slot key   = key_of(hi, lo, len);
+    auto found = _slots.find(key);
+
+    if ( found.first and _slots[found.second].result ) {
+        slot &prefix   = _slots.at(found.second);
+        route_v6 &best = _results[prefix.result - 1];
+        if ( best.same(route) ) {
+            best = route;
+            return 0;
+        }
+        auto range = _alternates.equal_range(prefix.result);
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.same(route) ) {
+                it->second = route;
+                return 0;
+            }
+        }
+        ++prefix.routes;
+        if ( route.priority < best.priority ) {  // the slots point to the result, so only the result changes
+            _alternates.emplace(prefix.result, best);
+            best = route;
+        } else {
+            _alternates.emplace(prefix.result, route);
+        }
+        return 0;
+    }
+
+    uint32_t result = alloc_result(route);
+    if ( found.first ) {  // a marker becomes a prefix
+        slot &prefix   = _slots.at(found.second);
+        prefix.result  = result;
+        prefix.routes  = 1;
+        prefix.bmp     = result;
+        prefix.bmp_len = len;
+    } else {
+        slot prefix    = key;
+        prefix.result  = result;
+        prefix.routes  = 1;
+        prefix.bmp     = result;
+        prefix.bmp_len = len;
+        _slots.insert(prefix);
+        ++_lengths[len];
+    }
+    if ( len == 0 ) {
+        _default = result;
+        return 0;
+    }
+
+    _prefixes.insert({key.hi, key.lo, len});
+    walk_markers(len, [&] (uint8_t mid) { add_marker(key_of(hi, lo, mid)); });
+    for_each_marker_under(key, [&] (slot &marker) {
+        if ( marker.bmp_len < len ) {
+            marker.bmp     = result;
+            marker.bmp_len = len;
+        }
+    });
+    return 0;
+}
+
+/**
+ * @brief
+ * Delete a route. When the last route of a prefix is deleted the markers under it go to the covering prefix
+ * @return int "0" - success; "-1" - the route hasn't been found
+ */
+int lpm_v6::del(const route_v6 &route)
+{
+    uint8_t len = (route.flags & route_v4::HAS_DEST) ? route.mask_len : 0;
+    if ( len > LPM_V6_MAX_LEN ) {
+        return -1;
+    }
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    load(route.dest, hi, lo);
+    slot key   = key_of(hi, lo, len);
+    auto found = _slots.find(key);
+    if ( not found.first or _slots[found.second].result == 0 ) {
+        return -1;
+    }
+
+    slot &prefix    = _slots.at(found.second);
+    uint32_t result = prefix.result;
+    route_v6 &best  = _results[result - 1];
+    auto range      = _alternates.equal_range(result);
+    if ( not best.same(route) ) {
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.same(route) ) {
+                _alternates.erase(it);
+                --prefix.routes;
+                return 0;
+            }
+        }
+        return -1;
+    }
+
+    if ( prefix.routes > 1 ) {  // the next best route of the prefix takes the result
+        auto next = range.first;
+        for ( auto it = range.first; it != range.second; ++it ) {
+            if ( it->second.priority < next->second.priority ) {
+                next = it;
+            }
+        }
+        best = next->second;
+        _alternates.erase(next);
+        --prefix.routes;
+        return 0;
+    }
+
+    _free_results.push_back(result - 1);
+    if ( len == 0 ) {
+        _default = 0;
+        _slots.erase(key);
+        --_lengths[0];
+        return 0;
+    }
+
+    auto [cover, cover_len] = covering(key_of(hi, lo, len - 1));
+    if ( prefix.markers ) {  // still needed by longer prefixes
+        prefix.result  = 0;
+        prefix.routes  = 0;
+        prefix.bmp     = cover;
+        prefix.bmp_len = cover_len;
+    } else {
+        _slots.erase(key);
+        --_lengths[len];
+    }
+    _prefixes.erase({key.hi, key.lo, len});
+    walk_markers(len, [&] (uint8_t mid) { del_marker(key_of(hi, lo, mid)); });
+    for_each_marker_under(key, [&] (slot &marker) {
+        if ( marker.bmp == result ) {
+            marker.bmp     = cover;
+            marker.bmp_len = cover_len;
+        }
+    });
+    return 0;
+}
+
+const route_v6 *lpm_v6::lookup(const in6_addr &addr) const
+{
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+    load(addr.s6_addr, hi, lo);
+
+    uint32_t best = _default;
+    int low       = 1;
+    int high      = LPM_V6_MAX_LEN;
+    while ( low <= high ) {
+        int mid = (low + high) / 2;
+        if ( _lengths[mid] ) {
+            auto found = _slots.find(key_of(hi, lo, mid));
+            if ( found.first ) {
+                if ( _slots[found.second].bmp ) {
+                    best = _slots[found.second].bmp;
+                }
+                low = mid + 1;
+                continue;
+            }
+        }
+        high = mid - 1;
+    }
+    return best ? &_results[best - 1] : nullptr;
+}
+
+/**
+ * @brief
+ * Look up a vector of addresses. The searches aren't interleaved: stepping several of them together
+ * (with or without prefetching the index) was slower than one after another, the probes of one search
+ * are already overlapped by the CPU with the next one
+ * @param results the best route per address or nullptr
+ */
+void lpm_v6::lookup(const in6_addr *addrs, const size_t count, const route_v6 **results) const
+{
+    for ( size_t i = 0; i < count; ++i ) {
+        results[i] = lookup(addrs[i]);
+    }
+}
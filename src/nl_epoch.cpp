@@ -0,0 +1,95 @@
+#include "nl_epoch.h"
+
+/**
+ * @brief
+ * The slot of the thread and the depth of its nested read sections. The slot is given back when the thread exits
+ */
+struct nl_epoch_thread
+{
+    nl_epoch::reader *slot = nullptr;
+    uint32_t depth         = 0;
+    bool claimed           = false;
+
+    ~nl_epoch_thread()
+    {
+        if ( slot ) {
+            slot->used.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local nl_epoch_thread epoch_thread;
+
+nl_epoch::reader *nl_epoch::enter()
+{
+    if ( epoch_thread.depth++ ) {
+        return epoch_thread.slot;
+    }
+    if ( not epoch_thread.claimed ) {
+        epoch_thread.claimed = true;
+        for ( reader &slot : _readers ) {
+            bool used = false;
+            if ( slot.used.compare_exchange_strong(used, true) ) {
+                epoch_thread.slot = &slot;
+                break;
+            }
+        }
+    }
+
+    if ( epoch_thread.slot ) {
+        // seq_cst: the store is ordered before the loads of the read section, the writer can't miss it
+        epoch_thread.slot->epoch.store(_global.load());
+    } else {
+        _overflow.fetch_add(1);
+    }
+    return epoch_thread.slot;
+}
+
+void nl_epoch::leave(reader *slot)
+{
+    if ( --epoch_thread.depth ) {
+        return;
+    }
+    if ( slot ) {
+        slot->epoch.store(0, std::memory_order_release);
+    } else {
+        _overflow.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+/**
+ * @brief
+ * Free the object once the readers which could have loaded it are gone. Unpublish it before the call
+ */
+void nl_epoch::retire(std::function<void()> deleter)
+{
+    _retired.emplace_back(_global.fetch_add(1), std::move(deleter));
+    reclaim();
+}
+
+/**
+ * @brief
+ * Free the retired objects no reader can see any more
+ * @return size_t count of freed objects
+ */
+size_t nl_epoch::reclaim()
+{
+    if ( _retired.empty() or _overflow.load() ) {
+        return 0;
+    }
+    uint64_t oldest = UINT64_MAX;  // the oldest epoch a reader is in
+    for ( reader &slot : _readers ) {
+        uint64_t epoch = slot.epoch.load();
+        if ( epoch and epoch < oldest ) {
+            oldest = epoch;
+        }
+    }
+
+    size_t freed = 0;
+    while ( not _retired.empty() and _retired.front().first < oldest ) {
+        _retired.front().second();
+        _retired.pop_front();
+        ++freed;
+    }
+    return freed;
+}
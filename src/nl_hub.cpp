@@ -0,0 +1,218 @@
+#include "nl_hub.h"
+
+nl_hub::nl_hub()
+{
+    for ( int &fd : _requests ) {
+        fd = -1;
+    }
+
+    _fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if ( _fd == -1 ) {
+        std::cerr << "Failed to create NL socket: " << strerror(errno) << std::endl;
+        return;
+    }
+    if ( nl_socket_handler::set_rcvbuf(_fd) < 0 ) {
+        std::cerr << "Failed to size NL socket receive buffer: " << strerror(errno) << std::endl;
+    }
+    sockaddr_nl nl_addr = {};
+    nl_addr.nl_family   = AF_NETLINK;
+    nl_addr.nl_groups   = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if ( bind(_fd, (sockaddr *)&nl_addr, sizeof(nl_addr)) < 0 ) {
+        std::cerr << "Failed to bind NL socket: " << strerror(errno) << std::endl;
+    }
+
+    _handlers.on_route = [this] (const linux_route &route) {
+        for_each_subscriber(route.iface_id, [&route] (const nl_event_handlers &handlers) {
+            if ( handlers.on_route ) {
+                handlers.on_route(route);
+            }
+        });
+    };
+    _handlers.on_link = [this] (const link_event &event) {
+        for_each_subscriber(event.ifindex, [&event] (const nl_event_handlers &handlers) {
+            if ( handlers.on_link ) {
+                handlers.on_link(event);
+            }
+        });
+    };
+    _handlers.on_addr = [this] (const addr_event &event) {
+        for_each_subscriber(event.ifindex, [&event] (const nl_event_handlers &handlers) {
+            if ( handlers.on_addr ) {
+                handlers.on_addr(event);
+            }
+        });
+    };
+    _handlers.on_neigh = [this] (const neigh_event &event) {
+        for_each_subscriber(event.ifindex, [&event] (const nl_event_handlers &handlers) {
+            if ( handlers.on_neigh ) {
+                handlers.on_neigh(event);
+            }
+        });
+    };
+    _handlers.on_message = [this] (nlmsghdr *nlh) {  // no ifindex: the subscribers of every interface only
+        for_each_subscriber(NO_SYSTEM_ID, [nlh] (const nl_event_handlers &handlers) {
+            if ( handlers.on_message ) {
+                handlers.on_message(nlh);
+            }
+        });
+    };
+    _handlers.on_overrun = [this] () {
+        ++_overruns;
+        std::vector<std::shared_ptr<nl_event_handlers>> all;
+        for ( auto &[ifindex, subscribers] : _subscribers ) {
+            for ( auto &[id, handlers] : subscribers ) {
+                all.push_back(handlers);
+            }
+        }
+        for ( auto &handlers : all ) {
+            if ( handlers->on_overrun ) {
+                handlers->on_overrun();
+            }
+        }
+    };
+}
+
+nl_hub::~nl_hub()
+{
+    for ( int fd : _requests ) {
+        if ( fd >= 0 ) {
+            close(fd);
+        }
+    }
+    if ( _fd >= 0 ) {
+        close(_fd);
+    }
+}
+
+/**
+ * @brief
+ * Call on_handlers for the subscribers of the interface and for the ones of every interface (NO_SYSTEM_ID).
+ * A handler may unsubscribe, so the handlers are taken before the calls
+ */
+template <typename F>
+void nl_hub::for_each_subscriber(const uint32_t ifindex, F on_handlers)
+{
+    std::vector<std::shared_ptr<nl_event_handlers>> taken;
+    auto take = [this, &taken] (const uint32_t key) {
+        auto pos = _subscribers.find(key);
+        if ( pos != _subscribers.end() ) {
+            for ( auto &[id, handlers] : pos->second ) {
+                taken.push_back(handlers);
+            }
+        }
+    };
+    take(ifindex);
+    if ( ifindex != NO_SYSTEM_ID ) {
+        take(NO_SYSTEM_ID);
+    }
+    ++_dispatching;
+    for ( auto &handlers : taken ) {
+        on_handlers(*handlers);
+    }
+    --_dispatching;
+}
+
+/**
+ * @brief
+ * A request socket from the pool, round robin. The sockets are shared, a request has to be completed
+ * (its ACK or dump read) before the next one is sent through the same socket
+ * @return int - socket fd; "-1" - error
+ */
+int nl_hub::request_socket()
+{
+    int &fd = _requests[_next_request++ % NL_HUB_REQUEST_SOCKETS];
+    if ( fd < 0 ) {
+        fd = nl_socket_handler::open_request_socket();
+    }
+    return fd;
+}
+
+/**
+ * @brief
+ * Subscribe to the events of the interface
+ * @param ifindex linux interface id; NO_SYSTEM_ID - the events of every interface and the messages without one
+ * @param handlers see nl_event_handlers. on_overrun is called for every subscriber
+ * @return uint64_t subscription id for unsubscribe()
+ */
+uint64_t nl_hub::subscribe(const uint32_t ifindex, nl_event_handlers handlers)
+{
+    uint64_t id = ++_last_id;
+    _subscribers[ifindex].emplace_back(id, std::make_shared<nl_event_handlers>(std::move(handlers)));
+    _ifindex[id] = ifindex;
+    return id;
+}
+
+bool nl_hub::unsubscribe(const uint64_t id)
+{
+    auto pos = _ifindex.find(id);
+    if ( pos == _ifindex.end() ) {
+        return false;
+    }
+    auto &subscribers = _subscribers[pos->second];
+    std::erase_if(subscribers, [id] (const subscription &subscriber) { return subscriber.first == id; });
+    if ( subscribers.empty() ) {
+        _subscribers.erase(pos->second);
+    }
+    _ifindex.erase(pos);
+    return true;
+}
+
+/**
+ * @brief
+ * Let the reactor read the hub socket. The hub is attached to one reactor at a time, every attach() is paired
+ * with a detach(): the hub leaves the reactor with the last one
+ * @return int "0" - success (or already attached to the reactor); "-EBUSY" - attached to another one; "-errno"
+ */
+int nl_hub::attach(nl_reactor &reactor)
+{
+    if ( _reactor ) {
+        if ( _reactor != &reactor ) {
+            return -EBUSY;
+        }
+        ++_attached;
+        return 0;
+    }
+    int rc = reactor.add_socket(_fd, _handlers);
+    if ( rc == 0 ) {
+        _reactor  = &reactor;
+        _attached = 1;
+    }
+    return rc;
+}
+
+/**
+ * @brief
+ * Undo one attach()
+ * @return int "0" - success; "-ENOENT" - not attached to the reactor; "-errno" - the socket can't be removed
+ */
+int nl_hub::detach(nl_reactor &reactor)
+{
+    if ( _reactor != &reactor or not _attached ) {
+        return -ENOENT;
+    }
+    if ( --_attached ) {
+        return 0;
+    }
+    _reactor = nullptr;
+    return reactor.remove_socket(_fd);
+}
+
+/**
+ * @brief
+ * Read the queued events and pass them to the subscribers without a reactor. Does nothing if it's called
+ * by a subscriber: the events after the current one are passed by the read which is going on, in order
+ * @return int count of read messages; "-errno" - the socket can't be read
+ */
+int nl_hub::poll()
+{
+    if ( _dispatching ) {
+        return 0;
+    }
+    return nl_socket_handler::drain_notifications(
+        _fd,
+        [this] (nlmsghdr *nlh) {
+            nl_reactor::dispatch(nlh, _handlers);
+            return true;
+        },
+        _handlers.on_overrun);
+}
@@ -0,0 +1,263 @@
+#include "nl_reactor.h"
+
+nl_reactor::nl_reactor()
+{
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if ( _epoll_fd == -1 ) {
+        std::cerr << "Failed to create epoll fd: " << strerror(errno) << std::endl;
+        return;
+    }
+    _event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ( _event_fd == -1 ) {
+        std::cerr << "Failed to create eventfd: " << strerror(errno) << std::endl;
+        return;
+    }
+    epoll_event event = {};
+    event.events      = EPOLLIN;
+    event.data.fd     = _event_fd;
+    if ( epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _event_fd, &event) == -1 ) {
+        std::cerr << "Failed to add eventfd into epoll: " << strerror(errno) << std::endl;
+    }
+}
+
+nl_reactor::~nl_reactor()
+{
+    if ( _event_fd >= 0 ) {
+        close(_event_fd);
+    }
+    if ( _epoll_fd >= 0 ) {
+        close(_epoll_fd);
+    }
+}
+
+/**
+ * @brief
+ * Register a netlink socket. The socket has to be non-blocking, it's still owned (closed) by the caller.
+ * @param fd netlink socket fd
+ * @param handlers handlers for messages received by this socket
+ * @return int "0" - success; "-errno" - epoll_ctl() failed
+ */
+int nl_reactor::add_socket(const int fd, nl_event_handlers handlers)
+{
+    epoll_event event = {};
+    event.events      = EPOLLIN | EPOLLET;
+    event.data.fd     = fd;
+    int op            = _sockets.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if ( epoll_ctl(_epoll_fd, op, fd, &event) == -1 ) {
+        return -errno;
+    }
+    _sockets[fd] = std::make_shared<nl_event_handlers>(std::move(handlers));
+    drain(fd);  // edge-triggered: pick up what was queued before the registration
+    return 0;
+}
+
+int nl_reactor::remove_socket(const int fd)
+{
+    if ( not _sockets.erase(fd) ) {
+        return -ENOENT;
+    }
+    if ( epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == -1 ) {
+        return -errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Register an fd which is read by its owner (a request engine, a timer ...). The fd is edge-triggered:
+ * on_ready has to read it until EAGAIN
+ * @return int "0" - success; "-errno" - epoll_ctl() failed
+ */
+int nl_reactor::add_fd(const int fd, std::function<void()> on_ready)
+{
+    epoll_event event = {};
+    event.events      = EPOLLIN | EPOLLET;
+    event.data.fd     = fd;
+    int op            = _fds.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if ( epoll_ctl(_epoll_fd, op, fd, &event) == -1 ) {
+        return -errno;
+    }
+    _fds[fd] = std::make_shared<std::function<void()>>(std::move(on_ready));
+    return 0;
+}
+
+int nl_reactor::remove_fd(const int fd)
+{
+    if ( not _fds.erase(fd) ) {
+        return -ENOENT;
+    }
+    if ( epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == -1 ) {
+        return -errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Wait for events once and handle all of them
+ * @param timeout_ms -1 - infinite; 0 - don't wait
+ * @return int count of ready fds; "-errno" - epoll_wait() failed
+ */
+int nl_reactor::run_once(const int timeout_ms)
+{
+    epoll_event events[NL_REACTOR_MAX_EVENTS];
+    int count = epoll_wait(_epoll_fd, events, NL_REACTOR_MAX_EVENTS, timeout_ms);
+    if ( count == -1 ) {
+        return (errno == EINTR) ? 0 : -errno;
+    }
+    for ( int i = 0; i < count; ++i ) {
+        int fd = events[i].data.fd;
+        if ( fd == _event_fd ) {
+            uint64_t value;
+            while ( read(_event_fd, &value, sizeof(value)) > 0 ) {
+            }
+            run_tasks();
+            continue;
+        }
+        auto pos = _fds.find(fd);
+        if ( pos != _fds.end() ) {
+            auto on_ready = pos->second;  // stays valid even if the handler removes the fd
+            (*on_ready)();
+            continue;
+        }
+        drain(fd);
+    }
+    return count;
+}
+
+/**
+ * @brief
+ * Handle events until stop() is called
+ */
+void nl_reactor::run()
+{
+    while ( not _stopped ) {
+        int rc = run_once(-1);
+        if ( rc < 0 ) {
+            std::cerr << "epoll_wait failed: " << strerror(-rc) << std::endl;
+            break;
+        }
+    }
+    _stopped = false;
+}
+
+void nl_reactor::stop()
+{
+    _stopped = true;
+    wakeup();
+}
+
+void nl_reactor::wakeup()
+{
+    uint64_t value = 1;
+    if ( write(_event_fd, &value, sizeof(value)) == -1 and errno != EAGAIN ) {
+        std::cerr << "Failed to wake up the reactor: " << strerror(errno) << std::endl;
+    }
+}
+
+/**
+ * @brief
+ * Run the task on the loop thread. Safe to call from any thread
+ */
+void nl_reactor::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_tasks_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    wakeup();
+}
+
+void nl_reactor::run_tasks()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(_tasks_mutex);
+        tasks.swap(_tasks);
+    }
+    for ( auto &task : tasks ) {
+        task();
+    }
+}
+
+/**
+ * @brief
+ * Read the socket until EAGAIN, a batch of datagrams per recvmmsg(). A handler may remove the socket,
+ * so the handlers are looked up per message
+ */
+void nl_reactor::drain(const int fd)
+{
+    auto on_message = [this, fd] (nlmsghdr *nlh) {
+        auto pos = _sockets.find(fd);
+        if ( pos == _sockets.end() ) {
+            return false;
+        }
+        auto handlers = pos->second;  // stays valid even if a handler changes the registration
+        dispatch(nlh, *handlers);
+        return true;
+    };
+    auto on_overrun = [this, fd] () {
+        ++_overruns;
+        auto pos = _sockets.find(fd);
+        if ( pos != _sockets.end() and pos->second->on_overrun ) {
+            auto handlers = pos->second;
+            handlers->on_overrun();
+        }
+    };
+    if ( _sockets.find(fd) == _sockets.end() ) {
+        return;
+    }
+    int rc = nl_socket_handler::drain_notifications(fd, on_message, on_overrun);
+    if ( rc < 0 ) {
+        std::cerr << "Failed to read NL socket " << fd << ": " << strerror(-rc) << std::endl;
+    }
+}
+
+void nl_reactor::dispatch(nlmsghdr *nlh, const nl_event_handlers &handlers)
+{
+    switch ( nlh->nlmsg_type ) {
+        case RTM_NEWROUTE:
+        case RTM_DELROUTE:
+            if ( handlers.on_route ) {
+                handlers.on_route(linux_route::parse_route_from_nl_resp_hdr(nlh));
+            }
+            return;
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+            if ( handlers.on_link ) {
+                link_event event;
+                link_event::parse(nlh, event);
+                handlers.on_link(event);
+            }
+            return;
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            if ( handlers.on_addr ) {
+                addr_event event;
+                addr_event::parse(nlh, event);
+                handlers.on_addr(event);
+            }
+            return;
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH:
+            if ( handlers.on_neigh ) {
+                neigh_event event;
+                neigh_event::parse(nlh, event);
+                handlers.on_neigh(event);
+            }
+            return;
+        case RTM_NEWNEXTHOP:
+        case RTM_DELNEXTHOP:
+            if ( handlers.on_nexthop ) {
+                nexthop_event event;
+                nexthop_event::parse(nlh, event);
+                handlers.on_nexthop(event);
+            }
+            return;
+        default:
+            if ( handlers.on_message ) {
+                handlers.on_message(nlh);
+            }
+            return;
+    }
+}
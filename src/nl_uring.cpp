@@ -0,0 +1,301 @@
+#include "nl_uring.h"
+
+#include <atomic>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NL_URING_RECV_ID UINT64_MAX  // user_data of the multishot receive, sends use their id
+
+using namespace nl_socket_handler;
+
+static int io_uring_setup (const unsigned entries, io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter (const int ring_fd, const unsigned to_submit, const unsigned min_complete, const unsigned flags, void *arg, const size_t arg_size)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int io_uring_register (const int ring_fd, const unsigned opcode, void *arg, const unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static unsigned load_acquire (const unsigned *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+static void store_release (T *ptr, const T value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+nl_uring::nl_uring(const int fd, const unsigned entries)
+    : _fd(fd)
+{
+    int rc = setup(entries);
+    if ( rc < 0 ) {
+        std::cout << "io_uring is not available (" << strerror(-rc) << "), use send/recv" << std::endl;
+        release();
+        return;
+    }
+    int rcvbuf = NL_URING_RCVBUF;  // room for the ACKs of NL_URING_BUFS requests
+    setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+}
+
+nl_uring::~nl_uring()
+{
+    release();
+}
+
+/**
+ * @brief
+ * Check that the kernel allows io_uring with everything the transport needs
+ */
+bool nl_uring::supported()
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if ( fd < 0 ) {
+        return false;
+    }
+    bool rc = nl_uring(fd, 4).is_open();
+    close(fd);
+    return rc;
+}
+
+int nl_uring::setup(const unsigned entries)
+{
+    io_uring_params params = {};
+    params.flags           = IORING_SETUP_COOP_TASKRUN;  // completions are reaped by the same thread
+    _ring_fd               = io_uring_setup(entries, &params);
+    if ( _ring_fd < 0 and errno == EINVAL ) {  // older kernel
+        params   = {};
+        _ring_fd = io_uring_setup(entries, &params);
+    }
+    if ( _ring_fd < 0 ) {
+        return -errno;
+    }
+    if ( not(params.features & IORING_FEAT_SINGLE_MMAP) or not(params.features & IORING_FEAT_EXT_ARG) ) {
+        return -EOPNOTSUPP;
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    _sq_size = std::max(_sq_size, _cq_size);
+    _sq_ptr  = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+    if ( _sq_ptr == MAP_FAILED ) {
+        _sq_ptr = nullptr;
+        return -errno;
+    }
+    _cq_ptr  = _sq_ptr;  // IORING_FEAT_SINGLE_MMAP
+    _cq_size = 0;
+
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes      = (io_uring_sqe *)mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+    if ( _sqes == MAP_FAILED ) {
+        _sqes = nullptr;
+        return -errno;
+    }
+
+    char *sq     = (char *)_sq_ptr;
+    _sq_head     = (unsigned *)(sq + params.sq_off.head);
+    _sq_tail     = (unsigned *)(sq + params.sq_off.tail);
+    _sq_mask     = *(unsigned *)(sq + params.sq_off.ring_mask);
+    _sq_entries  = params.sq_entries;
+    _sq_local_tail = *_sq_tail;
+    _sq_array    = (unsigned *)(sq + params.sq_off.array);
+    char *cq     = (char *)_cq_ptr;
+    _cq_head     = (unsigned *)(cq + params.cq_off.head);
+    _cq_tail     = (unsigned *)(cq + params.cq_off.tail);
+    _cq_mask     = *(unsigned *)(cq + params.cq_off.ring_mask);
+    _cqes        = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    // ring of provided buffers for the multishot receive
+    _buf_ring_size = NL_URING_BUFS * sizeof(io_uring_buf) + NL_URING_BUFS * NL_URING_BUF_SIZE;
+    void *ptr      = mmap(nullptr, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ( ptr == MAP_FAILED ) {
+        return -errno;
+    }
+    _buf_ring = (io_uring_buf_ring *)ptr;
+    _bufs     = (char *)ptr + NL_URING_BUFS * sizeof(io_uring_buf);
+
+    io_uring_buf_reg reg = {};
+    reg.ring_addr        = (uint64_t)_buf_ring;
+    reg.ring_entries     = NL_URING_BUFS;
+    reg.bgid             = 0;
+    if ( io_uring_register(_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0 ) {
+        return -errno;
+    }
+    for ( uint16_t bid = 0; bid < NL_URING_BUFS; ++bid ) {
+        recycle(bid);
+    }
+    return 0;
+}
+
+void nl_uring::release()
+{
+    if ( _buf_ring ) {
+        munmap(_buf_ring, _buf_ring_size);
+        _buf_ring = nullptr;
+    }
+    if ( _sqes ) {
+        munmap(_sqes, _sqes_size);
+        _sqes = nullptr;
+    }
+    if ( _sq_ptr ) {
+        munmap(_sq_ptr, _sq_size);
+        _sq_ptr = nullptr;
+    }
+    if ( _ring_fd >= 0 ) {
+        close(_ring_fd);
+        _ring_fd = -1;
+    }
+}
+
+io_uring_sqe *nl_uring::get_sqe()
+{
+    unsigned tail = _sq_local_tail;
+    if ( tail - load_acquire(_sq_head) >= _sq_entries ) {
+        return nullptr;
+    }
+    ++_sq_local_tail;
+    unsigned index    = tail & _sq_mask;
+    io_uring_sqe *sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    _sq_array[index] = index;
+    ++_to_submit;
+    return sqe;
+}
+
+/**
+ * @brief
+ * Give a buffer back to the kernel
+ */
+void nl_uring::recycle(const uint16_t bid)
+{
+    // not _buf_ring->bufs: in C++ the empty struct of __DECLARE_FLEX_ARRAY moves it by 8 bytes
+    io_uring_buf *buf = (io_uring_buf *)_buf_ring + (_buf_tail & (NL_URING_BUFS - 1));
+    buf->addr         = (uint64_t)(_bufs + (size_t)bid * NL_URING_BUF_SIZE);
+    buf->len          = NL_URING_BUF_SIZE;
+    buf->bid          = bid;
+    store_release(&_buf_ring->tail, ++_buf_tail);
+}
+
+/**
+ * @brief
+ * Queue a send. It's submitted by the next wait()
+ * @param id passed back to the send handler
+ * @param link the next queued SQE starts only after this one has completed successfully
+ * @return int "0" - success; "-EBUSY" - the submission queue is full
+ */
+int nl_uring::send(const char *buf, const size_t length, const uint32_t id, const bool link)
+{
+    io_uring_sqe *sqe = get_sqe();
+    if ( not sqe ) {
+        return -EBUSY;
+    }
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = _fd;
+    sqe->addr      = (uint64_t)buf;
+    sqe->len       = length;
+    sqe->flags     = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = id;
+    return 0;
+}
+
+int nl_uring::enter(const unsigned to_submit, const unsigned min_complete, const int timeout_ms)
+{
+    __kernel_timespec ts        = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000LL};
+    io_uring_getevents_arg arg  = {};
+    arg.sigmask_sz              = _NSIG / 8;
+    arg.ts                      = (timeout_ms < 0) ? 0 : (uint64_t)&ts;
+    unsigned flags              = IORING_ENTER_EXT_ARG | (min_complete ? IORING_ENTER_GETEVENTS : 0);
+
+    ++_syscalls;
+    int rc = io_uring_enter(_ring_fd, to_submit, min_complete, flags, &arg, sizeof(arg));
+    return (rc < 0) ? -errno : rc;
+}
+
+int nl_uring::reap(const datagram_handler &on_datagram, const send_handler &on_send)
+{
+    int count     = 0;
+    unsigned head = *_cq_head;
+    while ( head != load_acquire(_cq_tail) ) {
+        io_uring_cqe cqe = _cqes[head & _cq_mask];
+        store_release(_cq_head, ++head);  // the CQE is copied, free the slot
+        ++count;
+
+        if ( cqe.user_data != NL_URING_RECV_ID ) {
+            if ( on_send ) {
+                on_send((uint32_t)cqe.user_data, (cqe.res < 0) ? cqe.res : 0);
+            }
+            continue;
+        }
+        if ( not(cqe.flags & IORING_CQE_F_MORE) ) {
+            _recv_armed = false;  // re-armed by the next wait()
+        }
+        if ( cqe.res < 0 ) {
+            if ( cqe.res == -ENOBUFS ) {  // a socket overrun or all the buffers are busy, the queue is still readable
+                _overrun = true;
+            }
+            continue;
+        }
+        if ( cqe.flags & IORING_CQE_F_BUFFER ) {
+            uint16_t bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+            if ( cqe.res > 0 and on_datagram ) {
+                on_datagram(_bufs + (size_t)bid * NL_URING_BUF_SIZE, cqe.res);
+            }
+            recycle(bid);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief
+ * Submit the queued SQEs (and the multishot receive if it isn't armed) and handle completions
+ * @param timeout_ms how long to wait for the first completion (-1 - infinite, 0 - don't wait)
+ * @return int count of handled completions; "-ETIMEDOUT" - nothing has been completed; "-errno" - io_uring_enter() failed
+ */
+int nl_uring::wait(const int timeout_ms, const datagram_handler &on_datagram, const send_handler &on_send)
+{
+    if ( not _recv_armed ) {
+        io_uring_sqe *sqe = get_sqe();
+        if ( not sqe ) {
+            return -EBUSY;
+        }
+        sqe->opcode    = IORING_OP_RECV;
+        sqe->fd        = _fd;
+        sqe->ioprio    = IORING_RECV_MULTISHOT;
+        sqe->flags     = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+        sqe->user_data = NL_URING_RECV_ID;
+        _recv_armed    = true;
+    }
+
+    int count = reap(on_datagram, on_send);
+    if ( count and not _to_submit ) {
+        return count;  // no need to enter the kernel
+    }
+
+    store_release(_sq_tail, _sq_local_tail);
+    int rc = enter(_to_submit, count ? 0 : 1, timeout_ms);
+    if ( rc >= 0 ) {
+        _to_submit -= rc;
+    }
+    if ( rc < 0 and rc != -ETIME and rc != -EINTR ) {
+        return rc;
+    }
+
+    count += reap(on_datagram, on_send);
+    if ( not count ) {
+        return -ETIMEDOUT;
+    }
+    return count;
+}
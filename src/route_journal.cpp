@@ -0,0 +1,65 @@
+#include "route_journal.h"
+
+/**
+ * @brief
+ * Count of the deltas which are still into the ring
+ */
+size_t route_journal::size() const
+{
+    uint64_t count = _version - _floor;
+    return count < _capacity ? count : _capacity;
+}
+
+route_delta &route_journal::next(const route_delta::e_op op)
+{
+    if ( _ring.empty() ) {
+        _ring.resize(_capacity);  // tables which never change don't pay for the ring
+    }
+    ++_version;
+    route_delta &delta = _ring[(_version - 1) % _capacity];
+    delta.version      = _version;
+    delta.op           = op;
+    return delta;
+}
+
+void route_journal::record(const route_delta::e_op op, const route_v4 &route)
+{
+    route_delta &delta = next(op);
+    delta.is_v6        = false;
+    delta.v4           = route;
+}
+
+void route_journal::record(const route_delta::e_op op, const route_v6 &route)
+{
+    route_delta &delta = next(op);
+    delta.is_v6        = true;
+    delta.v6           = route;
+}
+
+/**
+ * @brief
+ * Drop the deltas: the table was changed in a way the journal can't describe. Every consumer has to resync
+ */
+void route_journal::reset()
+{
+    ++_version;
+    _floor = _version;
+}
+
+/**
+ * @brief
+ * Get the changes after the version, oldest first
+ * @param version the version the consumer has synced to
+ * @return int "0" - the deltas have been appended; "1" - the changes aren't into the ring any more, resync the whole table
+ */
+int route_journal::changes_since(const uint64_t version, std::vector<route_delta> &deltas) const
+{
+    if ( version > _version or version < _version - size() ) {
+        return 1;
+    }
+    deltas.reserve(deltas.size() + (_version - version));
+    for ( uint64_t next = version + 1; next <= _version; ++next ) {
+        deltas.push_back(_ring[(next - 1) % _capacity]);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "route_multipath.h"
+#include "nl_epoch.h"
+#include "route_store.h"
+
+route_multipath::~route_multipath()
+{
+    for ( auto &segment : _segments ) {
+        delete[] segment.load();
+    }
+}
+
+size_t route_multipath::hops_hash::operator() (const std::vector<route_hop> &hops) const
+{
+    uint64_t hash = hops.size();
+    for ( const route_hop &hop : hops ) {
+        uint64_t words[2];
+        memcpy(words, hop.gw, sizeof(words));
+        hash = route_hash_mix(hash, words[0]);
+        hash = route_hash_mix(hash, words[1]);
+        hash = route_hash_mix(hash, ((uint64_t)hop.iface_id << 16) | ((uint64_t)hop.family << 8) | hop.weight);
+    }
+    return hash;
+}
+
+/**
+ * @brief
+ * Id of the hop list: the one of an equal live list if it's known, a new or a freed one otherwise.
+ * The list has no reference until a table stores a route with it
+ * @return uint32_t "0" - the list is empty or there is no room for it
+ */
+uint32_t route_multipath::intern(const std::vector<route_hop> &hops)
+{
+    if ( hops.empty() ) {
+        return 0;
+    }
+    auto pos = _ids.find(hops);
+    if ( pos != _ids.end() ) {
+        return pos->second;
+    }
+
+    uint32_t id = 0;
+    if ( not _free.empty() ) {
+        id = _free.back();
+        _free.pop_back();
+    } else {
+        uint32_t index = _size.load(std::memory_order_relaxed);
+        if ( index >= ROUTE_MULTIPATH_SEGMENT * ROUTE_MULTIPATH_SEGMENTS ) {
+            return 0;
+        }
+        if ( not _segments[index / ROUTE_MULTIPATH_SEGMENT].load(std::memory_order_relaxed) ) {
+            _segments[index / ROUTE_MULTIPATH_SEGMENT].store(new entry[ROUTE_MULTIPATH_SEGMENT], std::memory_order_release);
+        }
+        id = index + 1;
+    }
+    entry &list = at(id);
+    list.hops   = hops;
+    list.refs   = 0;
+    list.live   = true;
+    if ( id > _size.load(std::memory_order_relaxed) ) {
+        _size.store(id, std::memory_order_release);  // the list is complete before its id is seen
+    }
+    _ids.emplace(hops, id);
+    return id;
+}
+
+/**
+ * @brief
+ * A table has stored a route with the list. A list dropped meanwhile (by discard() of another event) is live again
+ */
+void route_multipath::retain(const uint32_t id)
+{
+    if ( not id or id > _size.load(std::memory_order_relaxed) or at(id).hops.empty() ) {  // freed
+        return;
+    }
+    entry &list = at(id);
+    ++list.refs;
+    if ( not list.live ) {
+        list.live = true;
+        _ids.emplace(list.hops, id);  // unless an equal list has been interned since
+    }
+}
+
+/**
+ * @brief
+ * A table has deleted a route with the list, the list is dropped with its last route
+ */
+void route_multipath::release(const uint32_t id)
+{
+    if ( not id or id > _size.load(std::memory_order_relaxed) or not at(id).refs ) {
+        return;
+    }
+    if ( not --at(id).refs ) {
+        drop(id);
+    }
+}
+
+/**
+ * @brief
+ * Drop the list if no table has stored a route with it: the route event wasn't applied
+ */
+void route_multipath::discard(const uint32_t id)
+{
+    if ( not id or id > _size.load(std::memory_order_relaxed) ) {
+        return;
+    }
+    entry &list = at(id);
+    if ( list.live and not list.refs ) {
+        drop(id);
+    }
+}
+
+void route_multipath::drop(const uint32_t id)
+{
+    entry &list = at(id);
+    list.live   = false;
+    auto pos    = _ids.find(list.hops);
+    if ( pos != _ids.end() and pos->second == id ) {
+        _ids.erase(pos);
+    }
+    _dropped.emplace_back(id, ++list.drops);
+}
+
+/**
+ * @brief
+ * Free the dropped lists once the readers which could have loaded them are gone. Called after the data which held
+ * their ids has been unpublished (the snapshots without the deleted routes)
+ */
+void route_multipath::retire_dropped()
+{
+    if ( _dropped.empty() ) {
+        return;
+    }
+    nl_epoch::get_instance().retire([this, dropped = std::move(_dropped)] () {
+        for ( const auto &[id, drop] : dropped ) {
+            entry &list = at(id);
+            if ( not list.live and list.drops == drop ) {  // not retained again, nor dropped again later
+                std::vector<route_hop>().swap(list.hops);
+                _free.push_back(id);
+            }
+        }
+    });
+    _dropped.clear();
+}
@@ -0,0 +1,55 @@
+#include "route_snapshot.h"
+
+/**
+ * @brief
+ * Readers must have left the snapshots before (the manager lives until the process exits)
+ */
+route_snapshots::~route_snapshots()
+{
+    delete _current.exchange(nullptr);
+}
+
+void route_snapshots::add(const route_v4 &route)
+{
+    _next.v4.upsert(route);
+    _changed = true;
+}
+
+void route_snapshots::add(const route_v6 &route)
+{
+    _next.v6.upsert(route);
+    _changed = true;
+}
+
+void route_snapshots::del(const route_v4 &route)
+{
+    _changed |= _next.v4.erase(route);
+}
+
+void route_snapshots::del(const route_v6 &route)
+{
+    _changed |= _next.v6.erase(route);
+}
+
+void route_snapshots::clear()
+{
+    _next.v4.clear();
+    _next.v6.clear();
+    _changed = true;
+}
+
+/**
+ * @brief
+ * Make the changes visible to readers. The snapshot shares the chunks with the writer copy,
+ * so it costs one pointer per chunk however many routes have changed
+ * @param version table version the snapshot is at
+ */
+void route_snapshots::publish(const uint64_t version)
+{
+    _next.version               = version;
+    const route_snapshot *old   = _current.exchange(new route_snapshot(_next));
+    _changed                    = false;
+    if ( old ) {
+        nl_epoch::get_instance().retire([old] () { delete old; });
+    }
+}
@@ -1,4 +1,7 @@
 #include "system_iface.h"
+#include "link_cache.h"
+#include "nl_hub.h"
+#include "vrf_registry.h"
 
 int system_iface::allocate_tun()
 {
@@ -50,49 +53,23 @@ int system_iface::allocate_tap()
     return 1;
 }
 
+/**
+ * @brief
+ * Take a request socket from the nl_hub pool. The events of the interface come through the hub (see attach()),
+ * so neither the fd count nor the kernel fan-out of the events grows with the count of interfaces
+ */
 int system_iface ::create_nl_socket()
 {
-    memset(&nl_addr, 0, sizeof(nl_addr));
-    nl_addr.nl_family = AF_NETLINK;
-    nl_addr.nl_groups = RTMGRP_LINK;
-    nl_addr.nl_groups |= RTMGRP_IPV4_IFADDR;
-    nl_addr.nl_groups |= RTMGRP_IPV6_IFADDR;
-    nl_addr.nl_groups |= RTMGRP_IPV4_ROUTE;
-    nl_addr.nl_groups |= RTMGRP_IPV6_ROUTE;
-
-    // nl_addr.nl_pid = getpid();
-
-    nl_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    nl_socket = nl_hub::get_instance().request_socket();
     if ( nl_socket == -1 ) {
-        std::cerr << "Failed to create NL socket: " << strerror(errno) << std::endl;
+        std::cerr << "Failed to get NL request socket for " << name << std::endl;
         return -1;
     }
-    // struct timeval tv;
-    // tv.tv_sec = 1;
-    // tv.tv_usec = 0;
-
-    // Enable kernel filtering
-    int optval = 1;
-    if ( setsockopt(nl_socket, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &optval, sizeof(optval)) < 0 ) {
-        fprintf(stderr, "Netlink set socket option \"NETLINK_GET_STRICT_CHK\" failed: %s\n", strerror(errno));
-        return EXIT_FAILURE;
-    }
-
-    if ( bind(nl_socket, (struct sockaddr *)&nl_addr, sizeof(nl_addr)) < 0 ) {
-        std::cerr << "Failed to bind NL socket: " << strerror(errno) << std::endl;
-        return -1;
-    };
     return 1;
 }
 
 int system_iface::set_ip_addr(const std::string &addr, const std::string &mask)
 {
-    sockaddr_nl sa;
-    memset(&sa, 0, sizeof(sockaddr_nl));
-
-    sa.nl_family = AF_NETLINK;
-    sa.nl_groups = RTMGRP_IPV4_IFADDR;
-
     int rc = nl_socket_handler::request_add_ip_addr(nl_socket, addr, mask, linux_interface_id);
     if ( rc < 0 ) {
         std::cout << "Failed to add IP: " << addr << " to interface " << name << "\t"
@@ -129,125 +106,42 @@ uint32_t system_iface::search_iface()
     return linux_interface_id;
 }
 
+/**
+ * @brief
+ * Find the interface index by the link_cache, no kernel round trip. The queued link events are applied first:
+ * the interface may have just been created. fd is kept for the callers
+ * @return "0" - the interface hasn't been found; "uint32_t" - interface index in LINUX
+ */
 uint32_t system_iface::search_iface(const int fd, const std::string& name){
-    return nl_socket_handler::search_iface(fd, name);
+    (void)fd;
+    link_cache &links = link_cache::get_instance();
+    links.sync();
+    return links.ifindex(name);
 }
 
+/**
+ * @brief
+ * Take the first queued route event of the interface. Reads the nl_hub socket, so the events of the other
+ * interfaces are passed to their subscribers
+ * @return true - the route has been taken; false - no route event of the interface is queued
+ */
 bool system_iface::update_routes(linux_route &route)
 {
-    ssize_t msg_size = 0;
-    char nl_sock_resp_buf[BUF_SIZE] = {0};
-
-    struct nlmsghdr *nlh;
-    while ( 1 ) {
-        msg_size = recv(nl_socket, nl_sock_resp_buf, BUF_SIZE, 0);
-        if ( msg_size <= 0 ) {
-            break;
-        }
-        nlh = (struct nlmsghdr *)nl_sock_resp_buf;
-        // If we received all data
-        if ( nlh->nlmsg_type == NLMSG_DONE ) {
-            break;
-        }
-        if ( nlh->nlmsg_type == RTM_DELROUTE ) {
-            break;
-        }
-        if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
-            break;
-        }
-        if ( nl_addr.nl_groups == RTMGRP_IPV4_ROUTE ) {
-            break;
+    bool found = false;
+    nl_event_handlers handlers;
+    handlers.on_route = [&route, &found] (const linux_route &event) {
+        if ( not found ) {
+            route = event;
+            found = true;
         }
-        if ( nl_addr.nl_groups == RTMGRP_IPV6_ROUTE ) {
-            break;
-        }
-    }
-
-    struct rtmsg *route_entry;
-    struct rtattr *route_attribute;
-    int route_attribute_len = 0;
-
-    for ( ; NLMSG_OK(nlh, msg_size);
-          nlh = NLMSG_NEXT(nlh, msg_size) ) {
-        // Get the route data
-        route_entry     = (struct rtmsg *)NLMSG_DATA(nlh);
-        route.mask_len  = route_entry->rtm_dst_len;
-        route.rt_number = route_entry->rtm_table;
-        route.proto     = route_entry->rtm_protocol;
-
-        // if ( route_entry->rtm_table != RT_TABLE_MAIN )
-        //     continue;
-
-        /* Get attributes of route_entry */
-        route_attribute = (struct rtattr *)RTM_RTA(route_entry);
-
-        /* Get the route atttibutes len */
-        route_attribute_len = RTM_PAYLOAD(nlh);
-        /* Loop through all attributes */
-        for ( ; RTA_OK(route_attribute, route_attribute_len);
-              route_attribute = RTA_NEXT(route_attribute, route_attribute_len) ) {
-            /* Get the destination address */
-            if ( route_attribute->rta_type == RTA_DST ) {
-                if ( route_entry->rtm_family == AF_INET ) {
-
-                    auto _dest      = (struct sockaddr_in *)&(route.dest);
-                    _dest->sin_addr = *((in_addr *)RTA_DATA(route_attribute));
-
-                } else {
-                    auto _dest       = (struct sockaddr_in6 *)&(route.dest);
-                    _dest->sin6_addr = *((in6_addr *)RTA_DATA(route_attribute));
-                }
-
-                route.dest.ss_family = route_entry->rtm_family;
-                continue;
-            }
-            /* Get the gateway (Next hop) */
-            if ( route_attribute->rta_type == RTA_GATEWAY ) {
-                if ( route_entry->rtm_family == AF_INET ) {
-                    auto _gw      = (struct sockaddr_in *)&(route.gw);
-                    _gw->sin_addr = *((in_addr *)RTA_DATA(route_attribute));
-                } else {
-                    auto _gw       = (struct sockaddr_in6 *)&(route.gw);
-                    _gw->sin6_addr = *((in6_addr *)RTA_DATA(route_attribute));
-                }
-
-                route.gw.ss_family = route_entry->rtm_family;
-                continue;
-            }
-
-            if ( route_attribute->rta_type == RTA_PRIORITY ) {
-                route.priority = *(uint8_t *)RTA_DATA(route_attribute);
-                continue;
-            }
-
-            if ( route_attribute->rta_type == RTA_METRICS ) {
-                route.metrics = *(uint8_t *)RTA_DATA(route_attribute);
-                continue;
-            }
-
-            if ( route_attribute->rta_type == RTA_OIF ) {
-                route.iface_id = *(uint8_t *)RTA_DATA(route_attribute);
-                continue;
-            }
-        }
-
-        if ( nlh->nlmsg_type == RTM_NEWROUTE ) {
-            route.status = linux_route::e_status::NEW;
-        };
-        if ( nlh->nlmsg_type == RTM_DELROUTE ) {
-            route.status = linux_route::e_status::DELETE;
-        };
-        if ( route.status == linux_route::e_status::EMPTY ) {
-            continue;
-        }
-
-        // std::cout << route << std::endl;
-    }
-
-    return false;
+    };
+    nl_hub &hub = nl_hub::get_instance();
+    uint64_t id = hub.subscribe(linux_interface_id, std::move(handlers));
+    hub.poll();
+    hub.unsubscribe(id);
+    return found;
 }
 
-
 int system_iface::set_iface_state(const bool up)
 {
     std::cout << "request state changing to " << (up ? "UP" : "DOWN")
@@ -276,13 +170,19 @@ int system_iface::add_to_vrf(const std::string &linux_vrf_name)
     }
 
     vrf_name = linux_vrf_name;
-    vrf_index = search_iface(nl_socket, vrf_name);  // check the VRF exists
-    if ( not vrf_index ) {
+    vrf_registry &vrfs   = vrf_registry::get_instance();
+    const vrf_entry *vrf = vrfs.find(vrf_name);  // check the VRF exists
+    if ( not vrf ) {  // it may have just been created: apply the queued link events
+        vrfs.sync();
+        vrf = vrfs.find(vrf_name);
+    }
+    if ( not vrf ) {
         std::cout << "Can't find VRF: " << vrf_name << " into linux system" << std::endl;
         return -1;
     }
+    vrf_index       = vrf->ifindex;
+    linux_rt_number = vrf->rt_number;
     nl_socket_handler::request_updown(nl_socket, vrf_index, true); // vrf has to be up
-    linux_rt_number = nl_socket_handler::get_rt_number_from_vrf_name(nl_socket, vrf_name); 
     rc = nl_socket_handler::request_add_iface_to_vrf(nl_socket, vrf_index, linux_interface_id);
     if ( rc ) {
         std::cout << "Can't add interface " << name << " to VRF " << vrf_name << std::endl;
@@ -292,8 +192,65 @@ int system_iface::add_to_vrf(const std::string &linux_vrf_name)
     return 0;
 }
 
+/**
+ * @brief
+ * Subscribe to the events of the interface through the nl_hub and let the reactor read the hub socket.
+ * Only the events of this interface (by linux_interface_id) are passed to the handlers
+ * @param reactor event loop
+ * @param handlers handlers for route/link/address/neighbour events of the interface
+ * @return int "0" - success; "-ENODEV" - the interface isn't found; "-EBUSY" - the hub is read by another reactor;
+ * "-errno" - the socket can't be registered
+ */
+int system_iface::attach(nl_reactor &reactor, const nl_event_handlers &handlers)
+{
+    if ( not linux_interface_id and not search_iface() ) {
+        return -ENODEV;
+    }
+    nl_hub &hub = nl_hub::get_instance();
+    int rc      = hub.attach(reactor);
+    if ( rc < 0 ) {
+        return rc;
+    }
+
+    nl_event_handlers own = handlers;
+    if ( handlers.on_link ) {
+        own.on_link = [this, on_link = handlers.on_link] (const link_event &event) {
+            up = event.flags & IFF_UP;
+            on_link(event);
+        };
+    }
+    if ( hub_subscription ) {  // attached again: the hub is attached once for us
+        hub.unsubscribe(hub_subscription);
+        hub.detach(*hub_reactor);
+    }
+    hub_subscription = hub.subscribe(linux_interface_id, std::move(own));
+    hub_reactor      = &reactor;
+    return 0;
+}
+
+/**
+ * @brief
+ * Unsubscribe from the hub, the hub leaves the reactor with the last attached interface. The subscriptions of
+ * the caches (link_cache, vrf_registry) don't keep it there
+ * @return int "0" - success; "-ENOENT" - not attached to the reactor
+ */
+int system_iface::detach(nl_reactor &reactor)
+{
+    nl_hub &hub = nl_hub::get_instance();
+    if ( not hub_subscription or hub_reactor != &reactor ) {
+        return -ENOENT;
+    }
+    hub.unsubscribe(hub_subscription);
+    hub_subscription = 0;
+    hub_reactor      = nullptr;
+    return hub.detach(reactor);
+}
+
 void system_iface::stop()
 {
+    if ( hub_subscription ) {  // the handlers point to us
+        detach(*hub_reactor);
+    }
     if (created_vrf && vrf_index){
         nl_socket_handler::request_del_vrf(nl_socket, vrf_index);
     }
@@ -0,0 +1,174 @@
+#include "vrf_registry.h"
+#include "link_cache.h"
+#include "nl_hub.h"
+
+vrf_registry::vrf_registry()
+{
+    link_cache::get_instance();  // created first, so it's destroyed after us
+    nl_event_handlers handlers;
+    handlers.on_link    = [this] (const link_event &event) { apply(event); };
+    handlers.on_overrun = [this] () { _stale = true; };
+    _subscription       = nl_hub::get_instance().subscribe(NO_SYSTEM_ID, std::move(handlers));
+}
+
+vrf_registry::~vrf_registry()
+{
+    nl_hub::get_instance().unsubscribe(_subscription);
+}
+
+void vrf_registry::notify(const vrf_entry &vrf, const bool removed)
+{
+    auto listeners = _listeners;  // a listener may unlisten
+    for ( auto &[id, on_change] : listeners ) {
+        on_change(vrf, removed);
+    }
+}
+
+void vrf_registry::add(const vrf_entry &vrf)
+{
+    _vrfs[vrf.ifindex]     = vrf;
+    _names[vrf.name]       = vrf.ifindex;
+    _tables[vrf.rt_number] = vrf.ifindex;
+    notify(vrf, false);
+}
+
+void vrf_registry::remove(const uint32_t ifindex)
+{
+    auto pos = _vrfs.find(ifindex);
+    if ( pos == _vrfs.end() ) {
+        return;
+    }
+    vrf_entry vrf = pos->second;
+    _vrfs.erase(pos);
+    if ( _names[vrf.name] == ifindex ) {
+        _names.erase(vrf.name);
+    }
+    if ( _tables[vrf.rt_number] == ifindex ) {
+        _tables.erase(vrf.rt_number);
+    }
+    notify(vrf, true);
+}
+
+/**
+ * @brief
+ * Apply a link event: a new VRF is added, a deleted one is removed, a renamed one or one with another table
+ * is removed and added again. Events of other interfaces are skipped
+ */
+void vrf_registry::apply(const link_event &event)
+{
+    if ( event.deleted or strcmp(event.kind, "vrf") != 0 or not event.vrf_table ) {
+        remove(event.ifindex);
+        return;
+    }
+    vrf_entry vrf = {event.name, event.ifindex, event.vrf_table, (event.flags & IFF_UP) != 0};
+
+    auto pos = _vrfs.find(event.ifindex);
+    if ( pos != _vrfs.end() ) {
+        if ( pos->second.name == vrf.name and pos->second.rt_number == vrf.rt_number ) {
+            pos->second.up = vrf.up;
+            return;
+        }
+        remove(event.ifindex);
+    }
+    add(vrf);
+}
+
+/**
+ * @brief
+ * Replace the VRFs with the ones of the link_cache (dumped again if the hub has lost events). The listeners are
+ * told only about the difference
+ */
+void vrf_registry::rebuild()
+{
+    _stale = false;
+    std::vector<link_event> vrfs;
+    link_cache::get_instance().for_each([&vrfs] (const link_event &link) {
+        if ( strcmp(link.kind, "vrf") == 0 ) {
+            vrfs.push_back(link);
+        }
+    });
+
+    std::vector<uint32_t> gone;
+    for ( const auto &[ifindex, vrf] : _vrfs ) {
+        if ( std::none_of(vrfs.begin(), vrfs.end(), [ifindex] (const link_event &link) { return link.ifindex == ifindex; }) ) {
+            gone.push_back(ifindex);
+        }
+    }
+    for ( uint32_t ifindex : gone ) {
+        remove(ifindex);
+    }
+    for ( const link_event &link : vrfs ) {
+        apply(link);
+    }
+}
+
+/**
+ * @brief
+ * Rebuild if the registry isn't filled yet or some events are lost. No socket read otherwise
+ */
+void vrf_registry::fill()
+{
+    if ( _stale ) {
+        rebuild();
+    }
+}
+
+/**
+ * @brief
+ * Apply the link events queued into the hub, rebuild if some events are lost. For the callers whose hub isn't
+ * drained by a reactor
+ */
+void vrf_registry::sync()
+{
+    nl_hub::get_instance().poll();
+    fill();
+}
+
+const vrf_entry *vrf_registry::find(const std::string &name)
+{
+    fill();
+    auto pos = _names.find(name);
+    return pos == _names.end() ? nullptr : &_vrfs[pos->second];
+}
+
+const vrf_entry *vrf_registry::find_by_table(const uint32_t rt_number)
+{
+    fill();
+    auto pos = _tables.find(rt_number);
+    return pos == _tables.end() ? nullptr : &_vrfs[pos->second];
+}
+
+const vrf_entry *vrf_registry::find_by_index(const uint32_t ifindex)
+{
+    fill();
+    auto pos = _vrfs.find(ifindex);
+    return pos == _vrfs.end() ? nullptr : &pos->second;
+}
+
+uint32_t vrf_registry::rt_number(const std::string &name)
+{
+    const vrf_entry *vrf = find(name);
+    return vrf ? vrf->rt_number : 0;
+}
+
+size_t vrf_registry::size()
+{
+    fill();
+    return _vrfs.size();
+}
+
+/**
+ * @brief
+ * Call on_change(vrf, removed) for every VRF which appears or disappears from now on
+ * @return uint64_t listener id for unlisten()
+ */
+uint64_t vrf_registry::listen(listener on_change)
+{
+    _listeners.emplace_back(++_last_id, std::move(on_change));
+    return _last_id;
+}
+
+bool vrf_registry::unlisten(const uint64_t id)
+{
+    return std::erase_if(_listeners, [id] (const auto &listener) { return listener.first == id; }) != 0;
+}
@@ -1,6 +1,18 @@
 #include <gtest/gtest.h>
+#include <linux/veth.h>
+#include <algorithm>
+#include <set>
+#include <thread>
 
+#include "link_cache.h"
+#include "linux_neigh.h"
 #include "netlink.h"
+#include "nl_async.h"
+#include "nl_batch.h"
+#include "nl_coro.h"
+#include "nl_hub.h"
+#include "nl_reactor.h"
+#include "vrf_registry.h"
 
 system_iface *iface = nullptr;
 int _iface_index    = -1;
@@ -192,6 +204,1266 @@ TEST_F(Netlink_test, parse_routing_tabel){
 
 }
 
+TEST_F(Netlink_test, route_batch)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.10.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+
+    iface->set_iface_state(true); // UP the interface
+
+    const size_t SSIZE = 300;  // more than one sendmsg
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number);
+    }
+    auto invalid   = batch.add_route(dst_ip, gw, 33, 0, iface->linux_interface_id, rt_number);
+    auto duplicate = batch.add_route(dst_ip, gw, 24, 0, iface->linux_interface_id, rt_number);
+
+    int fd       = nl_socket_handler::open_request_socket();
+    auto results = batch.flush(fd);
+    EXPECT_EQ(results.size(), SSIZE + 2);
+    EXPECT_TRUE(batch.empty());
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        EXPECT_EQ(results[i], EXIT_SUCCESS);
+    }
+    EXPECT_EQ(results[invalid], -EINVAL);
+    EXPECT_EQ(results[duplicate], EEXIST);
+
+    linux_routing_table rt(rt_number, vrf_name);
+    char *result     = new char[BUF_SIZE];
+    size_t dump_size = nl_socket_handler::request_get_route_list(fd, rt_number, result, BUF_SIZE);
+    EXPECT_EQ(rt.get_routes_from_nl_resp(result, dump_size), SSIZE);
+
+    // the manager creates the table which isn't followed yet
+    auto &rt_manager = linux_rt_manager::get_instance();
+    ASSERT_FALSE(rt_manager.rt_number_is_followed(rt_number));
+    EXPECT_EQ(rt_manager.get_routes_from_nl_resp(rt_number, result, dump_size), SSIZE);
+    ASSERT_NE(rt_manager.get(rt_number), nullptr);
+    EXPECT_EQ(rt_manager.get(rt_number)->size(), SSIZE);
+    EXPECT_EQ(rt_manager.unfollow_rt(rt_number), 0);
+    delete[] result;
+
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number);
+    }
+    results = batch.flush(fd);
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        EXPECT_EQ(results[i], EXIT_SUCCESS);
+    }
+    close(fd);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+}
+
+TEST_F(Netlink_test, async_engine)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.20.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+
+    int fd = nl_socket_handler::open_request_socket();
+    nl_socket_handler::nl_async_engine engine(fd, 8);  // smaller than the count of requests
+
+    int updown_rc = -1;
+    engine.updown(iface->linux_interface_id, true, [&updown_rc] (int rc) { updown_rc = rc; });
+
+    const size_t SSIZE = 20;
+    std::vector<int> results(SSIZE, -1);
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        engine.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number, RTPROT_STATIC,
+                         [&results, i] (int rc) { results[i] = rc; });
+    }
+    auto duplicate = engine.submit([&] (nl_socket_handler::nl_msg_builder &msg, uint32_t seq_num) {
+        nl_socket_handler::build_add_route(msg, seq_num, dst_ip, gw, 24, 0, iface->linux_interface_id, rt_number, RTPROT_STATIC);
+    });
+
+    size_t dumped = 0;
+    engine.submit([&] (nl_socket_handler::nl_msg_builder &msg, uint32_t seq_num) {
+        nl_socket_handler::build_get_route_list(msg, seq_num, rt_number);
+    }, nullptr, [&dumped] (nlmsghdr *nlh) { dumped += (nlh->nlmsg_type == RTM_NEWROUTE); });
+
+    engine.drain();
+    EXPECT_EQ(engine.pending(), 0);
+    EXPECT_EQ(updown_rc, EXIT_SUCCESS);
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        EXPECT_EQ(results[i], EXIT_SUCCESS);
+    }
+    EXPECT_EQ(duplicate.get(), EEXIST);
+    EXPECT_EQ(dumped, SSIZE);
+
+    close(fd);
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+
+    // a broken socket fails the requests in flight instead of blocking submit()
+    int sent_rc = 0, queued_rc = 0;
+    nl_socket_handler::nl_async_engine broken(nl_socket_handler::open_request_socket(), 1);
+    broken.updown(iface->linux_interface_id, false, [&sent_rc] (int rc) { sent_rc = rc; });
+    broken.flush();
+    close(broken.get_fd());
+    broken.updown(iface->linux_interface_id, false, [&queued_rc] (int rc) { queued_rc = rc; });  // the window is full
+    EXPECT_EQ(sent_rc, -EBADF);
+    broken.drain();
+    EXPECT_EQ(queued_rc, -EBADF);
+    EXPECT_EQ(broken.pending(), 0);
+
+    // ACKs lost by an overrun are local failures (-ENOBUFS), not kernel errors
+    const size_t LOST_SIZE = 256;
+    int small_fd           = nl_socket_handler::open_request_socket();
+    ASSERT_GT(nl_socket_handler::set_rcvbuf(small_fd, 4096), 0);  // overrun on purpose
+    nl_socket_handler::nl_async_engine overrun(small_fd, LOST_SIZE);
+    std::vector<int> lost(LOST_SIZE, 0);
+    for ( size_t i = 0; i < LOST_SIZE; i++ ) {  // no such routes: every ACK is an error carrying the request
+        overrun.submit([&] (nl_socket_handler::nl_msg_builder &msg, uint32_t seq_num) {
+            nl_socket_handler::build_route(msg, seq_num, RTM_DELROUTE, 0, htonl(ntohl(dst_ip) + (i << 8)), 0, 24, 0, 0, rt_number, 0);
+        }, [&lost, i] (int rc) { lost[i] = rc; });
+    }
+    overrun.drain();
+    EXPECT_EQ(overrun.pending(), 0);
+    EXPECT_GT(overrun.overruns(), 0);
+    EXPECT_NE(std::count(lost.begin(), lost.end(), -ENOBUFS), 0);
+    EXPECT_EQ(std::count(lost.begin(), lost.end(), ENOBUFS), 0);
+    EXPECT_EQ(std::count(lost.begin(), lost.end(), -ENOBUFS) + std::count(lost.begin(), lost.end(), ESRCH), LOST_SIZE);
+    close(small_fd);
+}
+
+TEST_F(Netlink_test, uring_batch)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.40.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+
+    iface->set_iface_state(true); // UP the interface
+
+    int fd = nl_socket_handler::open_request_socket();
+    nl_socket_handler::nl_uring ring(fd);  // falls back to send/recv without io_uring
+
+    const size_t SSIZE = 600;  // more than NL_URING_BUFS ACKs in flight
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number);
+    }
+    auto duplicate = batch.add_route(dst_ip, gw, 24, 0, iface->linux_interface_id, rt_number);
+    auto results   = batch.flush(ring);
+    EXPECT_EQ(results.size(), SSIZE + 1);
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        EXPECT_EQ(results[i], EXIT_SUCCESS);
+    }
+    EXPECT_EQ(results[duplicate], EEXIST);
+
+    size_t dumped = 0;
+    int rc        = ring.dump([] (nl_socket_handler::nl_msg_builder &msg, uint32_t seq_num) {
+        nl_socket_handler::build_get_route_list(msg, seq_num, rt_number);
+    }, [&dumped] (nlmsghdr *nlh) { dumped += (nlh->nlmsg_type == RTM_NEWROUTE); });
+    EXPECT_EQ(rc, EXIT_SUCCESS);
+    EXPECT_EQ(dumped, SSIZE);
+
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number);
+    }
+    for ( int rc : batch.flush(ring) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    close(fd);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+}
+
+TEST_F(Netlink_test, reactor)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.30.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+
+    nl_reactor reactor;
+    ASSERT_TRUE(reactor.is_open());
+
+    auto rt_number3  = rt_number + 3;
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number3, vrf_name);
+    size_t changes = 0;
+    EXPECT_EQ(rt_manager.attach(reactor, [&changes] (const linux_route &) { ++changes; }), 0);
+
+    size_t link_events = 0;
+    nl_event_handlers handlers;
+    handlers.on_link = [&link_events] (const link_event &event) { link_events += (event.flags & IFF_UP) != 0; };
+    EXPECT_EQ(iface->attach(reactor, handlers), 0);
+
+    int fd = nl_socket_handler::open_request_socket();
+    EXPECT_EQ(nl_socket_handler::request_updown(fd, iface->linux_interface_id, true), 1);
+
+    const size_t SSIZE = 5;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number3);
+    }
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+
+    bool posted = false;
+    std::thread([&reactor, &posted] { reactor.post([&posted] { posted = true; }); }).join();
+
+    for ( int i = 0; i < 100 and (changes < SSIZE or not link_events or not posted); i++ ) {
+        reactor.run_once(10);
+    }
+    EXPECT_EQ(changes, SSIZE);
+    EXPECT_EQ(rt_manager.get(rt_number3)->size(), SSIZE);
+    EXPECT_GT(link_events, 0);
+    EXPECT_TRUE(posted);
+
+    EXPECT_EQ(rt_manager.detach(reactor), 0);
+    EXPECT_EQ(iface->detach(reactor), 0);
+    close(fd);
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+}
+
+TEST_F(Netlink_test, reactor_reattach)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    nl_event_handlers handlers;
+    size_t link_events = 0;
+    handlers.on_link   = [&link_events] (const link_event &) { ++link_events; };
+    {
+        nl_reactor first;
+        ASSERT_EQ(iface->attach(first, handlers), 0);
+        EXPECT_EQ(iface->attach(first, handlers), 0);  // again: one attach of the hub
+        EXPECT_EQ(iface->detach(first), 0);
+        EXPECT_EQ(iface->detach(first), -ENOENT);
+    }
+    link_cache::get_instance();  // the caches stay subscribed to the hub
+
+    // the hub has left the destroyed reactor
+    nl_reactor second;
+    ASSERT_EQ(iface->attach(second, handlers), 0);
+    iface->set_iface_state(true);
+    for ( int i = 0; i < 100 and not link_events; i++ ) {
+        second.run_once(10);
+    }
+    EXPECT_GT(link_events, 0);
+    EXPECT_EQ(iface->detach(second), 0);
+    iface->set_iface_state(false);
+}
+
+TEST_F(Netlink_test, stream_dump)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.60.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    const uint32_t rt_number5 = rt_number + 5;
+
+    iface->set_iface_state(true); // UP the interface
+
+    const size_t SSIZE = 1000;  // many datagrams
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number5);
+    }
+    int fd = nl_socket_handler::open_request_socket(SOCK_NONBLOCK);
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+
+    size_t visited = 0;
+    int rc         = nl_socket_handler::request_get_route_list(fd, rt_number5, [&visited] (nlmsghdr *nlh) {
+        visited += (linux_route::parse_route_from_nl_resp_hdr(nlh).rt_number == rt_number5);
+    });
+    EXPECT_EQ(rc, EXIT_SUCCESS);
+    EXPECT_EQ(visited, SSIZE);
+
+    linux_routing_table rt(rt_number5, vrf_name);
+    EXPECT_EQ(rt.get_routes_from_nl_dump(fd), SSIZE);
+    EXPECT_EQ(rt.size(), SSIZE);
+
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number5);
+    }
+    batch.flush(fd);
+    EXPECT_EQ(linux_routing_table(rt_number5).get_routes_from_nl_dump(fd), 0);
+    close(fd);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+}
+
+TEST_F(Netlink_test, bulk_resync)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.70.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+
+    iface->set_iface_state(true); // UP the interface
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    const uint32_t tables[] = {rt_number + 6, rt_number + 7, rt_number + 8};  // the last one isn't followed
+    rt_manager.follow_rt(tables[0], vrf_name);
+    rt_manager.follow_rt(tables[1]);
+
+    nl_socket_handler::nl_batch batch;
+    size_t index = 0;
+    for ( size_t t = 0; t < 3; t++ ) {
+        for ( size_t i = 0; i < t + 3; i++, index++ ) {
+            batch.add_route(htonl(ntohl(dst_ip) + (index << 8)), gw, 24, 0, iface->linux_interface_id, tables[t]);
+        }
+    }
+    int fd = nl_socket_handler::open_request_socket();
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    close(fd);
+
+    EXPECT_GE(rt_manager.update_all(), 3 + 4);
+    EXPECT_EQ(rt_manager.get(tables[0])->size(), 3);
+    EXPECT_EQ(rt_manager.get(tables[1])->size(), 4);
+    EXPECT_FALSE(rt_manager.rt_number_is_followed(tables[2]));
+    EXPECT_EQ(rt_manager.get_name(tables[0]), vrf_name);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+    EXPECT_GE(rt_manager.update_all(), 0);
+    EXPECT_EQ(rt_manager.get(tables[0])->size(), 0);
+}
+
+TEST_F(Netlink_test, lpm_lookup)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    in_addr_t addr   = 0;
+    inet_pton(AF_INET, "10.80.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    inet_pton(AF_INET, "10.80.1.7", &addr);
+
+    iface->set_iface_state(true); // UP the interface
+
+    auto &rt_manager         = linux_rt_manager::get_instance();
+    const uint32_t rt_number9 = rt_number + 9;
+    EXPECT_EQ(rt_manager.enable_lookup(rt_number9), -1);  // not followed
+    rt_manager.follow_rt(rt_number9);
+    EXPECT_EQ(rt_manager.enable_lookup(rt_number9), 0);
+
+    int fd = nl_socket_handler::open_request_socket();
+    EXPECT_EQ(nl_socket_handler::request_add_route(fd, dst_ip, gw, 16, 0, iface->linux_interface_id, rt_number9), EXIT_SUCCESS);
+    EXPECT_EQ(nl_socket_handler::request_add_route(fd, htonl(ntohl(dst_ip) + 0x100), gw, 24, 0, iface->linux_interface_id, rt_number9), EXIT_SUCCESS);
+    close(fd);
+    EXPECT_GE(rt_manager.update_all(), 2);
+
+    const route_v4 *route = rt_manager.lookup(rt_number9, addr);
+    ASSERT_NE(route, nullptr);
+    EXPECT_EQ(route->mask_len, 24);
+    in_addr_t addrs[]          = {addr, htonl(ntohl(addr) + 0x100), htonl(ntohl(dst_ip) + 0x10000)};
+    const route_v4 *results[3] = {};
+    EXPECT_EQ(rt_manager.lookup(rt_number9, addrs, 3, results), 0);
+    EXPECT_EQ(results[0], route);
+    ASSERT_NE(results[1], nullptr);
+    EXPECT_EQ(results[1]->mask_len, 16);
+    EXPECT_EQ(results[2], nullptr);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+    EXPECT_GE(rt_manager.update_all(), 0);
+    EXPECT_EQ(rt_manager.lookup(rt_number9, addr), nullptr);
+}
+
+static nl_socket_handler::nl_task<int> coro_add_route (nl_socket_handler::nl_coro_context &context, in_addr_t dst_ip, in_addr_t gw, uint32_t oif_id, uint32_t rtm_table)
+{
+    co_return co_await context.add_route(dst_ip, gw, 24, 0, oif_id, rtm_table);
+}
+
+static nl_socket_handler::nl_task<size_t> coro_dump_and_delete (nl_socket_handler::nl_coro_context &context, in_addr_t dst_ip, size_t count, uint32_t rtm_table)
+{
+    linux_routing_table table(rtm_table);
+    if ( co_await context.dump_routes(rtm_table, table) != 0 ) {
+        co_return 0;
+    }
+    for ( size_t i = 0; i < count; i++ ) {
+        if ( co_await context.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rtm_table) != 0 ) {
+            co_return 0;
+        }
+    }
+    co_return table.size();
+}
+
+TEST_F(Netlink_test, drain_notifications)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.90.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    const uint32_t rt_number10 = rt_number + 10;
+
+    iface->set_iface_state(true); // UP the interface
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number10, vrf_name);
+    std::vector<linux_route> routes;
+    rt_manager.catch_route_update_notifications(routes);  // events of the previous tests
+    routes.clear();
+
+    const size_t SSIZE = 100;  // several recvmmsg batches of datagrams, fits the default receive buffer
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number10);
+    }
+    int fd = nl_socket_handler::open_request_socket();
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    close(fd);
+
+    // the legacy call takes one route and keeps the rest of the drained ones
+    linux_route first;
+    ASSERT_TRUE(rt_manager.catch_route_update_notification(first));
+    routes.push_back(first);
+
+    EXPECT_GE(rt_manager.catch_route_update_notifications(routes), SSIZE - 1);  // the kernel may add routes of the interface
+    size_t added = std::count_if(routes.begin(), routes.end(), [rt_number10] (const linux_route &route) {
+        return route.rt_number == rt_number10 and route.status == linux_route::NEW;
+    });
+    EXPECT_EQ(added, SSIZE);
+    EXPECT_EQ(rt_manager.overruns(), 0);
+
+    for ( const linux_route &route : routes ) {
+        rt_manager.update(route);
+    }
+    EXPECT_EQ(rt_manager.get(rt_number10)->size(), SSIZE);
+
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number10);
+    }
+    fd = nl_socket_handler::open_request_socket();
+    batch.flush(fd);
+    close(fd);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE);
+    EXPECT_EQ(rt_manager.get(rt_number10)->size(), 0);
+    EXPECT_FALSE(rt_manager.catch_route_update_notification(first));
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+}
+
+TEST_F(Netlink_test, overrun_resync)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.100.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    const uint32_t rt_number11 = rt_number + 11;
+
+    iface->set_iface_state(true); // UP the interface
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number11, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+    EXPECT_GE(nl_socket_handler::set_rcvbuf(rt_manager.get_nl_fd()), NL_NOTIFY_RCVBUF);
+    EXPECT_GT(nl_socket_handler::set_rcvbuf(rt_manager.get_nl_fd(), 4096), 0);  // overrun on purpose
+
+    // a route the kernel doesn't have: the resync has to sweep it
+    linux_route stale;
+    ((sockaddr_in *)&stale.dest)->sin_addr.s_addr = htonl(ntohl(dst_ip) + (0xff << 8));
+    stale.dest.ss_family                          = AF_INET;
+    stale.mask_len                                = 24;
+    stale.rt_number                               = rt_number11;
+    stale.iface_id                                = iface->linux_interface_id;
+    stale.status                                  = linux_route::NEW;
+    EXPECT_EQ(rt_manager.update(stale), 0);
+
+    const size_t SSIZE = 200;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw, 24, 0, iface->linux_interface_id, rt_number11);
+    }
+    int fd = nl_socket_handler::open_request_socket();
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    close(fd);
+
+    size_t overruns = rt_manager.overruns();
+    size_t resyncs  = rt_manager.resyncs();
+    EXPECT_GT(rt_manager.apply_route_update_notifications(), 0);
+    EXPECT_GT(rt_manager.overruns(), overruns);
+    EXPECT_EQ(rt_manager.resyncs(), resyncs + 1);
+    EXPECT_FALSE(rt_manager.resync_needed());
+    EXPECT_EQ(rt_manager.get(rt_number11)->size(), SSIZE);
+    EXPECT_FALSE(rt_manager.find(stale).first);
+
+    EXPECT_EQ(rt_manager.resync(), 0);  // nothing to change
+    EXPECT_GE(nl_socket_handler::set_rcvbuf(rt_manager.get_nl_fd()), NL_NOTIFY_RCVBUF);
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+    EXPECT_EQ(rt_manager.resync(), SSIZE);
+    EXPECT_EQ(rt_manager.get(rt_number11)->size(), 0);
+}
+
+TEST_F(Netlink_test, notification_hub)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    nl_hub &hub = nl_hub::get_instance();
+    std::set<int> fds = {iface->nl_socket};
+    std::vector<std::unique_ptr<system_iface>> ifaces;
+    for ( size_t i = 0; i < 3 * NL_HUB_REQUEST_SOCKETS; i++ ) {
+        ifaces.push_back(std::make_unique<system_iface>("lo", NONE));
+        fds.insert(ifaces.back()->nl_socket);
+    }
+    EXPECT_EQ(fds.size(), NL_HUB_REQUEST_SOCKETS);  // the fd count doesn't grow with the interfaces
+    ifaces.clear();
+    hub.poll();
+
+    size_t own = 0, other = 0, any = 0;
+    nl_event_handlers handlers;
+    handlers.on_link = [&own] (const link_event &) { ++own; };
+    uint64_t own_id = hub.subscribe(iface->linux_interface_id, handlers);
+    handlers.on_link = [&other] (const link_event &) { ++other; };
+    uint64_t other_id = hub.subscribe(if_nametoindex("lo"), handlers);
+    handlers.on_link = [&any] (const link_event &) { ++any; };
+    uint64_t any_id = hub.subscribe(NO_SYSTEM_ID, handlers);
+
+    iface->set_iface_state(true); // UP the interface
+    EXPECT_GT(hub.poll(), 0);
+    EXPECT_GT(own, 0);
+    EXPECT_EQ(other, 0);
+    EXPECT_EQ(any, own);
+    EXPECT_TRUE(hub.unsubscribe(own_id));
+    EXPECT_FALSE(hub.unsubscribe(own_id));
+    hub.unsubscribe(other_id);
+    hub.unsubscribe(any_id);
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.110.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    EXPECT_EQ(nl_socket_handler::request_add_route(iface->nl_socket, dst_ip, gw, 24, 0, iface->linux_interface_id, rt_number + 12), 0);
+    linux_route route;
+    EXPECT_TRUE(iface->update_routes(route));
+    EXPECT_EQ(route.rt_number, rt_number + 12);
+    EXPECT_EQ(route.status, linux_route::NEW);
+    EXPECT_FALSE(iface->update_routes(route));
+
+    iface->set_iface_state(false);  // DOWN the interface -> clear the table
+    hub.poll();
+}
+
+TEST_F(Netlink_test, large_ifindex)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    const uint32_t ifindex = 70000, peer_index = 70001;  // above 65535
+    int fd = nl_socket_handler::open_request_socket();
+    nl_socket_handler::request_del_vrf(fd, ifindex);  // left by a failed run
+
+    // a veth pair: the ifindex of a link can be chosen only when it's created
+    nl_socket_handler::nl_msg_builder &msg = nl_socket_handler::local_msg_builder();
+    uint32_t seq_num = ++nl_socket_handler::a_seq_num;
+    msg.begin_msg(RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL, seq_num);
+    msg.put_header<ifinfomsg>()->ifi_index = ifindex;
+    msg.add_str(IFLA_IFNAME, "test_big_idx");
+    size_t linkinfo = msg.nest_begin(IFLA_LINKINFO);
+    msg.add_attr(IFLA_INFO_KIND, "veth", 4);
+    size_t info_data = msg.nest_begin(IFLA_INFO_DATA);
+    size_t peer      = msg.nest_begin(VETH_INFO_PEER);
+    msg.put_header<ifinfomsg>()->ifi_index = peer_index;
+    msg.add_str(IFLA_IFNAME, "test_big_peer");
+    msg.nest_end(peer);
+    msg.nest_end(info_data);
+    msg.nest_end(linkinfo);
+    msg.end_msg();
+    ASSERT_NE(nl_socket_handler::send_msg(fd, msg), -1);
+    int rc = nl_socket_handler::recv_response(fd, seq_num);
+    if ( rc == EOPNOTSUPP ) {
+        close(fd);
+        GTEST_SKIP() << "no veth in the kernel";
+    }
+    ASSERT_EQ(rc, 0);
+    for ( uint32_t index : {ifindex, peer_index} ) {
+        nl_socket_handler::request_updown(fd, index, true);
+        EXPECT_EQ(nl_socket_handler::recv_response(fd, nl_socket_handler::a_seq_num), 0);
+    }
+
+    nl_hub &hub = nl_hub::get_instance();
+    hub.poll();
+    size_t own = 0, alias = 0;
+    nl_event_handlers handlers;
+    handlers.on_route = [&own] (const linux_route &route) { own += route.iface_id == ifindex; };
+    uint64_t own_id   = hub.subscribe(ifindex, handlers);
+    handlers.on_route = [&alias] (const linux_route &) { ++alias; };
+    uint64_t alias_id = hub.subscribe(ifindex & 0xffff, handlers);  // what a 16-bit oif would be
+
+    const uint32_t rt_number16 = rt_number + 16;
+    auto &rt_manager           = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number16, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+
+    in_addr_t dst_ip = 0;
+    inet_pton(AF_INET, "10.160.0.0", &dst_ip);
+    ASSERT_EQ(nl_socket_handler::request_add_route(fd, dst_ip, 0, 24, 0, ifindex, rt_number16), 0);
+    EXPECT_GT(hub.poll(), 0);
+    EXPECT_EQ(own, 1);
+    EXPECT_EQ(alias, 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    ASSERT_EQ(rt_manager.get(rt_number16)->size(), 1);
+    EXPECT_EQ(rt_manager.get(rt_number16)->front().iface_id, ifindex);
+
+    hub.unsubscribe(own_id);
+    hub.unsubscribe(alias_id);
+    EXPECT_EQ(nl_socket_handler::request_del_route(fd, dst_ip, 24, 0, rt_number16), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    EXPECT_EQ(nl_socket_handler::request_del_vrf(fd, ifindex), 0);  // the peer goes too
+    hub.poll();
+    close(fd);
+}
+
+TEST_F(Netlink_test, link_cache)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    link_cache &links = link_cache::get_instance();
+    EXPECT_EQ(links.ifindex("lo"), if_nametoindex("lo"));
+    EXPECT_EQ(links.name(if_nametoindex("lo")), "lo");
+    EXPECT_EQ(links.ifindex(name), iface->linux_interface_id);
+    EXPECT_EQ(links.ifindex("no_such_iface"), NO_SYSTEM_ID);
+    EXPECT_EQ(links.find(NO_SYSTEM_ID), nullptr);
+    size_t dumps = links.dumps();
+
+    // kept current by the events, not by dumps. A lookup doesn't read the hub socket
+    iface->set_iface_state(true); // UP the interface
+    ASSERT_NE(links.find(name), nullptr);
+    EXPECT_FALSE(links.find(name)->flags & IFF_UP);
+    links.sync();
+    EXPECT_TRUE(links.find(name)->flags & IFF_UP);
+    iface->set_iface_state(false);
+    links.sync();
+    EXPECT_FALSE(links.find(iface->linux_interface_id)->flags & IFF_UP);
+
+    uint32_t ifindex = 0;
+    {
+        system_iface other("test_cache", NONE, false, false);
+        links.sync();
+        ifindex = links.ifindex("test_cache");
+        EXPECT_GT(ifindex, 0);
+        EXPECT_EQ(other.search_iface(), ifindex);
+    }
+    links.sync();
+    EXPECT_EQ(links.ifindex("test_cache"), NO_SYSTEM_ID);
+    EXPECT_EQ(links.find(ifindex), nullptr);
+    EXPECT_EQ(links.dumps(), dumps);
+
+    EXPECT_EQ(links.refill(), 0);
+    EXPECT_EQ(links.dumps(), dumps + 1);
+    EXPECT_EQ(links.ifindex(name), iface->linux_interface_id);
+}
+
+TEST_F(Netlink_test, vrf_registry)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    vrf_registry &vrfs = vrf_registry::get_instance();
+    size_t count       = vrfs.size();  // filled from the link cache
+    EXPECT_EQ(vrfs.find_by_index(if_nametoindex("lo")), nullptr);
+
+    std::vector<std::pair<std::string, bool>> changes;
+    uint64_t listener = vrfs.listen([&changes] (const vrf_entry &vrf, const bool removed) { changes.emplace_back(vrf.name, removed); });
+
+    // the kernel here may have no VRF support: feed the link events of a VRF
+    link_event event;
+    event.ifindex   = 900001;
+    event.flags     = IFF_UP;
+    event.vrf_table = 5000;
+    strcpy(event.name, "vrf_registry");
+    strcpy(event.kind, "vrf");
+    vrfs.apply(event);
+    ASSERT_NE(vrfs.find("vrf_registry"), nullptr);
+    EXPECT_EQ(vrfs.rt_number("vrf_registry"), 5000);
+    EXPECT_EQ(vrfs.find_by_table(5000)->ifindex, 900001);
+    EXPECT_TRUE(vrfs.find_by_index(900001)->up);
+    EXPECT_EQ(vrfs.size(), count + 1);
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    EXPECT_GE(rt_manager.follow_vrfs(), 0);
+    EXPECT_TRUE(rt_manager.rt_number_is_followed(5000));
+    EXPECT_EQ(rt_manager.get_name(5000), "vrf_registry");
+
+    event.flags = 0;  // no change of the identity
+    vrfs.apply(event);
+    EXPECT_FALSE(vrfs.find("vrf_registry")->up);
+    strcpy(event.name, "vrf_renamed");
+    vrfs.apply(event);
+    EXPECT_EQ(vrfs.find("vrf_registry"), nullptr);
+    EXPECT_EQ(vrfs.rt_number("vrf_renamed"), 5000);
+    EXPECT_EQ(rt_manager.get_name(5000), "vrf_renamed");
+
+    // a route notified before the link event of its VRF: the new table is dumped
+    int fd = nl_socket_handler::open_request_socket();
+    in_addr_t dst_ip = 0;
+    inet_pton(AF_INET, "10.170.0.0", &dst_ip);
+    ASSERT_EQ(nl_socket_handler::request_add_route(fd, dst_ip, 0, 24, 0, if_nametoindex("lo"), 5001), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 0);  // not followed yet
+
+    event.vrf_table = 5001;  // new table: the old one is dropped
+    vrfs.apply(event);
+    EXPECT_FALSE(rt_manager.rt_number_is_followed(5000));
+    EXPECT_TRUE(rt_manager.rt_number_is_followed(5001));
+    ASSERT_NE(rt_manager.get(5001), nullptr);
+    EXPECT_EQ(rt_manager.get(5001)->size(), 1);
+
+    EXPECT_EQ(nl_socket_handler::request_del_route(fd, dst_ip, 24, 0, 5001), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    close(fd);
+
+    event.deleted = true;
+    vrfs.apply(event);
+    EXPECT_EQ(vrfs.find_by_table(5001), nullptr);
+    EXPECT_FALSE(rt_manager.rt_number_is_followed(5001));
+    EXPECT_EQ(vrfs.size(), count);
+
+    std::vector<std::pair<std::string, bool>> expected = {
+        {"vrf_registry", false}, {"vrf_registry", true}, {"vrf_renamed", false}, {"vrf_renamed", true}, {"vrf_renamed", false}, {"vrf_renamed", true}};
+    EXPECT_EQ(changes, expected);
+    EXPECT_TRUE(vrfs.unlisten(listener));
+    rt_manager.unfollow_vrfs();
+}
+
+TEST_F(Netlink_test, neigh_mirror)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    linux_neigh_manager &neighs = linux_neigh_manager::get_instance();
+    EXPECT_GE(neighs.update_all(), 0);
+
+    // the mirror follows the events
+    neigh_event event;
+    event.ifindex = 900002;
+    event.family  = AF_INET;
+    event.state   = NUD_REACHABLE;
+    inet_pton(AF_INET, "10.110.0.1", event.addr);
+    memcpy(event.lladdr, "\x02\x00\x00\x00\x00\x01", 6);
+    event.has_lladdr = true;
+    EXPECT_EQ(neighs.update(event), 0);
+    EXPECT_EQ(neighs.update(event), -1);  // no change
+    in_addr_t addr = 0;
+    inet_pton(AF_INET, "10.110.0.1", &addr);
+    ASSERT_NE(neighs.find(900002, addr), nullptr);
+    EXPECT_TRUE(neighs.resolved(900002, addr));
+    event.state = NUD_FAILED;
+    EXPECT_EQ(neighs.update(event), 0);
+    EXPECT_FALSE(neighs.resolved(900002, addr));
+    event.deleted = true;
+    EXPECT_EQ(neighs.update(event), 0);
+    EXPECT_EQ(neighs.find(900002, addr), nullptr);
+    event.deleted = false;
+    event.family  = AF_BRIDGE;  // FDB entries aren't neighbours
+    EXPECT_EQ(neighs.update(event), -1);
+
+    // and the kernel: a TAP has an ethernet lladdr, the TUN one has none
+    system_iface tap("test_neigh", NONE, false, true);
+    tap.search_iface();
+    tap.set_ip_addr("100.100.101.1", mask);
+    tap.set_iface_state(true);
+    neighs.apply_notifications();
+    const char lladdr[6] = {0x02, 0x00, 0x00, 0x00, 0x01, 0x10};
+    inet_pton(AF_INET, "100.100.101.110", &addr);
+    ASSERT_EQ(nl_socket_handler::request_add_neighbor(tap.nl_socket, addr, lladdr, tap.linux_interface_id), 0);
+    EXPECT_GT(neighs.apply_notifications(), 0);
+    const neigh_event *neigh = neighs.find(tap.linux_interface_id, addr);
+    ASSERT_NE(neigh, nullptr);
+    EXPECT_TRUE(neigh->has_lladdr);
+    EXPECT_EQ(memcmp(neigh->lladdr, lladdr, 6), 0);
+
+    size_t resyncs = neighs.resyncs();
+    EXPECT_GT(neighs.update_all(), 0);  // the dump agrees with the events
+    EXPECT_EQ(neighs.resyncs(), resyncs + 1);
+    EXPECT_NE(neighs.find(tap.linux_interface_id, addr), nullptr);
+
+    EXPECT_EQ(nl_socket_handler::request_delete_neighbor(tap.nl_socket, addr, tap.linux_interface_id), 0);
+    EXPECT_GT(neighs.apply_notifications(), 0);
+    EXPECT_EQ(neighs.find(tap.linux_interface_id, addr), nullptr);
+}
+
+TEST_F(Netlink_test, neigh_batch)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    system_iface tap("test_nbatch", NONE, false, true);
+    tap.search_iface();
+    tap.set_ip_addr("100.100.102.1", "255.255.0.0");
+    tap.set_iface_state(true);
+    uint32_t oif_id = tap.linux_interface_id;
+
+    auto host = [] (size_t i) { return htonl(0x64660000u + 2 + (uint32_t)i); };  // 100.102.0.2 ...
+    const char lladdr[6] = {0x02, 0x00, 0x00, 0x00, 0x02, 0x10};
+    const size_t SSIZE   = 300;
+
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; ++i ) {
+        batch.add_neighbor(host(i), lladdr, oif_id, i % 3 ? NUD_PERMANENT : NUD_STALE);
+    }
+    size_t bad = batch.add_neighbor(host(0), lladdr, 900003);  // no such interface
+    std::vector<int> results = batch.flush(tap.nl_socket);
+    ASSERT_EQ(results.size(), SSIZE + 1);
+    EXPECT_EQ(std::count(results.begin(), results.end(), 0), SSIZE);
+    EXPECT_NE(results[bad], 0);
+
+    auto count_neighs = [&tap, oif_id] (uint16_t states) {
+        size_t count = 0;
+        nl_socket_handler::request_get_neigh_list(tap.nl_socket, [&count, oif_id, states] (nlmsghdr *nlh) {
+            neigh_event neigh;
+            count += neigh_event::parse(nlh, neigh) and neigh.ifindex == oif_id and (neigh.state & states);
+        }, AF_INET, oif_id);
+        return count;
+    };
+    EXPECT_EQ(count_neighs(NUD_PERMANENT), SSIZE - SSIZE / 3);
+
+    // a refresh replaces the state of the entities
+    for ( size_t i = 0; i < SSIZE; i += 3 ) {
+        batch.add_neighbor(host(i), lladdr, oif_id, NUD_STALE);
+    }
+    results = batch.flush(tap.nl_socket);
+    EXPECT_EQ(std::count(results.begin(), results.end(), 0), SSIZE / 3);
+    EXPECT_EQ(count_neighs(NUD_STALE), SSIZE / 3);
+
+    size_t flushed = 0;
+    EXPECT_EQ(nl_socket_handler::request_flush_neighbors(tap.nl_socket, NUD_STALE | NUD_FAILED, oif_id, &flushed), 0);
+    EXPECT_EQ(flushed, SSIZE / 3);
+    EXPECT_EQ(count_neighs(NUD_STALE), 0);
+    EXPECT_EQ(count_neighs(NUD_PERMANENT), SSIZE - SSIZE / 3);
+
+    EXPECT_EQ(nl_socket_handler::request_flush_neighbors(tap.nl_socket, NUD_PERMANENT, oif_id, &flushed), 0);
+    EXPECT_EQ(flushed, SSIZE - SSIZE / 3);
+    EXPECT_EQ(count_neighs(0xffff), 0);
+}
+
+TEST_F(Netlink_test, nexthop_objects)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw1    = 0;
+    in_addr_t gw2    = 0;
+    inet_pton(AF_INET, "10.120.0.0", &dst_ip);
+    inet_pton(AF_INET, "127.0.0.2", &gw1);
+    inet_pton(AF_INET, "127.0.0.3", &gw2);
+    const uint32_t rt_number12 = rt_number + 12;
+    const uint32_t nh1 = 900100, nh2 = 900101, group = 900102;
+    const uint32_t lo  = if_nametoindex("lo");
+
+    int fd = nl_socket_handler::open_request_socket();
+    for ( uint32_t id : {group, nh1, nh2} ) {
+        nl_socket_handler::request_del_nexthop(fd, id);  // left by a failed run
+    }
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number12, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+
+    ASSERT_EQ(nl_socket_handler::request_add_nexthop(fd, nh1, gw1, lo), 0);
+    ASSERT_EQ(nl_socket_handler::request_add_nexthop(fd, nh2, gw2, lo), 0);
+    EXPECT_EQ(nl_socket_handler::request_add_nexthop(fd, nh2, gw2, lo), EEXIST);
+    ASSERT_EQ(nl_socket_handler::request_add_nexthop_group(fd, group, {{.id = nh1, .weight = 0, .resvd1 = 0, .resvd2 = 0}}), 0);
+
+    const size_t SSIZE = 100;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route_nh(htonl(ntohl(dst_ip) + (i << 8)), 24, group, 0, rt_number12);
+    }
+    batch.add_route_nh(htonl(ntohl(dst_ip) + (SSIZE << 8)), 24, nh1, 0, rt_number12);  // on the member itself
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE + 1);
+    ASSERT_EQ(rt_manager.get(rt_number12)->size(), SSIZE + 1);
+    linux_route route = rt_manager.get(rt_number12)->front();
+    EXPECT_EQ(route.nh_id, group);
+    EXPECT_EQ(route.gw.ss_family, 0);  // the gateway is the nexthop's one
+    EXPECT_TRUE(rt_manager.find(route).first);
+    ASSERT_NE(rt_manager.find_nexthop(group), nullptr);
+    EXPECT_TRUE(rt_manager.find_nexthop(group)->is_group());
+    EXPECT_EQ(rt_manager.find_nexthop(group)->group[0].id, nh1);
+    EXPECT_EQ(memcmp(rt_manager.find_nexthop(nh1)->gw, &gw1, sizeof(gw1)), 0);
+    EXPECT_EQ(rt_manager.find_nexthop(nh1)->oif, lo);
+
+    // one replace moves every route of the group, no route changes
+    uint64_t version = rt_manager.version(rt_number12);
+    ASSERT_EQ(nl_socket_handler::request_add_nexthop_group(fd, group, {{.id = nh2, .weight = 0, .resvd1 = 0, .resvd2 = 0}}, true), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 0);
+    EXPECT_EQ(rt_manager.version(rt_number12), version);
+    EXPECT_EQ(rt_manager.find_nexthop(group)->group[0].id, nh2);
+
+    // the kernel deletes the routes of a deleted nexthop without events
+    EXPECT_EQ(nl_socket_handler::request_del_nexthop(fd, nh1), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    EXPECT_EQ(rt_manager.find_nexthop(nh1), nullptr);
+    EXPECT_EQ(nl_socket_handler::request_del_nexthop(fd, nh2), 0);  // the group is empty and deleted too
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE);
+    EXPECT_EQ(rt_manager.get(rt_number12)->size(), 0);
+    EXPECT_EQ(rt_manager.find_nexthop(group), nullptr);
+
+    EXPECT_GE(rt_manager.update_nexthops(), 0);
+    EXPECT_EQ(rt_manager.find_nexthop(nh2), nullptr);
+    close(fd);
+}
+
+TEST_F(Netlink_test, ecmp_multipath)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    inet_pton(AF_INET, "10.130.0.0", &dst_ip);
+    const uint32_t rt_number13 = rt_number + 13;
+    const uint32_t lo          = if_nametoindex("lo");
+
+    std::vector<route_hop> hops(2);
+    for ( size_t i = 0; i < hops.size(); i++ ) {
+        inet_pton(AF_INET, i ? "127.0.0.3" : "127.0.0.2", hops[i].gw);
+        hops[i].family   = AF_INET;
+        hops[i].iface_id = lo;
+        hops[i].weight   = 2 - i;
+    }
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number13, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+    size_t lists = route_multipath::get_instance().size();
+
+    const size_t SSIZE = 50;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route_multipath(htonl(ntohl(dst_ip) + (i << 8)), 24, hops, 0, rt_number13);
+    }
+    int fd = nl_socket_handler::open_request_socket();
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE);
+    ASSERT_EQ(rt_manager.get(rt_number13)->size(), SSIZE);
+
+    linux_route route = rt_manager.get(rt_number13)->front();
+    EXPECT_NE(route.mp_id, 0);
+    EXPECT_EQ(route.gw.ss_family, 0);
+    ASSERT_EQ(route.hops().size(), hops.size());
+    EXPECT_TRUE(std::equal(hops.begin(), hops.end(), route.hops().begin()));
+    for ( const linux_route &other : *rt_manager.get(rt_number13) ) {
+        EXPECT_EQ(other.mp_id, route.mp_id);  // one list for all the routes with the same paths
+    }
+    EXPECT_EQ(route_multipath::get_instance().size(), lists + 1);
+
+    // other paths: another route
+    linux_route other = route;
+    std::vector<route_hop> reversed(hops.rbegin(), hops.rend());
+    other.mp_id = route_multipath::get_instance().intern(reversed);
+    EXPECT_NE(other.mp_id, route.mp_id);
+    EXPECT_NE(other, route);
+    EXPECT_FALSE(rt_manager.find(other).first);
+    EXPECT_EQ(linux_route(route.to_v4()), route);
+    EXPECT_EQ(route_multipath::get_instance().size(), lists + 2);
+    route_multipath::get_instance().discard(other.mp_id);  // no table has stored it
+    EXPECT_EQ(route_multipath::get_instance().size(), lists + 1);
+
+    // the ECMP route is found by its deletion event
+    ASSERT_EQ(nl_socket_handler::request_del_route(fd, dst_ip, 24, 0, rt_number13), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    EXPECT_FALSE(rt_manager.find(route).first);
+    EXPECT_EQ(nl_socket_handler::request_add_route_multipath(fd, dst_ip, 24, {}, 0, rt_number13), -EINVAL);
+
+    for ( size_t i = 1; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number13);
+    }
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE - 1);
+    EXPECT_EQ(rt_manager.get(rt_number13)->size(), 0);
+    EXPECT_EQ(route_multipath::get_instance().size(), lists);  // dropped with its last route
+    close(fd);
+}
+
+TEST_F(Netlink_test, ipv6_programming)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in6_addr local = {}, gw = {}, dst = {}, host = {}, neigh_addr = {};
+    inet_pton(AF_INET6, "2001:db8:1::1", &local);
+    inet_pton(AF_INET6, "2001:db8:1::2", &gw);
+    inet_pton(AF_INET6, "2001:db8:100::", &dst);
+    inet_pton(AF_INET6, "2001:db8:200::5", &host);
+    inet_pton(AF_INET6, "2001:db8:1::10", &neigh_addr);
+    const uint32_t rt_number14 = rt_number + 14;
+    const uint32_t lo          = if_nametoindex("lo");
+
+    system_iface tap("test_ip6", NONE, false, true);
+    tap.search_iface();
+    tap.set_iface_state(true);
+    const uint32_t oif_id = tap.linux_interface_id;
+    int fd                = tap.nl_socket;
+
+    EXPECT_EQ(nl_socket_handler::request_add_ip_addr(fd, local, 129, oif_id), -EINVAL);
+    ASSERT_EQ(nl_socket_handler::request_add_ip_addr(fd, local, 64, oif_id, true), 0);
+    EXPECT_EQ(nl_socket_handler::request_add_ip_addr(fd, local, 64, oif_id, true), EEXIST);
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number14, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+
+    EXPECT_EQ(nl_socket_handler::request_add_route(fd, host, in6addr_any, 64, 0, lo, rt_number14), -EINVAL);  // host bits
+    EXPECT_EQ(nl_socket_handler::check_route_args(dst, 129), -EINVAL);
+
+    const size_t SSIZE = 100;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        in6_addr prefix = dst;
+        prefix.s6_addr[6] = i;  // 2001:db8:100::/64, 2001:db8:100:100::/64 ...
+        batch.add_route(prefix, gw, 64, 0, oif_id, rt_number14);
+    }
+    batch.add_route(in6addr_any, in6addr_any, 0, 0, lo, rt_number14);  // ::/0
+    batch.add_route(host, in6addr_any, 128, 0, lo, rt_number14);
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE + 2);
+    auto count_v6 = [&rt_manager, rt_number14] () {
+        const auto *routes = rt_manager.get(rt_number14);
+        return std::count_if(routes->begin(), routes->end(), [] (const linux_route &route) { return route.is_v6(); });
+    };
+    ASSERT_EQ(rt_manager.get(rt_number14)->size(), SSIZE + 2);
+    EXPECT_EQ(count_v6(), SSIZE + 2);  // ::/0 isn't 0.0.0.0/0
+    EXPECT_GE(rt_manager.update_all(), 0);  // the dump has the IPv6 routes too
+    EXPECT_EQ(count_v6(), SSIZE + 2);
+
+    ASSERT_EQ(rt_manager.enable_lookup(rt_number14), 0);
+    ASSERT_NE(rt_manager.lookup(rt_number14, host), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number14, host)->mask_len, 128);
+    ASSERT_NE(rt_manager.lookup(rt_number14, local), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number14, local)->mask_len, 0);
+    ASSERT_NE(rt_manager.lookup(rt_number14, dst), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number14, dst)->iface_id, oif_id);
+
+    EXPECT_EQ(nl_socket_handler::request_add_route(fd, host, in6addr_any, 128, 0, lo, rt_number14), EEXIST);
+
+    // ND neighbours
+    linux_neigh_manager &neighs = linux_neigh_manager::get_instance();
+    neighs.apply_notifications();
+    const char lladdr[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x10};
+    ASSERT_EQ(nl_socket_handler::request_add_neighbor(fd, neigh_addr, lladdr, oif_id), 0);
+    EXPECT_GT(neighs.apply_notifications(), 0);
+    const neigh_event *neigh = neighs.find(oif_id, neigh_addr);
+    ASSERT_NE(neigh, nullptr);
+    EXPECT_EQ(neigh->family, AF_INET6);
+    EXPECT_EQ(memcmp(neigh->lladdr, lladdr, sizeof(lladdr)), 0);
+    batch.add_neighbor(neigh_addr, lladdr, oif_id, NUD_PERMANENT);
+    EXPECT_EQ(batch.flush(fd)[0], 0);
+    neighs.apply_notifications();
+    EXPECT_EQ(neighs.find(oif_id, neigh_addr)->state, NUD_PERMANENT);
+    EXPECT_EQ(nl_socket_handler::request_delete_neighbor(fd, neigh_addr, oif_id), 0);
+    EXPECT_GT(neighs.apply_notifications(), 0);
+    EXPECT_EQ(neighs.find(oif_id, neigh_addr), nullptr);
+
+    for ( size_t i = 1; i < SSIZE; i++ ) {
+        in6_addr prefix = dst;
+        prefix.s6_addr[6] = i;
+        batch.del_route(prefix, 64, 0, rt_number14);
+    }
+    batch.del_route(in6addr_any, 0, 0, rt_number14);
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(nl_socket_handler::request_del_route(fd, dst, 64, 0, rt_number14), 0);
+    EXPECT_EQ(nl_socket_handler::request_del_route(fd, host, 128, 0, rt_number14), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE + 2);
+    EXPECT_EQ(rt_manager.get(rt_number14)->size(), 0);
+    EXPECT_EQ(nl_socket_handler::request_del_ip_addr(fd, local, 64, oif_id), 0);
+}
+
+TEST_F(Netlink_test, route_replace)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw1    = 0;
+    in_addr_t gw2    = 0;
+    inet_pton(AF_INET, "10.150.0.0", &dst_ip);
+    inet_pton(AF_INET, "127.0.0.2", &gw1);
+    inet_pton(AF_INET, "127.0.0.3", &gw2);
+    const uint32_t rt_number15 = rt_number + 15;
+    const uint32_t lo          = if_nametoindex("lo");
+    const uint32_t metric      = 10;
+
+    auto &rt_manager = linux_rt_manager::get_instance();
+    rt_manager.follow_rt(rt_number15, vrf_name);
+    rt_manager.apply_route_update_notifications();  // events of the previous tests
+    ASSERT_EQ(rt_manager.enable_lookup(rt_number15), 0);
+
+    const size_t SSIZE = 50;
+    nl_socket_handler::nl_batch batch;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.add_route(htonl(ntohl(dst_ip) + (i << 8)), gw1, 24, metric, lo, rt_number15);
+    }
+    int fd = nl_socket_handler::open_request_socket();
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE);
+    linux_route old_route = rt_manager.get(rt_number15)->front();
+
+    // one change of the table; the journal deletes the old gateway by its identity
+    uint64_t cursor = rt_manager.version(rt_number15);
+    ASSERT_EQ(nl_socket_handler::request_replace_route(fd, dst_ip, gw2, 24, metric, lo, rt_number15), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), SSIZE);
+    std::vector<route_delta> deltas;
+    ASSERT_EQ(rt_manager.changes_since(rt_number15, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 2);
+    EXPECT_EQ(deltas[0].op, route_delta::DELETE);
+    EXPECT_EQ(deltas[0].v4.gw, gw1);
+    EXPECT_EQ(deltas[1].op, route_delta::ADD);
+    EXPECT_EQ(deltas[1].v4.gw, gw2);
+    EXPECT_FALSE(rt_manager.find(old_route).first);
+    ASSERT_NE(rt_manager.lookup(rt_number15, dst_ip), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number15, dst_ip)->gw, gw2);
+
+    // batched
+    for ( size_t i = 1; i < SSIZE; i++ ) {
+        batch.replace_route(htonl(ntohl(dst_ip) + (i << 8)), gw2, 24, metric, lo, rt_number15);
+    }
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE - 1);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), SSIZE);
+    for ( const linux_route &route : *rt_manager.get(rt_number15) ) {
+        EXPECT_EQ(((sockaddr_in *)&route.gw)->sin_addr.s_addr, gw2);
+    }
+
+    // the metric is a part of the key: make-before-break
+    ASSERT_EQ(nl_socket_handler::request_change_route(fd, dst_ip, 24, metric, gw1, metric + 1, lo, rt_number15), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 2);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), SSIZE);
+    EXPECT_EQ(rt_manager.lookup(rt_number15, dst_ip)->priority, metric + 1);
+    EXPECT_EQ(rt_manager.lookup(rt_number15, dst_ip)->gw, gw1);
+
+    // the new route is refused: the old one stays
+    in_addr_t unreachable = 0;
+    inet_pton(AF_INET, "192.0.2.1", &unreachable);  // not on lo
+    EXPECT_GT(nl_socket_handler::request_change_route(fd, dst_ip, 24, metric + 1, unreachable, metric + 2, lo, rt_number15), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 0);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), SSIZE);
+    ASSERT_NE(rt_manager.lookup(rt_number15, dst_ip), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number15, dst_ip)->priority, metric + 1);
+    EXPECT_EQ(nl_socket_handler::request_replace_route(fd, dst_ip, gw1, 24, metric + 1, lo, rt_number15), 0);  // still in the kernel
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 0);
+
+    // IPv6: from dev lo to a gateway on a TAP
+    system_iface tap("test_repl6", NONE, false, true);
+    tap.search_iface();
+    tap.set_iface_state(true);
+    in6_addr local = {}, gw6 = {}, dst6 = {};
+    inet_pton(AF_INET6, "2001:db8:150::1", &local);
+    inet_pton(AF_INET6, "2001:db8:150::2", &gw6);
+    inet_pton(AF_INET6, "2001:db8:151::", &dst6);
+    ASSERT_EQ(nl_socket_handler::request_add_ip_addr(fd, local, 64, tap.linux_interface_id, true), 0);
+    ASSERT_EQ(nl_socket_handler::request_replace_route(fd, dst6, in6addr_any, 64, 0, lo, rt_number15), 0);  // an add
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    cursor = rt_manager.version(rt_number15);
+    ASSERT_EQ(nl_socket_handler::request_replace_route(fd, dst6, gw6, 64, 0, tap.linux_interface_id, rt_number15), 0);
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), 1);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), SSIZE + 1);
+    deltas.clear();
+    ASSERT_EQ(rt_manager.changes_since(rt_number15, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 2);
+    EXPECT_EQ(deltas[0].op, route_delta::DELETE);
+    EXPECT_EQ(deltas[0].v6.iface_id, lo);
+    EXPECT_EQ(deltas[1].op, route_delta::ADD);
+    EXPECT_EQ(memcmp(deltas[1].v6.gw, &gw6, sizeof(gw6)), 0);
+    ASSERT_NE(rt_manager.lookup(rt_number15, dst6), nullptr);
+    EXPECT_EQ(rt_manager.lookup(rt_number15, dst6)->iface_id, tap.linux_interface_id);
+
+    EXPECT_EQ(nl_socket_handler::request_del_route(fd, dst6, 64, 0, rt_number15), 0);
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        batch.del_route(htonl(ntohl(dst_ip) + (i << 8)), 24, 0, rt_number15);
+    }
+    for ( int rc : batch.flush(fd) ) {
+        EXPECT_EQ(rc, EXIT_SUCCESS);
+    }
+    EXPECT_EQ(rt_manager.apply_route_update_notifications(), SSIZE + 1);
+    EXPECT_EQ(rt_manager.get(rt_number15)->size(), 0);
+    close(fd);
+}
+
+TEST_F(Netlink_test, coroutines)
+{
+    // GTEST_SKIP() << "Skipping single test";
+
+    in_addr_t dst_ip = 0;
+    in_addr_t gw     = 0;
+    inet_pton(AF_INET, "10.50.0.0", &dst_ip);
+    inet_pton(AF_INET, ip.c_str(), &gw);
+    auto rt_number4 = rt_number + 4;
+
+    nl_reactor reactor;
+    ASSERT_TRUE(reactor.is_open());
+    int fd = nl_socket_handler::open_request_socket(SOCK_NONBLOCK);
+    ASSERT_GE(fd, 0);
+    nl_socket_handler::nl_coro_context context(reactor, fd);
+
+    auto run = [&reactor] (auto &&done) {
+        for ( int i = 0; i < 1000 and not done(); i++ ) {
+            reactor.run_once(10);
+        }
+    };
+
+    auto updown = [&context] (uint32_t id, bool up) -> nl_socket_handler::nl_task<int> { co_return co_await context.updown(id, up); };
+    auto up     = updown(iface->linux_interface_id, true);
+    up.start();
+    run([&up] { return up.done(); });
+    EXPECT_EQ(up.result(), EXIT_SUCCESS);
+
+    const size_t SSIZE = 200;  // more than the window
+    std::vector<nl_socket_handler::nl_task<int>> adds;
+    for ( size_t i = 0; i < SSIZE; i++ ) {
+        adds.push_back(coro_add_route(context, htonl(ntohl(dst_ip) + (i << 8)), gw, iface->linux_interface_id, rt_number4));
+        adds.back().start();
+    }
+    auto search = context.search_iface(name);
+    search.start();
+    EXPECT_EQ(context.add_route(dst_ip, gw, 0).await_resume(), -EINVAL);  // checked before sending
+
+    run([&] { return search.done() and std::all_of(adds.begin(), adds.end(), [] (auto &task) { return task.done(); }); });
+    for ( auto &task : adds ) {
+        EXPECT_EQ(task.result(), EXIT_SUCCESS);
+    }
+    EXPECT_EQ(search.result(), iface->linux_interface_id);
+
+    auto dump = coro_dump_and_delete(context, dst_ip, SSIZE, rt_number4);
+    dump.start();
+    run([&dump] { return dump.done(); });
+    EXPECT_EQ(dump.result(), SSIZE);
+    EXPECT_EQ(context.pending(), 0);
+
+    auto down = updown(iface->linux_interface_id, false);
+    down.start();
+    run([&down] { return down.done(); });
+    EXPECT_EQ(down.result(), EXIT_SUCCESS);
+    close(fd);
+}
+
 TEST_F(Netlink_test, test){
     GTEST_SKIP() << "Skipping single test";
 
@@ -301,4 +1573,448 @@ TEST_F(Netlink_test, flash)
 
     rc = nl_socket_handler::request_flush_stale(iface->nl_socket, 0);
     EXPECT_EQ(rc, 0);
-}
\ No newline at end of file
+}
+TEST(Msg_builder, nested_attr)
+{
+    char buf[BUF_SIZE];
+    nl_socket_handler::nl_msg_builder msg(buf);
+    nl_socket_handler::build_create_vrf(msg, 1, "vrf_test", 1111111);
+    EXPECT_FALSE(msg.overflow());
+    EXPECT_EQ(msg.msg()->nlmsg_len, msg.size());
+
+    char *data = nullptr;
+    int size   = nl_socket_handler::get_nl_sock_data(buf, msg.size(), RTM_NEWLINK, IFLA_LINKINFO, &data);
+    EXPECT_EQ(size, RTA_SPACE(3) + RTA_SPACE(RTA_SPACE(sizeof(uint32_t))));
+    EXPECT_EQ(*(uint32_t *)(data + size - sizeof(uint32_t)), 1111111);
+}
+
+TEST(Msg_builder, overflow)
+{
+    char buf[NLMSG_HDRLEN + sizeof(rtmsg)];
+    nl_socket_handler::nl_msg_builder msg(buf);
+    nl_socket_handler::build_add_route(msg, 1, 0, 0, 24, 0, 0, RT_TABLE_MAIN, RTPROT_STATIC);
+    EXPECT_TRUE(msg.overflow());
+    EXPECT_EQ(msg.end_msg(), 0);
+}
+
+static linux_route make_route (uint32_t index, uint32_t rt_number, linux_route::e_status status)
+{
+    linux_route route;
+    auto dest            = (sockaddr_in *)&route.dest;
+    dest->sin_addr.s_addr = htonl(0x0A000000u + (index << 8));
+    route.dest.ss_family = AF_INET;
+    route.mask_len       = 24;
+    route.rt_number      = rt_number;
+    route.iface_id       = 2;
+    route.status         = status;
+    return route;
+}
+
+TEST(Routing_table, hash_index)
+{
+    const uint32_t SSIZE = 1000;
+    linux_routing_table rt(100);
+    for ( uint32_t i = 0; i < SSIZE; i++ ) {
+        EXPECT_EQ(rt.update(make_route(i, 100, linux_route::NEW)), 0);
+    }
+    EXPECT_EQ(rt.update(make_route(5, 100, linux_route::NEW)), -1);  // already there
+    EXPECT_EQ(rt.size(), SSIZE);
+
+    auto found = rt.find(make_route(SSIZE - 1, 100, linux_route::NEW));
+    EXPECT_TRUE(found.first);
+    EXPECT_EQ(found.second, SSIZE - 1);
+    EXPECT_FALSE(rt.find(make_route(SSIZE, 100, linux_route::NEW)).first);
+    EXPECT_FALSE(rt.find(make_route(0, 101, linux_route::NEW)).first);  // another table
+
+    EXPECT_EQ(rt.update(make_route(10, 100, linux_route::DELETE)), 0);  // the last route takes its place
+    EXPECT_EQ(rt.update(make_route(10, 100, linux_route::DELETE)), -1);
+    EXPECT_EQ(rt.size(), SSIZE - 1);
+    found = rt.find(make_route(SSIZE - 1, 100, linux_route::NEW));
+    EXPECT_TRUE(found.first);
+    EXPECT_EQ(found.second, 10);
+    EXPECT_TRUE(rt.get()->at(found.second) == make_route(SSIZE - 1, 100, linux_route::NEW));
+
+    for ( uint32_t i = 0; i < SSIZE; i++ ) {
+        rt.update(make_route(i, 100, linux_route::DELETE));
+    }
+    EXPECT_EQ(rt.size(), 0);
+}
+
+TEST(Routing_table, packed_store)
+{
+    linux_route route6;
+    auto dest6 = (sockaddr_in6 *)&route6.dest;
+    inet_pton(AF_INET6, "2001:db8::", &dest6->sin6_addr);
+    route6.dest.ss_family = AF_INET6;
+    route6.mask_len       = 64;
+    route6.rt_number      = 100;
+    route6.priority       = 1024;  // doesn't fit into a byte
+    route6.status         = linux_route::NEW;
+    EXPECT_TRUE(linux_route(route6.to_v6()) == route6);
+
+    linux_route route4 = make_route(7, 100, linux_route::NEW);
+    EXPECT_TRUE(linux_route(route4.to_v4()) == route4);
+
+    linux_routing_table rt(100);
+    EXPECT_EQ(rt.update(route4), 0);
+    EXPECT_EQ(rt.update(route6), 0);
+    EXPECT_EQ(rt.routes_v4().size(), 1);
+    EXPECT_EQ(rt.routes_v6().size(), 1);
+    EXPECT_EQ(rt.find(route6).second, 1);  // IPv6 routes follow IPv4 ones into get()
+    EXPECT_TRUE(rt.get()->at(1) == route6);
+
+    // erase from the middle of probe chains, compare with a reference set
+    std::set<uint32_t> reference = {7};
+    for ( uint32_t i = 0; i < 5000; i++ ) {
+        uint32_t index = (i * 7919) % 2000;
+        bool add       = (i % 3) != 0;
+        bool changed   = rt.update(make_route(index, 100, add ? linux_route::NEW : linux_route::DELETE)) == 0;
+        EXPECT_EQ(changed, add ? reference.insert(index).second : reference.erase(index) == 1);
+    }
+    EXPECT_EQ(rt.routes_v4().size(), reference.size());
+    for ( uint32_t index = 0; index < 2000; index++ ) {
+        EXPECT_EQ(rt.find(make_route(index, 100, linux_route::NEW)).first, reference.count(index) == 1);
+    }
+}
+
+static route_v4 make_route_v4 (uint32_t dest, uint8_t mask_len, uint32_t priority)
+{
+    route_v4 route;
+    route.dest      = htonl(mask_len ? dest & (~0u << (32 - mask_len)) : 0);
+    route.mask_len  = mask_len;
+    route.priority  = priority;
+    route.rt_number = 100;
+    route.flags     = mask_len ? route_v4::HAS_DEST : 0;
+    return route;
+}
+
+TEST(Lpm, reference)
+{
+    lpm_v4 lpm;
+    std::vector<route_v4> reference;
+    auto naive = [&reference] (uint32_t addr) {  // host byte order
+        const route_v4 *best = nullptr;
+        for ( const route_v4 &route : reference ) {
+            uint32_t mask = route.mask_len ? ~0u << (32 - route.mask_len) : 0;
+            if ( (addr & mask) != ntohl(route.dest) ) {
+                continue;
+            }
+            if ( not best or route.mask_len > best->mask_len or (route.mask_len == best->mask_len and route.priority < best->priority) ) {
+                best = &route;
+            }
+        }
+        return best;
+    };
+
+    // prefixes inside 10.1.0.0/16 with a lot of overlaps, /0 and > /24 ones included; priorities are unique
+    const uint8_t depths[] = {0, 8, 16, 20, 23, 24, 25, 28, 30, 32};
+    srand(7);
+    for ( uint32_t i = 0; i < 3000; i++ ) {
+        bool add = reference.empty() or rand() % 3 != 0;
+        if ( add ) {
+            uint32_t dest  = 0x0A010000u | (rand() & 0x3ff) | ((rand() & 3) << 10);
+            route_v4 route = make_route_v4(dest, depths[rand() % 10], i);
+            EXPECT_EQ(lpm.add(route), 0);
+            reference.push_back(route);
+        } else {
+            size_t pos = rand() % reference.size();
+            EXPECT_EQ(lpm.del(reference[pos]), 0);
+            reference.erase(reference.begin() + pos);
+        }
+        if ( i % 100 != 0 ) {
+            continue;
+        }
+        std::vector<in_addr_t> addrs;
+        for ( uint32_t addr = 0x0A010000u; addr < 0x0A011000u; addr += 3 ) {
+            addrs.push_back(htonl(addr));
+        }
+        addrs.push_back(htonl(0x0B000001u));  // covered only by /0
+        std::vector<const route_v4 *> results(addrs.size());
+        lpm.lookup(addrs.data(), addrs.size(), results.data());
+        for ( size_t n = 0; n < addrs.size(); n++ ) {
+            const route_v4 *expected = naive(ntohl(addrs[n]));
+            ASSERT_EQ(results[n] == nullptr, expected == nullptr);
+            EXPECT_EQ(lpm.lookup(addrs[n]), results[n]);
+            if ( expected ) {
+                ASSERT_TRUE(results[n]->same(*expected));
+            }
+        }
+    }
+
+    for ( const route_v4 &route : reference ) {
+        EXPECT_EQ(lpm.del(route), 0);
+    }
+    EXPECT_EQ(lpm.size(), 0);
+    EXPECT_EQ(lpm.lookup(htonl(0x0A010001u)), nullptr);
+    size_t bytes = lpm.bytes();
+    EXPECT_EQ(lpm.add(make_route_v4(0x0A010180u, 25, 0)), 0);  // the freed tbl8 groups are reused
+    EXPECT_LE(lpm.bytes(), bytes + sizeof(route_v4) * 16);
+    EXPECT_EQ(lpm.del(make_route_v4(0x0A010180u, 26, 0)), -1);
+}
+
+TEST(Lpm, reference_v6)
+{
+    auto make_prefix = [] (uint64_t hi, uint64_t lo, uint8_t mask_len, uint32_t priority) {
+        route_v6 route;
+        for ( int i = 0; i < 8; i++ ) {
+            route.dest[i]     = hi >> (56 - 8 * i);
+            route.dest[8 + i] = lo >> (56 - 8 * i);
+        }
+        for ( int bit = mask_len; bit < 128; bit++ ) {
+            route.dest[bit / 8] &= ~(0x80 >> (bit % 8));
+        }
+        route.mask_len  = mask_len;
+        route.priority  = priority;
+        route.rt_number = 100;
+        route.flags     = mask_len ? route_v4::HAS_DEST : 0;
+        return route;
+    };
+    auto covers = [] (const route_v6 &route, const in6_addr &addr) {
+        for ( int bit = 0; bit < route.mask_len; bit++ ) {
+            uint8_t mask = 0x80 >> (bit % 8);
+            if ( (route.dest[bit / 8] & mask) != (addr.s6_addr[bit / 8] & mask) ) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    lpm_v6 lpm;
+    std::vector<route_v6> reference;
+    // prefixes inside 2001:db8::/32 with a lot of overlaps, priorities are unique
+    const uint8_t lengths[] = {0, 16, 32, 33, 40, 44, 48, 56, 64, 65, 96, 127, 128};
+    srand(11);
+    for ( uint32_t i = 0; i < 3000; i++ ) {
+        if ( reference.empty() or rand() % 3 != 0 ) {
+            uint64_t hi    = 0x20010db800000000ull | ((uint64_t)(rand() & 0x3) << 24) | ((uint64_t)(rand() & 0x3) << 16);
+            uint64_t lo    = (uint64_t)(rand() & 0x3) << 62 | (rand() & 0x3);
+            route_v6 route = make_prefix(hi, lo, lengths[rand() % 13], i);
+            EXPECT_EQ(lpm.add(route), 0);
+            reference.push_back(route);
+        } else {
+            size_t pos = rand() % reference.size();
+            EXPECT_EQ(lpm.del(reference[pos]), 0);
+            reference.erase(reference.begin() + pos);
+        }
+        if ( i % 100 != 0 ) {
+            continue;
+        }
+        std::vector<in6_addr> addrs;
+        for ( uint32_t n = 0; n < 500; n++ ) {
+            route_v6 probe = make_prefix(0x20010db800000000ull | ((uint64_t)(rand() & 0x3) << 24) | ((uint64_t)(rand() & 0x3) << 16),
+                                         (uint64_t)(rand() & 0x3) << 62 | (rand() & 0x3), 128, 0);
+            addrs.emplace_back();
+            memcpy(addrs.back().s6_addr, probe.dest, 16);
+        }
+        inet_pton(AF_INET6, "2002::1", &addrs.emplace_back());  // covered only by ::/0
+        std::vector<const route_v6 *> results(addrs.size());
+        lpm.lookup(addrs.data(), addrs.size(), results.data());
+        for ( size_t n = 0; n < addrs.size(); n++ ) {
+            const route_v6 *expected = nullptr;
+            for ( const route_v6 &route : reference ) {
+                if ( covers(route, addrs[n]) and (not expected or route.mask_len > expected->mask_len  //
+                                                  or (route.mask_len == expected->mask_len and route.priority < expected->priority)) ) {
+                    expected = &route;
+                }
+            }
+            ASSERT_EQ(results[n] == nullptr, expected == nullptr);
+            EXPECT_EQ(lpm.lookup(addrs[n]), results[n]);
+            if ( expected ) {
+                ASSERT_TRUE(results[n]->same(*expected));
+            }
+        }
+    }
+
+    for ( const route_v6 &route : reference ) {
+        EXPECT_EQ(lpm.del(route), 0);
+    }
+    EXPECT_EQ(lpm.size(), 0);
+    in6_addr addr;
+    inet_pton(AF_INET6, "2001:db8::1", &addr);
+    EXPECT_EQ(lpm.lookup(addr), nullptr);
+    EXPECT_EQ(lpm.del(make_prefix(0x20010db800000000ull, 0, 48, 0)), -1);
+}
+
+TEST(Route_journal, ring)
+{
+    route_journal journal(8);
+    std::vector<route_delta> deltas;
+    EXPECT_EQ(journal.changes_since(0, deltas), 0);
+    EXPECT_TRUE(deltas.empty());
+
+    for ( uint32_t i = 0; i < 5; i++ ) {
+        journal.record(route_delta::ADD, make_route(i, 100, linux_route::NEW).to_v4());
+    }
+    EXPECT_EQ(journal.version(), 5);
+    EXPECT_EQ(journal.changes_since(2, deltas), 0);
+    ASSERT_EQ(deltas.size(), 3);
+    EXPECT_EQ(deltas[0].version, 3);
+    EXPECT_TRUE(linux_route(deltas[2].v4) == make_route(4, 100, linux_route::NEW));
+
+    for ( uint32_t i = 0; i < 5; i++ ) {
+        journal.record(route_delta::DELETE, make_route(i, 100, linux_route::NEW).to_v4());
+    }
+    deltas.clear();
+    EXPECT_EQ(journal.changes_since(1, deltas), 1);  // versions 2 .. 10 don't fit into 8
+    EXPECT_EQ(journal.changes_since(2, deltas), 0);
+    ASSERT_EQ(deltas.size(), 8);
+    EXPECT_EQ(deltas.back().version, 10);
+    EXPECT_EQ(deltas.back().op, route_delta::DELETE);
+    EXPECT_EQ(journal.changes_since(11, deltas), 1);  // from the future
+
+    journal.reset();
+    deltas.clear();
+    EXPECT_EQ(journal.changes_since(10, deltas), 1);
+    EXPECT_EQ(journal.changes_since(journal.version(), deltas), 0);
+    EXPECT_TRUE(deltas.empty());
+}
+
+TEST(Route_journal, manager)
+{
+    auto &rt_manager         = linux_rt_manager::get_instance();
+    const uint32_t rt_number = 1000;
+    uint64_t cursor          = 0;
+    std::vector<route_delta> deltas;
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), -1);  // not followed
+
+    rt_manager.follow_rt(rt_number);
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), 1);  // a new table: read it whole first
+    EXPECT_EQ(cursor, rt_manager.version(rt_number));
+
+    EXPECT_EQ(rt_manager.update(make_route(1, rt_number, linux_route::NEW)), 0);
+    EXPECT_EQ(rt_manager.update(make_route(2, rt_number, linux_route::NEW)), 0);
+    linux_route modified = make_route(2, rt_number, linux_route::NEW);
+    modified.proto       = RTPROT_STATIC;
+    EXPECT_EQ(rt_manager.update(modified), 0);
+    EXPECT_EQ(rt_manager.update(modified), -1);  // no change, no delta
+    EXPECT_EQ(rt_manager.update(make_route(1, rt_number, linux_route::DELETE)), 0);
+
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 4);
+    EXPECT_EQ(deltas[0].op, route_delta::ADD);
+    EXPECT_EQ(deltas[2].op, route_delta::MODIFY);
+    EXPECT_EQ(deltas[2].v4.proto, RTPROT_STATIC);
+    EXPECT_EQ(deltas[3].op, route_delta::DELETE);
+    EXPECT_EQ(cursor, rt_manager.version(rt_number));
+
+    // replacing the whole table journals only the difference
+    linux_routing_table table(rt_number);
+    table.update(modified);
+    table.update(make_route(3, rt_number, linux_route::NEW));
+    deltas.clear();
+    EXPECT_EQ(rt_manager.update(table), 0);
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 1);
+    EXPECT_EQ(deltas[0].op, route_delta::ADD);
+    EXPECT_TRUE(linux_route(deltas[0].v4) == make_route(3, rt_number, linux_route::NEW));
+
+    // a replace with another oif changes the identity: the old route is deleted by its own identity
+    linux_route replace = make_route(3, rt_number, linux_route::REPLACE);
+    replace.iface_id    = 3;
+    deltas.clear();
+    EXPECT_EQ(rt_manager.update(replace), 0);
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 2);
+    EXPECT_EQ(deltas[0].op, route_delta::DELETE);
+    EXPECT_EQ(deltas[0].v4.iface_id, 2);
+    EXPECT_EQ(deltas[1].op, route_delta::ADD);
+    EXPECT_EQ(deltas[1].v4.iface_id, 3);
+    EXPECT_EQ(rt_manager.get(rt_number)->size(), 2);
+
+    replace.proto = RTPROT_STATIC;  // the same identity: modified in place
+    deltas.clear();
+    EXPECT_EQ(rt_manager.update(replace), 0);
+    EXPECT_EQ(rt_manager.changes_since(rt_number, cursor, deltas), 0);
+    ASSERT_EQ(deltas.size(), 1);
+    EXPECT_EQ(deltas[0].op, route_delta::MODIFY);
+}
+
+TEST(Snapshot, cow_store)
+{
+    cow_store<route_v4> store;
+    std::set<uint32_t> reference;
+    cow_store<route_v4> frozen;  // a copy shares the chunks and must not see later changes
+    std::set<uint32_t> frozen_reference;
+    for ( uint32_t i = 0; i < 20000; i++ ) {
+        uint32_t index = (i * 7919) % 5000;
+        if ( (i % 3) != 0 ) {
+            store.upsert(make_route(index, 100, linux_route::NEW).to_v4());
+            reference.insert(index);
+        } else {
+            EXPECT_EQ(store.erase(make_route(index, 100, linux_route::NEW).to_v4()), reference.erase(index) == 1);
+        }
+        if ( i == 10000 ) {
+            frozen           = store;
+            frozen_reference = reference;
+        }
+    }
+    EXPECT_EQ(store.size(), reference.size());
+    for ( uint32_t index = 0; index < 5000; index++ ) {
+        route_v4 route = make_route(index, 100, linux_route::NEW).to_v4();
+        auto found     = store.find(route);
+        ASSERT_EQ(found.first, reference.count(index) == 1);
+        if ( found.first ) {
+            EXPECT_TRUE(store[found.second].same(route));
+        }
+        EXPECT_EQ(frozen.find(route).first, frozen_reference.count(index) == 1);
+    }
+    EXPECT_EQ(frozen.size(), frozen_reference.size());
+}
+
+TEST(Snapshot, readers)
+{
+    auto &rt_manager         = linux_rt_manager::get_instance();
+    const uint32_t rt_number = 1001;
+    const uint32_t WINDOW    = 10;
+    const uint32_t STEPS     = 20000;
+    EXPECT_EQ(rt_manager.enable_snapshots(rt_number), nullptr);  // not followed
+    rt_manager.follow_rt(rt_number);
+    const route_snapshots *snapshots = rt_manager.enable_snapshots(rt_number);
+    ASSERT_NE(snapshots, nullptr);
+
+    std::atomic<bool> stop   = false;
+    std::atomic<size_t> bad  = 0;
+    std::atomic<size_t> read = 0;
+    auto reader              = [&] () {
+        uint64_t last_version = 0;
+        while ( not stop ) {
+            nl_epoch::guard guard;
+            const route_snapshot *snapshot = snapshots->current();
+            bool ok = snapshot->version >= last_version and snapshot->v4.size() <= WINDOW;
+            for ( size_t pos = 0; pos < snapshot->v4.size(); pos++ ) {
+                auto found = snapshot->v4.find(snapshot->v4[pos]);
+                ok &= found.first and found.second == pos;
+            }
+            last_version = snapshot->version;
+            bad += not ok;
+            ++read;
+        }
+    };
+    std::vector<std::thread> readers;
+    for ( int i = 0; i < 3; i++ ) {
+        readers.emplace_back(reader);
+    }
+
+    for ( uint32_t i = 0; i < STEPS; i++ ) {
+        rt_manager.update(make_route(i, rt_number, linux_route::NEW));
+        if ( i >= WINDOW ) {
+            rt_manager.update(make_route(i - WINDOW, rt_number, linux_route::DELETE));
+        }
+        rt_manager.publish_snapshots();
+        if ( i % 1000 == 0 ) {
+            std::this_thread::yield();
+        }
+    }
+    stop = true;
+    for ( auto &thread : readers ) {
+        thread.join();
+    }
+    EXPECT_EQ(bad, 0);
+    EXPECT_GT(read, 0);
+
+    nl_epoch::get_instance().reclaim();
+    EXPECT_EQ(nl_epoch::get_instance().pending(), 0);
+    nl_epoch::guard guard;
+    EXPECT_EQ(snapshots->current()->v4.size(), WINDOW);
+    EXPECT_EQ(snapshots->current()->version, rt_manager.version(rt_number));
+}